@@ -0,0 +1,206 @@
+/** Benchmark of forked versus in-process airports at scale.
+ *
+ *  Starts `./controller` (run from the repository root) with each airport
+ *  count, once forking a process per airport (`-t tcp`) and once hosting
+ *  every airport in the controller (`-t inproc`), and reports for each:
+ *
+ *  - startup: from exec until the last airport has answered a request;
+ *  - memory: proportional set size (PSS) of the controller and all of its
+ *    airport processes, so pages they share after the fork count once;
+ *  - threads and processes;
+ *  - throughput of `clients` connections each sending SCHEDULE and
+ *    PLANE_STATUS requests one at a time to random airports.
+ *
+ *  Usage: ./bench/airports [clients] [requests per client] [airport counts...]
+ *  e.g.   ./bench/airports 8 5000 10 100 1000
+ */
+#include <dirent.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include "../src/network_utils.h"
+#include <pthread.h>
+
+#define GATES_PER_AIRPORT 16
+
+typedef struct {
+  int id, num_airports, requests;
+  char *port;
+} client_t;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/** Sends `request` and reads the first line of its response into `response`
+ *  (`MAXLINE` bytes). */
+static int round_trip(int fd, rio_t *rio, char *request, char *response) {
+  return (rio_writen(fd, request, strlen(request)) < 0 ||
+          rio_readlineb(rio, response, MAXLINE) <= 0)
+             ? -1
+             : 0;
+}
+
+static void *client_routine(void *arg) {
+  client_t *c = arg;
+  char request[MAXLINE], response[MAXLINE];
+  unsigned seed = (unsigned)c->id + 1;
+  rio_t rio;
+  int fd = open_clientfd("localhost", c->port);
+
+  if (fd < 0) {
+    perror("open_clientfd");
+    exit(1);
+  }
+  rio_readinitb(&rio, fd);
+  for (int i = 0; i < c->requests; i++) {
+    int airport = rand_r(&seed) % c->num_airports, plane_id = c->id * 1000000 + i;
+    if (i % 2 == 0)
+      snprintf(request, MAXLINE, "SCHEDULE %d %d %d 0 47\n", airport, plane_id,
+               rand_r(&seed) % 48);
+    else
+      snprintf(request, MAXLINE, "PLANE_STATUS %d %d\n", airport, plane_id - 1);
+    if (round_trip(fd, &rio, request, response) < 0) {
+      fprintf(stderr, "client %d: connection closed early\n", c->id);
+      exit(1);
+    }
+  }
+  close(fd);
+  return NULL;
+}
+
+/** Reads the value of `key` (e.g. "Pss:") from a /proc file, or returns 0. */
+static long proc_value(pid_t pid, const char *file, const char *key) {
+  char path[64], line[256];
+  long value = 0;
+  FILE *f;
+
+  snprintf(path, sizeof(path), "/proc/%d/%s", pid, file);
+  if ((f = fopen(path, "r")) == NULL)
+    return 0;
+  while (fgets(line, sizeof(line), f)) {
+    if (strncmp(line, key, strlen(key)) == 0) {
+      value = atol(line + strlen(key));
+      break;
+    }
+  }
+  fclose(f);
+  return value;
+}
+
+/** Adds up the PSS (in kB) and threads of `pid` and its child processes. */
+static void measure_tree(pid_t pid, long *pss_kb, long *threads, int *processes) {
+  char path[64], stat[512];
+  struct dirent *entry;
+  DIR *proc = opendir("/proc");
+  FILE *f;
+  int child, ppid;
+
+  *pss_kb = proc_value(pid, "smaps_rollup", "Pss:");
+  *threads = proc_value(pid, "status", "Threads:");
+  *processes = 1;
+  while (proc && (entry = readdir(proc)) != NULL) {
+    if ((child = atoi(entry->d_name)) <= 0)
+      continue;
+    snprintf(path, sizeof(path), "/proc/%d/stat", child);
+    if ((f = fopen(path, "r")) == NULL)
+      continue;
+    // The parent's PID follows the command name (in parentheses) and state
+    if (fgets(stat, sizeof(stat), f) && sscanf(strrchr(stat, ')'), ") %*c %d", &ppid) == 1 &&
+        ppid == pid) {
+      *pss_kb += proc_value(child, "smaps_rollup", "Pss:");
+      *threads += proc_value(child, "status", "Threads:");
+      (*processes)++;
+    }
+    fclose(f);
+  }
+  if (proc)
+    closedir(proc);
+}
+
+static void run(const char *transport, int num_airports, int port, int num_clients, int requests) {
+  char port_str[16], request[MAXLINE], response[MAXLINE], *gates;
+  size_t gates_len = (size_t)num_airports * 4;
+  long pss_kb, threads;
+  int processes, fd = -1;
+  rio_t rio;
+  pid_t pid;
+
+  snprintf(port_str, sizeof(port_str), "%d", port);
+  gates = malloc(gates_len);
+  gates[0] = '\0';
+  for (int i = 0; i < num_airports; i++)
+    snprintf(gates + strlen(gates), gates_len - strlen(gates), i ? ",%d" : "%d", GATES_PER_AIRPORT);
+
+  double start = now_ns();
+  if ((pid = fork()) == 0) {
+    char count[16];
+    snprintf(count, sizeof(count), "%d", num_airports);
+    // In a process group of its own, so that its airports can be killed
+    // with it
+    setpgid(0, 0);
+    if (freopen("/dev/null", "w", stderr) == NULL)
+      exit(1);
+    execl("./controller", "controller", "-p", port_str, "-t", transport, "-n", count, "--", gates,
+          (char *)NULL);
+    perror("execl ./controller");
+    exit(1);
+  }
+
+  // Started once the last airport answers through the controller
+  snprintf(request, MAXLINE, "PLANE_STATUS %d 0\n", num_airports - 1);
+  while (1) {
+    if (fd < 0 && (fd = open_clientfd("localhost", port_str)) >= 0)
+      rio_readinitb(&rio, fd);
+    if (fd >= 0 && round_trip(fd, &rio, request, response) == 0 &&
+        strncmp(response, "Error", 5) != 0)
+      break;
+    usleep(1000);
+  }
+  double startup = now_ns() - start;
+  close(fd);
+  measure_tree(pid, &pss_kb, &threads, &processes);
+
+  client_t *clients = calloc((size_t)num_clients, sizeof(client_t));
+  pthread_t *tids = calloc((size_t)num_clients, sizeof(pthread_t));
+  start = now_ns();
+  for (int i = 0; i < num_clients; i++) {
+    clients[i] = (client_t){i, num_airports, requests, port_str};
+    pthread_create(&tids[i], NULL, client_routine, &clients[i]);
+  }
+  for (int i = 0; i < num_clients; i++)
+    pthread_join(tids[i], NULL);
+  double elapsed = (now_ns() - start) / 1e9;
+
+  printf("%-6s %5d airports  startup %8.1f ms  PSS %8.1f MB  %5d processes %6ld threads  "
+         "%8.0f req/s\n",
+         transport, num_airports, startup / 1e6, (double)pss_kb / 1024, processes, threads,
+         (double)num_clients * requests / elapsed);
+  fflush(stdout);
+
+  kill(-pid, SIGKILL);
+  waitpid(pid, NULL, 0);
+  free(clients);
+  free(tids);
+  free(gates);
+}
+
+int main(int argc, char *argv[]) {
+  int num_clients = (argc > 1) ? atoi(argv[1]) : 8;
+  int requests = (argc > 2) ? atoi(argv[2]) : 5000;
+  int default_counts[] = {10, 100, 1000}, port = 20000;
+
+  for (int i = 3; i < argc || (argc <= 3 && i < 6); i++) {
+    int num_airports = (argc > 3) ? atoi(argv[i]) : default_counts[i - 3];
+    run("tcp", num_airports, port, num_clients, requests);
+    port += num_airports + 1;
+    run("inproc", num_airports, port, num_clients, requests);
+    port += num_airports + 1;
+  }
+  return 0;
+}
@@ -0,0 +1,163 @@
+/** Benchmark of SCHEDULE_BATCH against one SCHEDULE per flight.
+ *
+ *  Starts `./controller` (run from the repository root) with one large
+ *  airport, and has `clients` connections each schedule `flights` flights
+ *  through it: one SCHEDULE request at a time, then SCHEDULE_BATCH requests
+ *  of 8, 24 and 48 flights, each against a fresh controller. Reports the
+ *  flights scheduled per second and the average round trip per request.
+ *
+ *  Usage: ./bench/batch [clients] [flights per client] [controller options...]
+ *  e.g.   ./bench/batch 4 20000 -P
+ */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include "../src/network_utils.h"
+#include "../src/wire.h"
+#include <pthread.h>
+
+#define NUM_GATES "2048"
+
+typedef struct {
+  int id, flights, batch;
+  char *port;
+} client_t;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/** Sends `request` and reads its response up to its `lines`th line. */
+static int round_trip(int fd, rio_t *rio, char *request, int lines) {
+  char response[MAXLINE];
+  if (rio_writen(fd, request, strlen(request)) < 0)
+    return -1;
+  for (int i = 0; i < lines; i++) {
+    if (rio_readlineb(rio, response, MAXLINE) <= 0)
+      return -1;
+  }
+  return 0;
+}
+
+static void *client_routine(void *arg) {
+  client_t *c = arg;
+  char request[MAXLINE];
+  unsigned seed = (unsigned)c->id + 1;
+  rio_t rio;
+  int fd = open_clientfd("localhost", c->port);
+
+  if (fd < 0) {
+    perror("open_clientfd");
+    exit(1);
+  }
+  rio_readinitb(&rio, fd);
+  for (int i = 0; i < c->flights; i += c->batch) {
+    int n = (c->flights - i < c->batch) ? c->flights - i : c->batch;
+    size_t len = 0;
+    if (c->batch == 1)
+      len = (size_t)snprintf(request, MAXLINE, "SCHEDULE 0");
+    else
+      len = (size_t)snprintf(request, MAXLINE, "SCHEDULE_BATCH 0 0");
+    for (int j = 0; j < n; j++)
+      len += (size_t)snprintf(request + len, MAXLINE - len, " %d %d 0 47",
+                              c->id * 100000 + i + j, rand_r(&seed) % 48);
+    snprintf(request + len, MAXLINE - len, "\n");
+    // A batch answers with a header line, then one line per flight
+    if (round_trip(fd, &rio, request, (c->batch == 1) ? 1 : n + 1) < 0) {
+      fprintf(stderr, "client %d: connection closed early\n", c->id);
+      exit(1);
+    }
+  }
+  close(fd);
+  return NULL;
+}
+
+static void run(int batch, int port, int num_clients, int flights, char **options,
+                int num_options) {
+  char port_str[16], label[32], *argv[32];
+  int argc = 0, fd;
+  pid_t pid;
+
+  snprintf(port_str, sizeof(port_str), "%d", port);
+  argv[argc++] = "controller";
+  argv[argc++] = "-p";
+  argv[argc++] = port_str;
+  argv[argc++] = "-n";
+  argv[argc++] = "1";
+  for (int i = 0; i < num_options && argc < 28; i++)
+    argv[argc++] = options[i];
+  argv[argc++] = "--";
+  argv[argc++] = NUM_GATES;
+  argv[argc] = NULL;
+
+  if ((pid = fork()) == 0) {
+    // In a process group of its own, so that its airports can be killed
+    // with it
+    setpgid(0, 0);
+    if (freopen("/dev/null", "w", stderr) == NULL)
+      exit(1);
+    execv("./controller", argv);
+    perror("execv ./controller");
+    exit(1);
+  }
+
+  // Started once the airport answers through the controller
+  while (1) {
+    rio_t rio;
+    char response[MAXLINE];
+    if ((fd = open_clientfd("localhost", port_str)) >= 0) {
+      rio_readinitb(&rio, fd);
+      if (rio_writen(fd, "PLANE_STATUS 0 0\n", 17) == 17 &&
+          rio_readlineb(&rio, response, MAXLINE) > 0 && strncmp(response, "Error", 5) != 0) {
+        close(fd);
+        break;
+      }
+      close(fd);
+    }
+    usleep(1000);
+  }
+
+  client_t *clients = calloc((size_t)num_clients, sizeof(client_t));
+  pthread_t *tids = calloc((size_t)num_clients, sizeof(pthread_t));
+  double start = now_ns();
+  for (int i = 0; i < num_clients; i++) {
+    clients[i] = (client_t){i, flights, batch, port_str};
+    pthread_create(&tids[i], NULL, client_routine, &clients[i]);
+  }
+  for (int i = 0; i < num_clients; i++)
+    pthread_join(tids[i], NULL);
+  double elapsed = now_ns() - start;
+  long requests = (long)num_clients * ((flights + batch - 1) / batch);
+
+  if (batch == 1)
+    snprintf(label, sizeof(label), "SCHEDULE");
+  else
+    snprintf(label, sizeof(label), "SCHEDULE_BATCH %d", batch);
+  printf("%-18s %10.0f flights/s  %8.1f us per request\n", label,
+         (double)num_clients * flights / (elapsed / 1e9),
+         elapsed / 1e3 * num_clients / (double)requests);
+  fflush(stdout);
+
+  kill(-pid, SIGKILL);
+  waitpid(pid, NULL, 0);
+  free(clients);
+  free(tids);
+}
+
+int main(int argc, char *argv[]) {
+  int num_clients = (argc > 1) ? atoi(argv[1]) : 4;
+  int flights = (argc > 2) ? atoi(argv[2]) : 20000;
+  // 48 flights of this benchmark fill most of a `MAXLINE` request
+  int batches[] = {1, 8, 24, 48}, port = 22000;
+
+  for (size_t i = 0; i < sizeof(batches) / sizeof(batches[0]); i++) {
+    run(batches[i], port, num_clients, flights, argv + 3, (argc > 3) ? argc - 3 : 0);
+    port += 2;
+  }
+  return 0;
+}
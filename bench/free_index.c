@@ -0,0 +1,82 @@
+/** Benchmark of scheduling with the free-interval index (`-g earliest` and
+ *  `-g best`) against the first gate that fits (`-g first`).
+ *
+ *  Schedules a stream of flights on one airport, one at a time, each with a
+ *  random earliest start, a duration of 1-4 slots and fuel for 0-15 slots of
+ *  waiting, until about 20% more slots were asked for than the airport has.
+ *  For each gate count and policy, reports:
+ *
+ *  - the share of the flights that got a gate, and of the slots used;
+ *  - the average delay of a flight: its start minus its earliest start;
+ *  - p50 and p99 latency of `schedule_plane`.
+ *
+ *  Usage: ./bench/free_index [rounds] [gate counts...]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/airport.h"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static void run(probe_policy_t policy, int num_gates, int rounds) {
+  const char *names[] = {"first", "rotate", "least", "earliest", "best"};
+  // Flights take 2.5 slots on average (a duration of 0-3, plus one)
+  long requests = (long)num_gates * NUM_TIME_SLOTS * 12 / 25;
+  double *latencies = calloc((size_t)(requests * rounds), sizeof(double));
+  long scheduled = 0, delay = 0, used = 0, n = 0;
+
+  PROBE_POLICY = policy;
+  for (int r = 0; r < rounds; r++) {
+    airport_t *airport = create_airport(num_gates);
+    unsigned seed = (unsigned)r + 1;
+    attach_airport(0, airport);
+    for (long i = 0; i < requests; i++) {
+      int start = rand_r(&seed) % NUM_TIME_SLOTS, duration = rand_r(&seed) % 4;
+      int fuel = rand_r(&seed) % 16;
+      double begin = now_ns();
+      time_info_t info = schedule_plane((int)i, start, duration, fuel);
+      latencies[n++] = now_ns() - begin;
+      if (info.gate_number >= 0) {
+        scheduled++;
+        delay += info.start_time - start;
+      }
+    }
+    for (int g = 0; g < num_gates; g++)
+      used += __builtin_popcountll(airport->occupancy[g]);
+    destroy_airport(airport);
+  }
+
+  qsort(latencies, (size_t)n, sizeof(double), compare_doubles);
+  printf("%-8s %5d gates  %5.1f%% scheduled  %5.1f%% of slots used  delay %5.2f slots  "
+         "p50 %7.0f ns  p99 %7.0f ns\n",
+         names[policy], num_gates, 100.0 * (double)scheduled / (double)n,
+         100.0 * (double)used / ((double)num_gates * NUM_TIME_SLOTS * rounds),
+         scheduled ? (double)delay / (double)scheduled : 0, latencies[n / 2],
+         latencies[n * 99 / 100]);
+  fflush(stdout);
+  free(latencies);
+}
+
+int main(int argc, char *argv[]) {
+  int rounds = (argc > 1) ? atoi(argv[1]) : 20;
+  int default_counts[] = {8, 64, 512, 4096};
+  probe_policy_t policies[] = {PROBE_FIRST, PROBE_EARLIEST, PROBE_BEST_FIT};
+
+  for (int i = 2; i < argc || (argc <= 2 && i < 6); i++) {
+    int num_gates = (argc > 2) ? atoi(argv[i]) : default_counts[i - 2];
+    for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++)
+      run(policies[p], num_gates, rounds);
+  }
+  return 0;
+}
@@ -0,0 +1,69 @@
+/** Benchmark comparing the memory use and scan speed of the gate layouts.
+ *
+ *  Built twice by `make bench`: `bench/gate_layout` uses the default slot
+ *  array layout and `bench/gate_layout_compact` uses `COMPACT_GATES`. Each gate
+ *  is filled with bookings of 8 slots, then every gate is swept with a
+ *  full-day `read_time_slots` (as TIME_STATUS does) and with `search_gate` for
+ *  a plane that is not scheduled.
+ *
+ *  Usage: ./bench/gate_layout [num gates]
+ */
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/airport.h"
+
+#define BOOKING_LEN 8
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static size_t heap_in_use(void) {
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+}
+
+int main(int argc, char *argv[]) {
+  int num_gates = (argc > 1) ? atoi(argv[1]) : 50000, plane_id = 1;
+  time_slot_t slots[NUM_TIME_SLOTS];
+  volatile int sink = 0;
+  size_t heap_before = heap_in_use();
+
+#ifdef COMPACT_GATES
+  printf("layout: compact\n");
+#else
+  printf("layout: slot array\n");
+#endif
+
+  airport_t *airport = create_airport(num_gates);
+  attach_airport(0, airport);
+  for (int g = 0; g < num_gates; g++)
+    for (int slot = 0; slot + BOOKING_LEN <= NUM_TIME_SLOTS; slot += BOOKING_LEN)
+      add_plane_to_slots(get_gate_by_idx(g), plane_id++, slot, BOOKING_LEN - 1);
+  size_t heap_after = heap_in_use();
+
+  printf("sizeof(gate_t):       %zu bytes\n", sizeof(gate_t));
+  printf("heap for %d gates: %.1f MB (%.0f bytes/gate, incl. plane index)\n", num_gates,
+         (double)(heap_after - heap_before) / 1e6,
+         (double)(heap_after - heap_before) / num_gates);
+
+  double start = now_ns();
+  for (int g = 0; g < num_gates; g++) {
+    read_time_slots(get_gate_by_idx(g), 0, NUM_TIME_SLOTS - 1, slots);
+    sink += slots[NUM_TIME_SLOTS - 1].plane_id;
+  }
+  printf("full-day slot sweep:  %.1f ns/gate\n", (now_ns() - start) / num_gates);
+
+  start = now_ns();
+  for (int g = 0; g < num_gates; g++)
+    sink += search_gate(get_gate_by_idx(g), -1);
+  printf("search_gate (miss):   %.1f ns/gate\n", (now_ns() - start) / num_gates);
+
+  destroy_airport(airport);
+  return 0;
+}
@@ -0,0 +1,69 @@
+/** Benchmark for the multi-gate window search used by `schedule_plane`.
+ *
+ *  Every gate except the last one is fully booked, so a request that only fits
+ *  in the highest-numbered gate has to rule out all earlier gates first. This
+ *  compares the per-gate scalar loop with each vectorised implementation.
+ *
+ *  Usage: ./bench/gate_search [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/airport.h"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* The search a pre-bitmap `schedule_plane` did: one gate at a time. */
+static int first_gate_loop(const occupancy_t *occ, int num_gates, int first, int last,
+                           int len) {
+  for (int gate_idx = 0; gate_idx < num_gates; gate_idx++) {
+    if (occupancy_first_window(occ[gate_idx], first, last, len) >= 0)
+      return gate_idx;
+  }
+  return -1;
+}
+
+static void run(const char *name, occupancy_first_gate_fn fn, const occupancy_t *occ,
+                int num_gates, long iterations) {
+  volatile int sink = 0;
+  double start = now_ns();
+  for (long i = 0; i < iterations; i++)
+    sink += fn(occ, num_gates, 16, 40, 5);
+  double elapsed = now_ns() - start;
+  if (sink != (int)iterations * (num_gates - 1)) {
+    fprintf(stderr, "%s returned the wrong gate\n", name);
+    exit(1);
+  }
+  printf("%6d gates  %-8s %10.1f ns/search\n", num_gates, name, elapsed / (double)iterations);
+}
+
+int main(int argc, char *argv[]) {
+  int gate_counts[] = {8, 64, 512, 4096};
+  long iterations = (argc > 1) ? atol(argv[1]) : 200000;
+
+  printf("dispatch picks: %s\n", occupancy_first_gate_impl());
+  for (size_t i = 0; i < sizeof(gate_counts) / sizeof(gate_counts[0]); i++) {
+    int num_gates = gate_counts[i];
+    occupancy_t *occ = calloc((size_t)num_gates, sizeof(occupancy_t));
+    for (int g = 0; g < num_gates - 1; g++)
+      occ[g] = occupancy_range(0, NUM_TIME_SLOTS - 1);
+    long iters = iterations * 8 / num_gates + 1;
+
+    run("loop", first_gate_loop, occ, num_gates, iters);
+    run("scalar", occupancy_first_gate_scalar, occ, num_gates, iters);
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1"))
+      run("sse4", occupancy_first_gate_sse4, occ, num_gates, iters);
+    if (__builtin_cpu_supports("avx2"))
+      run("avx2", occupancy_first_gate_avx2, occ, num_gates, iters);
+#endif
+    free(occ);
+  }
+  return 0;
+}
@@ -0,0 +1,140 @@
+/** Benchmark of the airport server's I/O paths.
+ *
+ *  Forks an airport node once per server mode (threaded rio, epoll reactor,
+ *  io_uring reactor) and drives it directly with `clients` connections. Each
+ *  client keeps `window` PLANE_STATUS requests in flight: it writes a batch
+ *  of requests in one go, then reads back all of their responses. Reports the
+ *  throughput and the airport's CPU time (user + system) per request, which
+ *  is dominated by system calls for such cheap requests.
+ *
+ *  Usage: ./bench/io_backend [clients] [window] [requests per client]
+ */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include "../src/airport.h"
+
+#define PORT "4990"
+
+typedef struct {
+  int id, window, requests;
+} client_t;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/** Returns the CPU time used so far by process `pid`, in microseconds. */
+static double cpu_us(pid_t pid) {
+  char path[64];
+  unsigned long utime = 0, stime = 0;
+  FILE *f;
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+  if ((f = fopen(path, "r")) == NULL)
+    return 0;
+  if (fscanf(f, "%*d (%*[^)]) %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime,
+             &stime) != 2)
+    utime = stime = 0;
+  fclose(f);
+  return (double)(utime + stime) * 1e6 / (double)sysconf(_SC_CLK_TCK);
+}
+
+static void *client_routine(void *arg) {
+  client_t *c = arg;
+  char batch[MAXBUF], response[MAXLINE];
+  int fd, len, done = 0, ends;
+  rio_t rio;
+
+  // The airport may still be starting up
+  for (int tries = 0; (fd = open_clientfd("localhost", PORT)) < 0 && tries < 100; tries++)
+    usleep(10000);
+  if (fd < 0) {
+    perror("open_clientfd");
+    exit(1);
+  }
+  rio_readinitb(&rio, fd);
+
+  while (done < c->requests) {
+    len = 0;
+    for (int i = 0; i < c->window; i++)
+      len += snprintf(batch + len, MAXBUF - (size_t)len, "PLANE_STATUS 0 %d\n", c->id * 1000000 + done + i);
+    rio_writen(fd, batch, (size_t)len);
+    // Each response ends with an empty line
+    for (ends = 0; ends < c->window;) {
+      if (rio_readlineb(&rio, response, MAXLINE) <= 0) {
+        fprintf(stderr, "client %d: connection closed early\n", c->id);
+        exit(1);
+      }
+      ends += (strcmp(response, RESPONSE_END) == 0);
+    }
+    done += c->window;
+  }
+  close(fd);
+  return NULL;
+}
+
+static void run(const char *name, server_mode_t mode, int num_clients, int window, int requests) {
+  client_t *clients = calloc((size_t)num_clients, sizeof(client_t));
+  pthread_t *tids = calloc((size_t)num_clients, sizeof(pthread_t));
+  int listenfd;
+  pid_t pid;
+  double start, elapsed, cpu;
+
+  // A killed io_uring server releases its listening socket asynchronously
+  for (int tries = 0; (listenfd = open_listenfd(PORT)) < 0 && tries < 100; tries++)
+    usleep(10000);
+  if (listenfd < 0) {
+    perror("open_listenfd");
+    exit(1);
+  }
+  if ((pid = fork()) == 0) {
+    SERVER_MODE = mode;
+    initialise_node(0, 16, listenfd);
+    exit(0);
+  }
+  close(listenfd);
+
+  start = now_ns();
+  cpu = cpu_us(pid);
+  for (int i = 0; i < num_clients; i++) {
+    clients[i] = (client_t){i, window, requests};
+    pthread_create(&tids[i], NULL, client_routine, &clients[i]);
+  }
+  for (int i = 0; i < num_clients; i++)
+    pthread_join(tids[i], NULL);
+  elapsed = (now_ns() - start) / 1e9;
+  cpu = cpu_us(pid) - cpu;
+
+  printf("%-10s %9.0f req/s %8.2f us cpu/req\n", name,
+         (double)num_clients * requests / elapsed, cpu / ((double)num_clients * requests));
+  kill(pid, SIGKILL);
+  waitpid(pid, NULL, 0);
+  free(clients);
+  free(tids);
+}
+
+int main(int argc, char *argv[]) {
+  int num_clients = (argc > 1) ? atoi(argv[1]) : 8;
+  int window = (argc > 2) ? atoi(argv[2]) : 16;
+  int requests = (argc > 3) ? atoi(argv[3]) : 20000;
+  if (window < 1 || window > MAXBUF / 32) {
+    fprintf(stderr, "window must be between 1 and %d\n", MAXBUF / 32);
+    return 1;
+  }
+  requests -= requests % window;
+
+  printf("%d clients, %d requests in flight each, %d requests per client\n", num_clients,
+         window, requests);
+  run("rio", SERVER_THREADED, num_clients, window, requests);
+  run("epoll", SERVER_REACTOR, num_clients, window, requests);
+  if (uring_supported())
+    run("io_uring", SERVER_URING, num_clients, window, requests);
+  else
+    printf("%-10s not supported on this kernel\n", "io_uring");
+  return 0;
+}
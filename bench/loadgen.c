@@ -0,0 +1,96 @@
+/** Load generator for a running controller.
+ *
+ *  Opens `clients` concurrent connections to the controller, and on each one
+ *  sends `requests` single-line requests one at a time (a mix of SCHEDULE and
+ *  PLANE_STATUS spread over all airports), waiting for each reply before
+ *  sending the next. Reports overall throughput and latency percentiles.
+ *
+ *  Usage: ./bench/loadgen <port> <num airports> [clients] [requests per client]
+ *  The airports should have enough gates for the requests, e.g.
+ *      ./controller -p 3000 -n 4 -- 64,64,64,64 &
+ *      ./bench/loadgen 3000 4 8 5000
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/network_utils.h"
+#include <pthread.h>
+
+typedef struct {
+  int id;
+  char *port;
+  int num_airports;
+  int requests;
+  double *latencies;
+} client_t;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void *client_routine(void *arg) {
+  client_t *c = arg;
+  char request[MAXLINE], response[MAXLINE];
+  unsigned seed = (unsigned)c->id + 1;
+  rio_t rio;
+  int fd = open_clientfd("localhost", c->port);
+  if (fd < 0) {
+    perror("open_clientfd");
+    exit(1);
+  }
+  rio_readinitb(&rio, fd);
+
+  for (int i = 0; i < c->requests; i++) {
+    int airport = rand_r(&seed) % c->num_airports, plane_id = c->id * 1000000 + i;
+    if (i % 2 == 0)
+      snprintf(request, MAXLINE, "SCHEDULE %d %d %d 0 47\n", airport, plane_id,
+               rand_r(&seed) % 48);
+    else
+      snprintf(request, MAXLINE, "PLANE_STATUS %d %d\n", airport, plane_id - 1);
+    double start = now_ns();
+    rio_writen(fd, request, strlen(request));
+    if (rio_readlineb(&rio, response, MAXLINE) <= 0) {
+      fprintf(stderr, "client %d: connection closed early\n", c->id);
+      exit(1);
+    }
+    c->latencies[i] = now_ns() - start;
+  }
+  close(fd);
+  return NULL;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <port> <num airports> [clients] [requests]\n", argv[0]);
+    return 1;
+  }
+  int num_clients = (argc > 3) ? atoi(argv[3]) : 8;
+  int requests = (argc > 4) ? atoi(argv[4]) : 5000;
+  size_t total = (size_t)num_clients * (size_t)requests;
+  double *latencies = calloc(total, sizeof(double));
+  client_t *clients = calloc((size_t)num_clients, sizeof(client_t));
+  pthread_t *tids = calloc((size_t)num_clients, sizeof(pthread_t));
+
+  double start = now_ns();
+  for (int i = 0; i < num_clients; i++) {
+    clients[i] = (client_t){i, argv[1], atoi(argv[2]), requests, &latencies[(size_t)i * (size_t)requests]};
+    pthread_create(&tids[i], NULL, client_routine, &clients[i]);
+  }
+  for (int i = 0; i < num_clients; i++)
+    pthread_join(tids[i], NULL);
+  double elapsed = (now_ns() - start) / 1e9;
+
+  qsort(latencies, total, sizeof(double), compare_doubles);
+  printf("%d clients x %d requests: %.0f req/s, p50 %.1f us, p99 %.1f us\n", num_clients,
+         requests, (double)total / elapsed, latencies[total / 2] / 1e3,
+         latencies[total * 99 / 100] / 1e3);
+  return 0;
+}
@@ -0,0 +1,96 @@
+/** Benchmark of request line parsing.
+ *
+ *  Parses a mix of valid and invalid request lines with the `sscanf` code the
+ *  servers used before (`"%19s %d %d %d %d %d"` plus the command checks) and
+ *  with `wire_parse_request`, checks that both accept the same lines with the
+ *  same arguments, and reports the throughput of each.
+ *
+ *  Usage: ./bench/parse [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/airport.h"
+
+static const char *lines[] = {
+    "SCHEDULE 3 123456 10 2 30\n",
+    "SCHEDULE 12 98765 40 4 5\n",
+    "PLANE_STATUS 3 123456\n",
+    "PLANE_STATUS 12 98765\n",
+    "PLANE_STATUS 7 4242\n",
+    "TIME_STATUS 3 5 0 47\n",
+    "TIME_STATUS 12 0 20 4\n",
+    "SCHEDULE 3 123456 10 2\n",
+    "PLANE_STATUS 3 123456 7\n",
+    "SCHEDULEX 3 1 2 3 4\n",
+    "  PLANE_STATUS\t1  77 \n",
+    "HELLO\n",
+};
+
+#define NUM_LINES (sizeof(lines) / sizeof(lines[0]))
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/** The previous parser: returns 0 and fills in `req` if the line is valid. */
+static int parse_sscanf(const char *line, wire_request_t *req) {
+  char command[20];
+  int args[5], toks_cnt;
+
+  toks_cnt = sscanf(line, "%19s %d %d %d %d %d", command, &args[0], &args[1], &args[2],
+                    &args[3], &args[4]);
+  memset(req, 0, sizeof(wire_request_t));
+  if (strcmp(command, "SCHEDULE") == 0 && toks_cnt == 6)
+    req->type = WIRE_SCHEDULE;
+  else if (strcmp(command, "PLANE_STATUS") == 0 && toks_cnt == 3)
+    req->type = WIRE_PLANE_STATUS;
+  else if (strcmp(command, "TIME_STATUS") == 0 && toks_cnt == 5)
+    req->type = WIRE_TIME_STATUS;
+  else
+    return -1;
+  memcpy(req->args, args, (size_t)(toks_cnt - 1) * sizeof(int));
+  return 0;
+}
+
+/** Parses a NUL-terminated line with `wire_parse_request`. */
+static int parse_wire(const char *line, wire_request_t *req) {
+  return wire_parse_request(line, strlen(line), req);
+}
+
+static double run(int (*parse)(const char *, wire_request_t *), long iterations) {
+  wire_request_t req;
+  long valid = 0;
+  double start = now_ns();
+  for (long i = 0; i < iterations; i++) {
+    if (parse(lines[(size_t)i % NUM_LINES], &req) == 0)
+      valid += req.args[1];
+  }
+  double elapsed = now_ns() - start;
+  if (valid == 42)
+    printf("\n"); // Keep the results alive
+  return (double)iterations / elapsed * 1e3;
+}
+
+int main(int argc, char *argv[]) {
+  long iterations = (argc > 1) ? atol(argv[1]) : 2000000;
+  wire_request_t a, b;
+  double old_rate, new_rate;
+
+  for (size_t i = 0; i < NUM_LINES; i++) {
+    int ra = parse_sscanf(lines[i], &a), rb = parse_wire(lines[i], &b);
+    if (ra != rb || (ra == 0 && memcmp(&a, &b, sizeof(a)) != 0)) {
+      fprintf(stderr, "parsers disagree on: %s", lines[i]);
+      return 1;
+    }
+  }
+
+  old_rate = run(parse_sscanf, iterations);
+  new_rate = run(parse_wire, iterations);
+  printf("sscanf             %8.2f M lines/s\n", old_rate);
+  printf("wire_parse_request %8.2f M lines/s (%.1fx)\n", new_rate, new_rate / old_rate);
+  return 0;
+}
@@ -0,0 +1,57 @@
+/** Benchmark for PLANE_STATUS lookups as the number of gates grows.
+ *
+ *  Every gate is filled with 4-slot bookings, then random scheduled and
+ *  unscheduled plane ids are looked up both through the plane index
+ *  (`lookup_plane_in_airport`) and by scanning the gates in order
+ *  (`scan_plane_in_airport`).
+ *
+ *  Usage: ./bench/plane_status [lookups]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/airport.h"
+
+#define BOOKING_LEN 4
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static double run(time_info_t (*lookup)(int), int num_planes, long lookups) {
+  unsigned seed = 42;
+  volatile int sink = 0;
+  double start = now_ns();
+  for (long i = 0; i < lookups; i++) {
+    // Half of the queries are for planes that were never scheduled
+    int plane_id = rand_r(&seed) % (2 * num_planes);
+    sink += lookup(plane_id).gate_number;
+  }
+  (void)sink;
+  return (double)lookups / ((now_ns() - start) / 1e9);
+}
+
+int main(int argc, char *argv[]) {
+  int gate_counts[] = {8, 64, 512, 4096};
+  long lookups = (argc > 1) ? atol(argv[1]) : 2000000;
+
+  printf("%8s %16s %16s\n", "gates", "index (req/s)", "scan (req/s)");
+  for (size_t i = 0; i < sizeof(gate_counts) / sizeof(gate_counts[0]); i++) {
+    int num_gates = gate_counts[i], plane_id = 0;
+    airport_t *airport = create_airport(num_gates);
+    attach_airport(0, airport);
+    for (int g = 0; g < num_gates; g++)
+      for (int slot = 0; slot + BOOKING_LEN <= NUM_TIME_SLOTS; slot += BOOKING_LEN)
+        add_plane_to_slots(get_gate_by_idx(g), plane_id++, slot, BOOKING_LEN - 1);
+
+    double indexed = run(lookup_plane_in_airport, plane_id, lookups);
+    // Scans get slow quickly, so scale their iteration count down
+    double scanned = run(scan_plane_in_airport, plane_id, lookups * 8 / num_gates + 1);
+    printf("%8d %16.0f %16.0f\n", num_gates, indexed, scanned);
+    destroy_airport(airport);
+  }
+  return 0;
+}
@@ -0,0 +1,236 @@
+/** Benchmark of the worker pool sizes.
+ *
+ *  Starts `./controller` (run from the repository root) with the event-loop
+ *  server (`-e`) and each pair of pool sizes (`-w` for the controller, `-W`
+ *  for each pool of each airport), then with the defaults derived from the
+ *  CPUs online, and reports for each:
+ *
+ *  - throughput of `clients` connections each sending SCHEDULE and
+ *    PLANE_STATUS requests one at a time to random airports;
+ *  - the most threads of the controller and its airports seen meanwhile;
+ *  - the threads left once the pools have been idle for a while, after the
+ *    workers started for the load have exited.
+ *
+ *  Usage: ./bench/pools [clients] [requests per client] [airports] [pinned]
+ *  e.g.   ./bench/pools 16 5000 4 1    (pinned: also run each with -C)
+ */
+#include <dirent.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include "../src/network_utils.h"
+#include "../src/scheduler.h"
+#include <pthread.h>
+
+#define GATES_PER_AIRPORT 64
+
+/* Clients done with their requests */
+static int FINISHED;
+
+typedef struct {
+  int id, num_airports, requests;
+  char *port;
+} client_t;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/** Sends `request` and reads the first line of its response into `response`
+ *  (`MAXLINE` bytes). */
+static int round_trip(int fd, rio_t *rio, char *request, char *response) {
+  return (rio_writen(fd, request, strlen(request)) < 0 ||
+          rio_readlineb(rio, response, MAXLINE) <= 0)
+             ? -1
+             : 0;
+}
+
+static void *client_routine(void *arg) {
+  client_t *c = arg;
+  char request[MAXLINE], response[MAXLINE];
+  unsigned seed = (unsigned)c->id + 1;
+  rio_t rio;
+  int fd = open_clientfd("localhost", c->port);
+
+  if (fd < 0) {
+    perror("open_clientfd");
+    exit(1);
+  }
+  rio_readinitb(&rio, fd);
+  for (int i = 0; i < c->requests; i++) {
+    int airport = rand_r(&seed) % c->num_airports, plane_id = c->id * 1000000 + i;
+    if (i % 2 == 0)
+      snprintf(request, MAXLINE, "SCHEDULE %d %d %d 0 47\n", airport, plane_id,
+               rand_r(&seed) % 48);
+    else
+      snprintf(request, MAXLINE, "PLANE_STATUS %d %d\n", airport, plane_id - 1);
+    if (round_trip(fd, &rio, request, response) < 0) {
+      fprintf(stderr, "client %d: connection closed early\n", c->id);
+      exit(1);
+    }
+  }
+  close(fd);
+  __atomic_add_fetch(&FINISHED, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+/** Reads the threads of `pid` from /proc, or returns 0. */
+static long proc_threads(pid_t pid) {
+  char path[64], line[256];
+  long threads = 0;
+  FILE *f;
+
+  snprintf(path, sizeof(path), "/proc/%d/status", pid);
+  if ((f = fopen(path, "r")) == NULL)
+    return 0;
+  while (fgets(line, sizeof(line), f)) {
+    if (strncmp(line, "Threads:", 8) == 0) {
+      threads = atol(line + 8);
+      break;
+    }
+  }
+  fclose(f);
+  return threads;
+}
+
+/** Adds up the threads of `pid` and its child processes. */
+static long count_threads(pid_t pid) {
+  char path[64], stat[512];
+  struct dirent *entry;
+  DIR *proc = opendir("/proc");
+  long threads = proc_threads(pid);
+  FILE *f;
+  int child, ppid;
+
+  while (proc && (entry = readdir(proc)) != NULL) {
+    if ((child = atoi(entry->d_name)) <= 0)
+      continue;
+    snprintf(path, sizeof(path), "/proc/%d/stat", child);
+    if ((f = fopen(path, "r")) == NULL)
+      continue;
+    // The parent's PID follows the command name (in parentheses) and state
+    if (fgets(stat, sizeof(stat), f) && sscanf(strrchr(stat, ')'), ") %*c %d", &ppid) == 1 &&
+        ppid == pid)
+      threads += proc_threads(child);
+    fclose(f);
+  }
+  if (proc)
+    closedir(proc);
+  return threads;
+}
+
+static void run(int controller_threads, int airport_threads, int pinned, int num_airports,
+                int port, int num_clients, int requests) {
+  char port_str[16], request[MAXLINE], response[MAXLINE], gates[MAXLINE], label[32];
+  char w[16], W[16], count[16], *argv[16];
+  long threads, peak = 0;
+  int argc = 0, fd = -1;
+  rio_t rio;
+  pid_t pid;
+
+  snprintf(port_str, sizeof(port_str), "%d", port);
+  snprintf(count, sizeof(count), "%d", num_airports);
+  snprintf(w, sizeof(w), "%d", controller_threads);
+  snprintf(W, sizeof(W), "%d", airport_threads);
+  gates[0] = '\0';
+  for (int i = 0; i < num_airports; i++)
+    snprintf(gates + strlen(gates), sizeof(gates) - strlen(gates), i ? ",%d" : "%d",
+             GATES_PER_AIRPORT);
+  argv[argc++] = "controller";
+  argv[argc++] = "-e";
+  argv[argc++] = "-p";
+  argv[argc++] = port_str;
+  argv[argc++] = "-n";
+  argv[argc++] = count;
+  if (controller_threads > 0) {
+    argv[argc++] = "-w";
+    argv[argc++] = w;
+    argv[argc++] = "-W";
+    argv[argc++] = W;
+  }
+  if (pinned)
+    argv[argc++] = "-C";
+  argv[argc++] = "--";
+  argv[argc++] = gates;
+  argv[argc] = NULL;
+
+  if ((pid = fork()) == 0) {
+    // In a process group of its own, so that its airports can be killed
+    // with it
+    setpgid(0, 0);
+    if (freopen("/dev/null", "w", stderr) == NULL)
+      exit(1);
+    execv("./controller", argv);
+    perror("execv ./controller");
+    exit(1);
+  }
+
+  // Started once the last airport answers through the controller
+  snprintf(request, MAXLINE, "PLANE_STATUS %d 0\n", num_airports - 1);
+  while (1) {
+    if (fd < 0 && (fd = open_clientfd("localhost", port_str)) >= 0)
+      rio_readinitb(&rio, fd);
+    if (fd >= 0 && round_trip(fd, &rio, request, response) == 0 &&
+        strncmp(response, "Error", 5) != 0)
+      break;
+    usleep(1000);
+  }
+  close(fd);
+
+  client_t *clients = calloc((size_t)num_clients, sizeof(client_t));
+  pthread_t *tids = calloc((size_t)num_clients, sizeof(pthread_t));
+  double start = now_ns();
+  FINISHED = 0;
+  for (int i = 0; i < num_clients; i++) {
+    clients[i] = (client_t){i, num_airports, requests, port_str};
+    pthread_create(&tids[i], NULL, client_routine, &clients[i]);
+  }
+  // Sample the threads while the clients run
+  while (__atomic_load_n(&FINISHED, __ATOMIC_ACQUIRE) < num_clients) {
+    if ((threads = count_threads(pid)) > peak)
+      peak = threads;
+    usleep(20000);
+  }
+  for (int i = 0; i < num_clients; i++)
+    pthread_join(tids[i], NULL);
+  double elapsed = (now_ns() - start) / 1e9;
+
+  // Idle for longer than workers wait before they exit
+  usleep((SCHED_IDLE_MS + 1000) * 1000);
+  threads = count_threads(pid);
+
+  if (controller_threads > 0)
+    snprintf(label, sizeof(label), "-w %d -W %d", controller_threads, airport_threads);
+  else
+    snprintf(label, sizeof(label), "default");
+  printf("%-14s %-7s %8.0f req/s  %5ld threads under load  %5ld idle\n", label,
+         pinned ? "pinned" : "", (double)num_clients * requests / elapsed, peak, threads);
+  fflush(stdout);
+
+  kill(-pid, SIGKILL);
+  waitpid(pid, NULL, 0);
+  free(clients);
+  free(tids);
+}
+
+int main(int argc, char *argv[]) {
+  int num_clients = (argc > 1) ? atoi(argv[1]) : 16;
+  int requests = (argc > 2) ? atoi(argv[2]) : 5000;
+  int num_airports = (argc > 3) ? atoi(argv[3]) : 4;
+  int pinned = (argc > 4) ? atoi(argv[4]) : 0;
+  int sizes[][2] = {{1, 2}, {2, 2}, {4, 4}, {8, 8}, {16, 16}, {32, 32}, {0, 0}};
+  int port = 21000;
+
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    for (int pin = 0; pin <= pinned; pin++) {
+      run(sizes[i][0], sizes[i][1], pin, num_airports, port, num_clients, requests);
+      port += num_airports + 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,117 @@
+/** Benchmark of the gate probing policies of `schedule_plane` under
+ *  contention.
+ *
+ *  8 to 64 threads schedule flights on one airport at once, each with a
+ *  random start time, a duration of 1-4 slots and fuel for the whole day,
+ *  until they have made enough requests between them to fill about three
+ *  quarters of its slots. This is repeated on fresh airports, and for each
+ *  policy (`-g first`, `rotate` and `least`) reports:
+ *
+ *  - schedules per second;
+ *  - the share of the requests that got a gate;
+ *  - how evenly the bookings are spread: the occupied slots of the fullest
+ *    gate against the average of all gates.
+ *
+ *  Usage: ./bench/probe [gates] [rounds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/airport.h"
+
+typedef struct {
+  int id;
+  long requests, scheduled;
+  double start, end;
+} worker_t;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Holds every worker until all of them have started */
+static pthread_barrier_t START;
+
+static void *worker_routine(void *arg) {
+  worker_t *w = arg;
+  unsigned seed = (unsigned)w->id + 1;
+
+  pthread_barrier_wait(&START);
+  w->start = now_ns();
+  for (long i = 0; i < w->requests; i++) {
+    time_info_t info =
+        schedule_plane(w->id * 1000000 + (int)i, rand_r(&seed) % NUM_TIME_SLOTS,
+                       rand_r(&seed) % 4, NUM_TIME_SLOTS);
+    if (info.gate_number >= 0)
+      w->scheduled++;
+  }
+  w->end = now_ns();
+  return NULL;
+}
+
+static void run(probe_policy_t policy, int num_threads, int num_gates, int rounds) {
+  const char *names[] = {"first", "rotate", "least"};
+  pthread_t *tids = calloc((size_t)num_threads, sizeof(pthread_t));
+  worker_t *workers = calloc((size_t)num_threads, sizeof(worker_t));
+  // Flights take 2.5 slots on average (a duration of 0-3, plus one)
+  long requests = (long)num_gates * NUM_TIME_SLOTS * 3 / 10 / num_threads;
+  long scheduled = 0, max_load = 0, total_load = 0;
+  double elapsed = 0;
+
+  PROBE_POLICY = policy;
+  for (int r = 0; r < rounds; r++) {
+    airport_t *airport = create_airport(num_gates);
+    attach_airport(0, airport);
+    pthread_barrier_init(&START, NULL, (unsigned)num_threads + 1);
+    for (int t = 0; t < num_threads; t++) {
+      workers[t] = (worker_t){r * num_threads + t, requests, 0, 0, 0};
+      pthread_create(&tids[t], NULL, worker_routine, &workers[t]);
+    }
+    pthread_barrier_wait(&START);
+    for (int t = 0; t < num_threads; t++)
+      pthread_join(tids[t], NULL);
+    pthread_barrier_destroy(&START);
+
+    // From the first worker starting to the last one finishing
+    double start = workers[0].start, end = workers[0].end;
+    for (int t = 0; t < num_threads; t++) {
+      scheduled += workers[t].scheduled;
+      start = (workers[t].start < start) ? workers[t].start : start;
+      end = (workers[t].end > end) ? workers[t].end : end;
+    }
+    elapsed += (end - start) / 1e9;
+    for (int g = 0; g < num_gates; g++) {
+      long load = __builtin_popcountll(airport->occupancy[g]);
+      total_load += load;
+      if (load > max_load)
+        max_load = load;
+    }
+    destroy_airport(airport);
+  }
+
+  long total = requests * num_threads * rounds;
+  double average = (double)total_load / num_gates / rounds;
+  printf("%-6s %3d threads  %10.0f schedules/s  %5.1f%% scheduled  fullest gate %4.2fx the "
+         "average\n",
+         names[policy], num_threads, (double)total / elapsed,
+         100.0 * (double)scheduled / (double)total, average > 0 ? (double)max_load / average : 0);
+  fflush(stdout);
+  free(tids);
+  free(workers);
+}
+
+int main(int argc, char *argv[]) {
+  int num_gates = (argc > 1) ? atoi(argv[1]) : 256;
+  int rounds = (argc > 2) ? atoi(argv[2]) : 200;
+  probe_policy_t policies[] = {PROBE_FIRST, PROBE_ROTATE, PROBE_LEAST_LOADED};
+
+  printf("%d gates, %d rounds\n", num_gates, rounds);
+  for (int threads = 8; threads <= 64; threads *= 2) {
+    for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++)
+      run(policies[p], threads, num_gates, rounds);
+  }
+  return 0;
+}
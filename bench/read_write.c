@@ -0,0 +1,79 @@
+/** Benchmark for a mixed read/write load on one airport.
+ *
+ *  Worker threads issue reads (gate searches, plus a full-day TIME_STATUS
+ *  sweep for roughly one read in eight) and writes (SCHEDULE requests) at a
+ *  given read ratio. Each ratio runs against a fresh airport.
+ *
+ *  Usage: ./bench/read_write [threads] [ops per thread]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/airport.h"
+
+#define NUM_GATES 64
+
+typedef struct {
+  int id;
+  int read_pct;
+  long ops;
+} worker_t;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void *worker_routine(void *arg) {
+  worker_t *w = arg;
+  unsigned seed = (unsigned)w->id + 1;
+  char response[MAXBUF];
+  wire_response_t recs[WIRE_MAX_RECORDS];
+  int args[5];
+
+  for (long i = 0; i < w->ops; i++) {
+    int gate = rand_r(&seed) % NUM_GATES;
+    if (rand_r(&seed) % 100 < w->read_pct) {
+      if ((i & 7) == 0) {
+        args[1] = gate, args[2] = 0, args[3] = NUM_TIME_SLOTS - 1;
+        process_time_status(args, recs);
+        wire_format_text(recs, response, MAXBUF);
+      } else {
+        search_gate(get_gate_by_idx(gate), rand_r(&seed));
+      }
+    } else {
+      schedule_plane(w->id * 1000000 + (int)i, rand_r(&seed) % NUM_TIME_SLOTS, 0, 4);
+    }
+  }
+  return NULL;
+}
+
+int main(int argc, char *argv[]) {
+  int read_pcts[] = {50, 90, 99, 100};
+  int num_threads = (argc > 1) ? atoi(argv[1]) : 8;
+  long ops = (argc > 2) ? atol(argv[2]) : 200000;
+  pthread_t *tids = calloc((size_t)num_threads, sizeof(pthread_t));
+  worker_t *workers = calloc((size_t)num_threads, sizeof(worker_t));
+
+  printf("%d threads, %d gates\n", num_threads, NUM_GATES);
+  printf("%8s %14s\n", "reads", "ops/s");
+  for (size_t r = 0; r < sizeof(read_pcts) / sizeof(read_pcts[0]); r++) {
+    airport_t *airport = create_airport(NUM_GATES);
+    attach_airport(0, airport);
+    double start = now_ns();
+    for (int t = 0; t < num_threads; t++) {
+      workers[t] = (worker_t){t, read_pcts[r], ops};
+      pthread_create(&tids[t], NULL, worker_routine, &workers[t]);
+    }
+    for (int t = 0; t < num_threads; t++)
+      pthread_join(tids[t], NULL);
+    double elapsed = (now_ns() - start) / 1e9;
+    printf("%7d%% %14.0f\n", read_pcts[r], (double)num_threads * (double)ops / elapsed);
+    destroy_airport(airport);
+  }
+  free(tids);
+  free(workers);
+  return 0;
+}
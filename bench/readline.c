@@ -0,0 +1,121 @@
+/** Benchmark of buffered line reading.
+ *
+ *  Writes a file of request lines (with a few lines longer than `MAXLINE`,
+ *  and a last line without a newline), then reads it back with the previous
+ *  byte-at-a-time `rio_readlineb`, the current `memchr` based one, and the
+ *  zero-copy `rio_readlinep`. Checks that all three return the same lines,
+ *  and reports their throughput.
+ *
+ *  Usage: ./bench/readline [lines]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/network_utils.h"
+
+#define PATH "/tmp/readline_bench.txt"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/** The previous `rio_readlineb`, reading one byte at a time with `rio_readnb`
+ *  (which behaves like the internal `rio_read` for a single byte). */
+static ssize_t readline_bytewise(rio_t *rp, void *usrbuf, size_t maxlen) {
+  ssize_t n, rc;
+  char c, *bufp = usrbuf;
+
+  for (n = 1; n < (ssize_t)maxlen; n++) {
+    if ((rc = rio_readnb(rp, &c, 1)) == 1) {
+      *bufp++ = c;
+      if (c == '\n') {
+        n++;
+        break;
+      }
+    } else if (rc == 0) {
+      if (n == 1)
+        return 0; /* EOF, no data read */
+      else
+        break; /* EOF, some data was read */
+    } else
+      return -1; /* Error */
+  }
+  *bufp = 0;
+  return n - 1;
+}
+
+/** Reads the whole file with one of the readers, storing the time taken in
+ *  `*ns`. With `verify`, returns a checksum of the lines, each hashed with its
+ *  length so that the checksums only match if every line does; otherwise
+ *  only touches each line's first byte, so the timing is the reader's. */
+static unsigned long read_all(int mode, int verify, double *ns) {
+  char buf[MAXLINE], *line;
+  unsigned long sum = 0;
+  ssize_t n;
+  rio_t rio;
+  int fd = open(PATH, O_RDONLY);
+
+  rio_readinitb(&rio, fd);
+  double start = now_ns();
+  while (1) {
+    if (mode == 0)
+      n = readline_bytewise(&rio, buf, MAXLINE), line = buf;
+    else if (mode == 1)
+      n = rio_readlineb(&rio, buf, MAXLINE), line = buf;
+    else
+      n = rio_readlinep(&rio, &line, MAXLINE);
+    if (n <= 0)
+      break;
+    sum = sum * 31 + (unsigned long)n + (unsigned char)line[0];
+    for (ssize_t i = 0; verify && i < n; i++)
+      sum = sum * 131 + (unsigned char)line[i];
+  }
+  *ns = now_ns() - start;
+  close(fd);
+  return sum;
+}
+
+int main(int argc, char *argv[]) {
+  long num_lines = (argc > 1) ? atol(argv[1]) : 1000000;
+  const char *names[] = {"bytewise", "memchr", "zero-copy"};
+  unsigned long sums[3];
+  double ns[3];
+  FILE *f = fopen(PATH, "w");
+
+  if (f == NULL) {
+    perror("fopen");
+    return 1;
+  }
+  for (long i = 0; i < num_lines; i++) {
+    if (i % 100000 == 99999) {
+      for (int j = 0; j < 3 * MAXLINE; j++)
+        fputc('a' + j % 26, f);
+      fputc('\n', f);
+    } else if (i % 3 == 0) {
+      fprintf(f, "SCHEDULE %ld %ld 10 2 30\n", i % 16, i);
+    } else {
+      fprintf(f, "PLANE_STATUS %ld %ld\n", i % 16, i);
+    }
+  }
+  fprintf(f, "PLANE_STATUS 0 1");
+  fclose(f);
+
+  for (int mode = 0; mode < 3; mode++) {
+    sums[mode] = read_all(mode, 1, &ns[mode]);
+    read_all(mode, 0, &ns[mode]);
+  }
+  unlink(PATH);
+
+  for (int mode = 0; mode < 3; mode++) {
+    if (sums[mode] != sums[0]) {
+      fprintf(stderr, "%s returned different lines\n", names[mode]);
+      return 1;
+    }
+    printf("%-10s %8.1f ns/line %6.1fx\n", names[mode], ns[mode] / (double)num_lines,
+           ns[0] / ns[mode]);
+  }
+  return 0;
+}
@@ -0,0 +1,174 @@
+/** Benchmark of the work-stealing scheduler against the single shared queue
+ *  it replaced (one mutex and two condition variables, kept here as it was).
+ *
+ *  Runs `tasks` small tasks (a few hundred nanoseconds of arithmetic, about
+ *  the cost of answering a PLANE_STATUS request) with 1, 2, 4, ... workers, in
+ *  two patterns:
+ *
+ *  - submit: one outside thread submits every task, as the accept loop and
+ *    the event loops do;
+ *  - spawn: the outside thread submits a few root tasks, and each task
+ *    submits two more from its worker until a tree of tasks is done, as a
+ *    worker that splits a connection's requests over the others does.
+ *
+ *  Reports the tasks completed per second of each queue.
+ *
+ *  Usage: ./bench/scheduler [max workers] [tasks]
+ */
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/scheduler.h"
+
+#define SPAWN_DEPTH 9 /* Each root task makes a tree of 2^10 - 1 tasks */
+#define STOP ((void *)1)
+
+/* The shared queue as it was before the scheduler replaced it */
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t slots, items;
+  int front, rear, count, n;
+  void **items_buf;
+} shared_queue_t;
+
+static void init_shared_queue(shared_queue_t *s_que, int n) {
+  s_que->n = n;
+  s_que->count = 0;
+  s_que->front = s_que->rear = 0;
+  s_que->items_buf = calloc((size_t)n, sizeof(void *));
+  pthread_mutex_init(&s_que->lock, NULL);
+  pthread_cond_init(&s_que->slots, NULL);
+  pthread_cond_init(&s_que->items, NULL);
+}
+
+static void deinit_shared_queue(shared_queue_t *s_que) {
+  free(s_que->items_buf);
+  pthread_mutex_destroy(&s_que->lock);
+  pthread_cond_destroy(&s_que->slots);
+  pthread_cond_destroy(&s_que->items);
+}
+
+static void add_item(shared_queue_t *s_que, void *item) {
+  pthread_mutex_lock(&s_que->lock);
+  while (s_que->count == s_que->n)
+    pthread_cond_wait(&s_que->slots, &s_que->lock);
+  s_que->items_buf[s_que->rear] = item;
+  s_que->rear = (s_que->rear + 1) % s_que->n;
+  s_que->count++;
+  pthread_cond_signal(&s_que->items);
+  pthread_mutex_unlock(&s_que->lock);
+}
+
+static void *get_item(shared_queue_t *s_que) {
+  void *item;
+  pthread_mutex_lock(&s_que->lock);
+  while (s_que->count == 0)
+    pthread_cond_wait(&s_que->items, &s_que->lock);
+  item = s_que->items_buf[s_que->front];
+  s_que->front = (s_que->front + 1) % s_que->n;
+  s_que->count--;
+  pthread_cond_signal(&s_que->slots);
+  pthread_mutex_unlock(&s_que->lock);
+  return item;
+}
+
+typedef struct {
+  int use_scheduler, num_workers;
+  long total, done;
+  shared_queue_t queue;
+  scheduler_t sched;
+} bench_t;
+
+static void submit(bench_t *b, void *item) {
+  if (b->use_scheduler)
+    scheduler_submit(&b->sched, item);
+  else
+    add_item(&b->queue, item);
+}
+
+/* Tasks are stored as their remaining depth plus two, clear of NULL and STOP */
+static void *make_task(int depth) { return (void *)(intptr_t)(depth + 2); }
+
+static volatile unsigned SINK;
+
+static void *worker_routine(void *arg) {
+  bench_t *b = arg;
+  void *item;
+
+  while ((item = b->use_scheduler ? scheduler_take(&b->sched) : get_item(&b->queue)) != STOP) {
+    int depth = (int)(intptr_t)item - 2;
+    unsigned x = (unsigned)depth;
+
+    if (depth > 0) {
+      submit(b, make_task(depth - 1));
+      submit(b, make_task(depth - 1));
+    }
+    for (int i = 0; i < 256; i++)
+      x = x * 1103515245u + 12345u;
+    SINK = x;
+    // The last task to finish lets every worker go
+    if (__atomic_add_fetch(&b->done, 1, __ATOMIC_RELAXED) == b->total) {
+      for (int i = 0; i < b->num_workers; i++)
+        submit(b, STOP);
+    }
+  }
+  return NULL;
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static double run(int use_scheduler, int spawn, int num_workers, long tasks) {
+  long tree = (1L << (SPAWN_DEPTH + 1)) - 1, roots = spawn ? (tasks + tree - 1) / tree : tasks;
+  pthread_t *tids = calloc((size_t)num_workers, sizeof(pthread_t));
+  bench_t b = {use_scheduler, num_workers, spawn ? roots * tree : tasks, 0};
+  // Room for every task at once, so that workers spawning tasks never block
+  int capacity = (int)b.total + num_workers;
+
+  if (use_scheduler) {
+    if (scheduler_init(&b.sched, num_workers, capacity) < 0) {
+      perror("scheduler_init");
+      exit(1);
+    }
+  } else {
+    init_shared_queue(&b.queue, capacity);
+  }
+
+  double start = now_ns();
+  for (int i = 0; i < num_workers; i++)
+    pthread_create(&tids[i], NULL, worker_routine, &b);
+  for (long i = 0; i < roots; i++)
+    submit(&b, make_task(spawn ? SPAWN_DEPTH : 0));
+  for (int i = 0; i < num_workers; i++)
+    pthread_join(tids[i], NULL);
+  double elapsed = (now_ns() - start) / 1e9;
+
+  if (use_scheduler)
+    scheduler_deinit(&b.sched);
+  else
+    deinit_shared_queue(&b.queue);
+  free(tids);
+  return (double)b.total / elapsed;
+}
+
+int main(int argc, char *argv[]) {
+  int max_workers = (argc > 1) ? atoi(argv[1]) : 64;
+  long tasks = (argc > 2) ? atol(argv[2]) : 1000000;
+  const char *patterns[] = {"submit", "spawn"};
+
+  for (int spawn = 0; spawn < 2; spawn++) {
+    for (int workers = 1; workers <= max_workers; workers *= 2) {
+      double queue = run(0, spawn, workers, tasks), sched = run(1, spawn, workers, tasks);
+      printf("%-6s %3d workers  shared queue %10.0f tasks/s  scheduler %10.0f tasks/s  (%.2fx)\n",
+             patterns[spawn], workers, queue, sched, sched / queue);
+      fflush(stdout);
+    }
+  }
+  return 0;
+}
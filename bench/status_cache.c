@@ -0,0 +1,177 @@
+/** Benchmark of the controller's response cache (-c) under a dashboard-like
+ *  load.
+ *
+ *  Starts `./controller` (run from the repository root) with one airport of
+ *  1024 gates, and has `clients` connections each send `requests` requests,
+ *  one at a time: PLANE_STATUS of one of 64 planes, TIME_STATUS of the whole
+ *  day of one of the first 16 gates, and one SCHEDULE in every `write every`
+ *  requests. Each SCHEDULE changes the PLANE_STATUS responses, and those of
+ *  the gate it lands in; with `-g rotate` (unless the options say otherwise),
+ *  they land all over the airport. This is run without the cache, then with
+ *  it, each against a fresh controller. Reports requests per second, the
+ *  average round trip, and the controller's CACHE_STATUS.
+ *
+ *  Usage: ./bench/status_cache [clients] [requests] [write every]
+ *                              [controller options...]
+ *  e.g.   ./bench/status_cache 4 50000 100 -t shm
+ */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include "../src/network_utils.h"
+#include <pthread.h>
+
+#define NUM_GATES "1024"
+
+typedef struct {
+  int id, requests, write_every;
+  char *port;
+} client_t;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/** Sends `request` and reads its response: `lines` lines. */
+static int round_trip(int fd, rio_t *rio, char *request, int lines) {
+  char response[MAXLINE];
+  if (rio_writen(fd, request, strlen(request)) < 0)
+    return -1;
+  for (int i = 0; i < lines; i++) {
+    if (rio_readlineb(rio, response, MAXLINE) <= 0)
+      return -1;
+  }
+  return 0;
+}
+
+static void *client_routine(void *arg) {
+  client_t *c = arg;
+  char request[MAXLINE];
+  unsigned seed = (unsigned)c->id + 1;
+  int lines, planes = 0;
+  rio_t rio;
+  int fd = open_clientfd("localhost", c->port);
+
+  if (fd < 0) {
+    perror("open_clientfd");
+    exit(1);
+  }
+  rio_readinitb(&rio, fd);
+  for (int i = 0; i < c->requests; i++) {
+    if (i % c->write_every == c->write_every - 1) {
+      // Flights of one slot, so that the airport does not fill up
+      snprintf(request, MAXLINE, "SCHEDULE 0 %d %d 0 47\n", c->id * 1000000 + planes++,
+               rand_r(&seed) % 48);
+      lines = 1;
+    } else if (rand_r(&seed) % 2) {
+      snprintf(request, MAXLINE, "PLANE_STATUS 0 %d\n", rand_r(&seed) % 64);
+      lines = 1;
+    } else {
+      snprintf(request, MAXLINE, "TIME_STATUS 0 %d 0 47\n", rand_r(&seed) % 16);
+      lines = 48;
+    }
+    if (round_trip(fd, &rio, request, lines) < 0) {
+      fprintf(stderr, "client %d: connection closed early\n", c->id);
+      exit(1);
+    }
+  }
+  close(fd);
+  return NULL;
+}
+
+static void run(const char *cache, int port, int num_clients, int requests, int write_every,
+                char **options, int num_options) {
+  char port_str[16], response[MAXLINE], *argv[32];
+  int argc = 0, fd;
+  rio_t rio;
+  pid_t pid;
+
+  snprintf(port_str, sizeof(port_str), "%d", port);
+  argv[argc++] = "controller";
+  argv[argc++] = "-p";
+  argv[argc++] = port_str;
+  argv[argc++] = "-n";
+  argv[argc++] = "1";
+  argv[argc++] = "-g";
+  argv[argc++] = "rotate";
+  if (cache) {
+    argv[argc++] = "-c";
+    argv[argc++] = (char *)cache;
+  }
+  for (int i = 0; i < num_options && argc < 28; i++)
+    argv[argc++] = options[i];
+  argv[argc++] = "--";
+  argv[argc++] = NUM_GATES;
+  argv[argc] = NULL;
+
+  if ((pid = fork()) == 0) {
+    // In a process group of its own, so that its airports can be killed
+    // with it
+    setpgid(0, 0);
+    if (freopen("/dev/null", "w", stderr) == NULL)
+      exit(1);
+    execv("./controller", argv);
+    perror("execv ./controller");
+    exit(1);
+  }
+
+  // Started once the airport answers through the controller
+  while (1) {
+    if ((fd = open_clientfd("localhost", port_str)) >= 0) {
+      rio_readinitb(&rio, fd);
+      if (rio_writen(fd, "PLANE_STATUS 0 0\n", 17) == 17 &&
+          rio_readlineb(&rio, response, MAXLINE) > 0 && strncmp(response, "Error", 5) != 0) {
+        close(fd);
+        break;
+      }
+      close(fd);
+    }
+    usleep(1000);
+  }
+
+  client_t *clients = calloc((size_t)num_clients, sizeof(client_t));
+  pthread_t *tids = calloc((size_t)num_clients, sizeof(pthread_t));
+  double start = now_ns();
+  for (int i = 0; i < num_clients; i++) {
+    clients[i] = (client_t){i, requests, write_every, port_str};
+    pthread_create(&tids[i], NULL, client_routine, &clients[i]);
+  }
+  for (int i = 0; i < num_clients; i++)
+    pthread_join(tids[i], NULL);
+  double elapsed = now_ns() - start;
+
+  printf("%-14s %10.0f requests/s  %8.1f us per request\n", cache ? "cached" : "uncached",
+         (double)num_clients * requests / (elapsed / 1e9),
+         elapsed / 1e3 * num_clients / ((double)num_clients * requests));
+  if (cache && (fd = open_clientfd("localhost", port_str)) >= 0) {
+    rio_readinitb(&rio, fd);
+    if (rio_writen(fd, "CACHE_STATUS\n", 13) == 13 && rio_readlineb(&rio, response, MAXLINE) > 0)
+      printf("  %s", response);
+    close(fd);
+  }
+  fflush(stdout);
+
+  kill(-pid, SIGKILL);
+  waitpid(pid, NULL, 0);
+  free(clients);
+  free(tids);
+}
+
+int main(int argc, char *argv[]) {
+  int num_clients = (argc > 1) ? atoi(argv[1]) : 4;
+  int requests = (argc > 2) ? atoi(argv[2]) : 50000;
+  int write_every = (argc > 3) ? atoi(argv[3]) : 100;
+  char **options = argv + 4;
+  int num_options = (argc > 4) ? argc - 4 : 0;
+
+  if (write_every < 1)
+    write_every = 1;
+  run(NULL, 23000, num_clients, requests, write_every, options, num_options);
+  run("1024", 23002, num_clients, requests, write_every, options, num_options);
+  return 0;
+}
@@ -0,0 +1,136 @@
+/** Benchmark of TIME_STATUS response generation.
+ *
+ *  Answers full-day TIME_STATUS requests on a busy airport three ways: the
+ *  original `snprintf` + `strcat` onto an 8 KB status string, rendering the
+ *  records into a `MAXBUF` staging buffer that is then copied into the
+ *  connection's output buffer, and rendering them in place at the output
+ *  cursor (`wire_write_text`). Checks that all three produce the same bytes,
+ *  and reports their cost. Then streams whole-airport AIRPORT_STATUS dumps,
+ *  which no `MAXBUF` sized response could hold.
+ *
+ *  The output buffer is flushed to a sink that only counts (or, to check the
+ *  output, hashes) the bytes, so only the generation is timed.
+ *
+ *  Usage: ./bench/time_status [gates] [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/airport.h"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+typedef struct {
+  int verify;
+  unsigned long bytes, sum;
+} sink_t;
+
+static ssize_t sink_write(void *ctx, const void *buf, size_t n) {
+  sink_t *s = ctx;
+  const unsigned char *p = buf;
+  for (size_t i = 0; s->verify && i < n; i++)
+    s->sum = s->sum * 131 + p[i];
+  s->bytes += n;
+  return (ssize_t)n;
+}
+
+/** The original: each line is formatted on its own and appended with
+ *  `strcat`, which rescans the whole status string every time. */
+static void strcat_time_status(const int32_t *args, wio_t *out) {
+  char status_str[MAXBUF], line[MAXLINE];
+  time_slot_t slots[NUM_TIME_SLOTS];
+  gate_t *gate = get_gate_by_idx(args[1]);
+
+  read_time_slots(gate, args[2], args[2] + args[3], slots);
+  status_str[0] = '\0';
+  for (int i = args[2]; i <= args[2] + args[3]; i++) {
+    time_slot_t *slot = &slots[i - args[2]];
+    int occupied = (slot->status == 1);
+    snprintf(line, MAXLINE, "AIRPORT %d GATE %d %02d:%02d: %c - %d\n", args[0], args[1],
+             (int)IDX_TO_HOUR(i), (int)IDX_TO_MINS(i), occupied ? 'A' : 'F',
+             occupied ? slot->plane_id : 0);
+    strcat(status_str, line);
+  }
+  wio_writen(out, status_str, strlen(status_str));
+}
+
+/** Records rendered into a staging buffer, then copied to the output. */
+static void staged_time_status(const int32_t *args, wio_t *out) {
+  wire_response_t recs[WIRE_MAX_RECORDS];
+  char response[MAXBUF];
+  process_time_status(args, recs);
+  wire_format_text(recs, response, MAXBUF);
+  wio_writen(out, response, strlen(response));
+}
+
+/** Records rendered in place at the output cursor. */
+static void cursor_time_status(const int32_t *args, wio_t *out) {
+  wire_response_t recs[WIRE_MAX_RECORDS];
+  process_time_status(args, recs);
+  wire_write_text(recs, out);
+}
+
+static double run(void (*answer)(const int32_t *, wio_t *), int num_gates, long iterations,
+                  int verify, unsigned long *sum) {
+  sink_t sink = {verify, 0, 0};
+  wio_t out;
+  int32_t args[4] = {0, 0, 0, NUM_TIME_SLOTS - 1};
+
+  wio_init_sink(&out, sink_write, &sink, 0);
+  double start = now_ns();
+  for (long i = 0; i < iterations; i++) {
+    args[1] = (int32_t)(i % num_gates);
+    answer(args, &out);
+  }
+  wio_flush(&out);
+  double elapsed = now_ns() - start;
+  *sum = sink.sum;
+  return elapsed / (double)iterations;
+}
+
+int main(int argc, char *argv[]) {
+  int num_gates = (argc > 1) ? atoi(argv[1]) : 1024;
+  long iterations = (argc > 2) ? atol(argv[2]) : 200000;
+  const char *names[] = {"strcat", "staged", "cursor"};
+  void (*answers[])(const int32_t *, wio_t *) = {strcat_time_status, staged_time_status,
+                                                 cursor_time_status};
+  unsigned long sums[3], ignored;
+  double ns[3];
+  unsigned seed = 1;
+
+  attach_airport(0, create_airport(num_gates));
+  for (int i = 0; i < num_gates * 16; i++)
+    schedule_plane(i, rand_r(&seed) % NUM_TIME_SLOTS, rand_r(&seed) % 4, 8);
+
+  printf("TIME_STATUS, %d slots, %d gates\n", NUM_TIME_SLOTS, num_gates);
+  for (int m = 0; m < 3; m++) {
+    run(answers[m], num_gates, num_gates, 1, &sums[m]);
+    ns[m] = run(answers[m], num_gates, iterations, 0, &ignored);
+    if (sums[m] != sums[0]) {
+      fprintf(stderr, "%s produced different output\n", names[m]);
+      return 1;
+    }
+    printf("%-8s %8.0f ns/response %6.2fx\n", names[m], ns[m], ns[0] / ns[m]);
+  }
+
+  // Whole-airport dumps, streamed one gate at a time
+  sink_t sink = {0, 0, 0};
+  wio_t out;
+  int32_t args[3] = {0, 0, -1};
+  int dumps = (int)(iterations / num_gates) + 1;
+
+  wio_init_sink(&out, sink_write, &sink, 0);
+  double start = now_ns();
+  for (int i = 0; i < dumps; i++)
+    process_airport_status(args, &out);
+  wio_flush(&out);
+  double elapsed = now_ns() - start;
+  printf("AIRPORT_STATUS dump: %lu bytes, %.2f ms each, %.0f MB/s\n",
+         sink.bytes / (unsigned long)dumps, elapsed / 1e6 / dumps, (double)sink.bytes / elapsed * 1e3);
+  return 0;
+}
@@ -0,0 +1,162 @@
+/** Benchmark of the controller-to-airport hop over each transport.
+ *
+ *  Forks one airport node with a shared-memory link, so that it serves both
+ *  loopback TCP connections and its shared-memory channels (`-t shm`), and two
+ *  more listening on Unix domain sockets (`-t unix` and `-t seqpacket`). Then
+ *  drives them the way the controller's workers do: `clients` threads each
+ *  send one PLANE_STATUS request at a time and wait for its response. Reports
+ *  the throughput and the p50/p99 round-trip latency of each transport.
+ *
+ *  Usage: ./bench/transport [clients] [requests per client]
+ */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include "../src/airport.h"
+
+#define PORT "4995"
+#define UNIX_PATH "/tmp/atc-bench-unix.sock"
+#define SEQPACKET_PATH "/tmp/atc-bench-seqpacket.sock"
+
+typedef struct {
+  int id, requests;
+  const sock_addr_t *addr; /* NULL for the shared-memory link */
+  shm_endpoint_t *ep;
+  double *latencies;
+} client_t;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static void *client_routine(void *arg) {
+  client_t *c = arg;
+  char request[MAXLINE], *line;
+  int fd = -1, idx = -1, len;
+  rio_t tcp_rio, *rio = &tcp_rio;
+  ssize_t n;
+
+  if (c->addr == NULL) {
+    idx = shm_endpoint_acquire(c->ep);
+    rio = &c->ep->rio[idx];
+  } else {
+    // The airport may still be starting up
+    for (int tries = 0; (fd = open_addr_clientfd(c->addr)) < 0 && tries < 100; tries++)
+      usleep(10000);
+    if (fd < 0) {
+      perror("open_addr_clientfd");
+      exit(1);
+    }
+    rio_readinitb(rio, fd);
+  }
+
+  for (int i = 0; i < c->requests; i++) {
+    len = snprintf(request, MAXLINE, "PLANE_STATUS 0 %d\n", c->id * 1000000 + i);
+    double start = now_ns();
+    if (c->addr == NULL)
+      shm_ring_write(&c->ep->link->channels[idx].requests, request, (size_t)len);
+    else
+      rio_writen(fd, request, (size_t)len);
+    // Each response ends with an empty line
+    while ((n = rio_readlinep(rio, &line, MAXLINE)) > 0 && !(n == 1 && line[0] == '\n'))
+      ;
+    if (n <= 0) {
+      fprintf(stderr, "client %d: connection closed early\n", c->id);
+      exit(1);
+    }
+    c->latencies[i] = now_ns() - start;
+  }
+  if (c->addr == NULL)
+    shm_endpoint_release(c->ep, idx);
+  else
+    close(fd);
+  return NULL;
+}
+
+static void run(const char *name, const sock_addr_t *addr, shm_endpoint_t *ep, int num_clients,
+                int requests) {
+  client_t *clients = calloc((size_t)num_clients, sizeof(client_t));
+  pthread_t *tids = calloc((size_t)num_clients, sizeof(pthread_t));
+  double *latencies = calloc((size_t)num_clients * (size_t)requests, sizeof(double));
+  size_t total = (size_t)num_clients * (size_t)requests;
+
+  double start = now_ns();
+  for (int i = 0; i < num_clients; i++) {
+    clients[i] = (client_t){i, requests, addr, ep, latencies + (size_t)i * (size_t)requests};
+    pthread_create(&tids[i], NULL, client_routine, &clients[i]);
+  }
+  for (int i = 0; i < num_clients; i++)
+    pthread_join(tids[i], NULL);
+  double elapsed = (now_ns() - start) / 1e9;
+
+  qsort(latencies, total, sizeof(double), compare_doubles);
+  printf("%-9s %3d clients %9.0f req/s  p50 %7.1f us  p99 %7.1f us\n", name, num_clients,
+         (double)total / elapsed, latencies[total / 2] / 1e3, latencies[total * 99 / 100] / 1e3);
+  free(clients);
+  free(tids);
+  free(latencies);
+}
+
+int main(int argc, char *argv[]) {
+  int max_clients = (argc > 1) ? atoi(argv[1]) : SHM_LINK_CHANNELS;
+  int requests = (argc > 2) ? atoi(argv[2]) : 20000;
+  const char *paths[] = {UNIX_PATH, SEQPACKET_PATH};
+  int socktypes[] = {SOCK_STREAM, SOCK_SEQPACKET};
+  sock_addr_t tcp_addr, unix_addrs[2];
+  shm_endpoint_t ep;
+  int listenfd;
+  pid_t pids[3];
+
+  if (max_clients < 1 || max_clients > SHM_LINK_CHANNELS) {
+    fprintf(stderr, "clients must be between 1 and %d\n", SHM_LINK_CHANNELS);
+    return 1;
+  }
+  if ((SHM_LINKS = shm_links_create(1)) == NULL || (listenfd = open_listenfd(PORT)) < 0 ||
+      resolve_inet_addr("localhost", PORT, &tcp_addr) < 0)
+    return 1;
+  if ((pids[0] = fork()) == 0) {
+    initialise_node(0, 16, listenfd);
+    exit(0);
+  }
+  close(listenfd);
+  shm_endpoint_init(&ep, &SHM_LINKS[0]);
+
+  // The Unix domain socket airports have no shared-memory link of their own
+  for (int i = 0; i < 2; i++) {
+    if ((listenfd = open_unix_listenfd(paths[i], socktypes[i])) < 0 ||
+        make_unix_addr(paths[i], socktypes[i], &unix_addrs[i]) < 0) {
+      perror("open_unix_listenfd");
+      return 1;
+    }
+    if ((pids[i + 1] = fork()) == 0) {
+      SHM_LINKS = NULL;
+      initialise_node(0, 16, listenfd);
+      exit(0);
+    }
+    close(listenfd);
+  }
+
+  for (int clients = 1; clients <= max_clients; clients *= 2) {
+    run("tcp", &tcp_addr, &ep, clients, requests);
+    run("unix", &unix_addrs[0], &ep, clients, requests);
+    run("seqpacket", &unix_addrs[1], &ep, clients, requests);
+    run("shm", NULL, &ep, clients, requests);
+  }
+  for (int i = 0; i < 3; i++) {
+    kill(pids[i], SIGKILL);
+    waitpid(pids[i], NULL, 0);
+  }
+  unlink(UNIX_PATH);
+  unlink(SEQPACKET_PATH);
+  return 0;
+}
@@ -0,0 +1,208 @@
+/** Benchmark of the windowed SCHEDULE mode (the controller's -B) against
+ *  placing each request as it arrives.
+ *
+ *  Starts `./controller` (run from the repository root) with one airport, and
+ *  has `clients` connections (32 by default) send requests through it, one at
+ *  a time: SCHEDULEs with an earliest start in one of a few banks of
+ *  arrivals, a duration of 1-4 slots and fuel for 0-15 slots of waiting,
+ *  each followed by a PLANE_STATUS of the plane, until about 20% more slots
+ *  were asked for than the airport has. This is repeated on fresh
+ *  controllers, placing each flight with the free-interval index
+ *  (`-g earliest`) as it arrives, and in windows of 0.2, 1 and 5 ms ordered
+ *  by fuel. For each, reports:
+ *
+ *  - the share of the flights that got a gate;
+ *  - requests answered per second, and flights accepted per second;
+ *  - p50 and p99 latency of SCHEDULE, and of PLANE_STATUS, which must not
+ *    wait for the windows.
+ *
+ *  Usage: ./bench/window [clients] [gates] [rounds] [controller options...]
+ *  e.g.   ./bench/window 32 16 5 -w 32
+ */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include "../src/network_utils.h"
+#include <pthread.h>
+
+/* Time slots in a gate's day, as in airport.h */
+#define NUM_TIME_SLOTS 48
+
+typedef struct {
+  int id, flights, scheduled;
+  char *port;
+  double *schedule_latencies, *status_latencies;
+} client_t;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/** Sends `request` and reads its one-line response into `response`, returning
+ *  how long that took in nanoseconds, or -1 if the connection failed. */
+static double round_trip(int fd, rio_t *rio, char *request, char *response) {
+  double start = now_ns();
+  if (rio_writen(fd, request, strlen(request)) < 0 || rio_readlineb(rio, response, MAXLINE) <= 0)
+    return -1;
+  return now_ns() - start;
+}
+
+static void *client_routine(void *arg) {
+  client_t *c = arg;
+  char request[MAXLINE], response[MAXLINE];
+  unsigned seed = (unsigned)c->id + 1;
+  rio_t rio;
+  int fd = open_clientfd("localhost", c->port);
+
+  if (fd < 0) {
+    perror("open_clientfd");
+    exit(1);
+  }
+  rio_readinitb(&rio, fd);
+  for (int i = 0; i < c->flights; i++) {
+    // Banks of arrivals: every 8 slots, all wanting the same 2 slots
+    int start = rand_r(&seed) % 6 * 8 + rand_r(&seed) % 2, duration = rand_r(&seed) % 4;
+    int fuel = rand_r(&seed) % 16, plane_id = c->id * 1000000 + i;
+
+    snprintf(request, MAXLINE, "SCHEDULE 0 %d %d %d %d\n", plane_id, start, duration, fuel);
+    c->schedule_latencies[i] = round_trip(fd, &rio, request, response);
+    if (strncmp(response, "SCHEDULED", 9) == 0)
+      c->scheduled++;
+    snprintf(request, MAXLINE, "PLANE_STATUS 0 %d\n", plane_id);
+    c->status_latencies[i] = round_trip(fd, &rio, request, response);
+    if (c->schedule_latencies[i] < 0 || c->status_latencies[i] < 0) {
+      fprintf(stderr, "client %d: connection closed early\n", c->id);
+      exit(1);
+    }
+  }
+  close(fd);
+  return NULL;
+}
+
+/** Starts a controller on `port` and waits until its airport answers. */
+static pid_t start_controller(char *port_str, const char *window, const char *gates,
+                              char **options, int num_options) {
+  char response[MAXLINE], *argv[32];
+  int argc = 0, fd;
+  rio_t rio;
+  pid_t pid;
+
+  argv[argc++] = "controller";
+  argv[argc++] = "-p";
+  argv[argc++] = port_str;
+  argv[argc++] = "-n";
+  argv[argc++] = "1";
+  argv[argc++] = "-g";
+  argv[argc++] = "earliest";
+  if (window) {
+    argv[argc++] = "-B";
+    argv[argc++] = (char *)window;
+  }
+  for (int i = 0; i < num_options && argc < 28; i++)
+    argv[argc++] = options[i];
+  argv[argc++] = "--";
+  argv[argc++] = (char *)gates;
+  argv[argc] = NULL;
+
+  if ((pid = fork()) == 0) {
+    // In a process group of its own, so that its airports can be killed
+    // with it
+    setpgid(0, 0);
+    if (freopen("/dev/null", "w", stderr) == NULL)
+      exit(1);
+    execv("./controller", argv);
+    perror("execv ./controller");
+    exit(1);
+  }
+
+  // Started once the airport answers through the controller
+  while (1) {
+    if ((fd = open_clientfd("localhost", port_str)) >= 0) {
+      rio_readinitb(&rio, fd);
+      if (rio_writen(fd, "PLANE_STATUS 0 0\n", 17) == 17 &&
+          rio_readlineb(&rio, response, MAXLINE) > 0 && strncmp(response, "Error", 5) != 0) {
+        close(fd);
+        break;
+      }
+      close(fd);
+    }
+    usleep(1000);
+  }
+  return pid;
+}
+
+static void run(const char *window, int port, int num_clients, int num_gates, int rounds,
+                char **options, int num_options) {
+  pthread_t *tids = calloc((size_t)num_clients, sizeof(pthread_t));
+  client_t *clients = calloc((size_t)num_clients, sizeof(client_t));
+  // Flights take 2.5 slots on average (a duration of 0-3, plus one)
+  int flights = num_gates * NUM_TIME_SLOTS * 12 / 25 / num_clients + 1;
+  long total = (long)flights * num_clients * rounds, scheduled = 0, n = 0;
+  double *schedule_latencies = calloc((size_t)total, sizeof(double));
+  double *status_latencies = calloc((size_t)total, sizeof(double)), elapsed = 0;
+  char port_str[16], gates[16], label[32];
+
+  snprintf(gates, sizeof(gates), "%d", num_gates);
+  for (int r = 0; r < rounds; r++) {
+    snprintf(port_str, sizeof(port_str), "%d", port + 2 * r);
+    pid_t pid = start_controller(port_str, window, gates, options, num_options);
+
+    double start = now_ns();
+    for (int i = 0; i < num_clients; i++) {
+      clients[i] = (client_t){r * num_clients + i, flights, 0, port_str,
+                              &schedule_latencies[n], &status_latencies[n]};
+      n += flights;
+      pthread_create(&tids[i], NULL, client_routine, &clients[i]);
+    }
+    for (int i = 0; i < num_clients; i++) {
+      pthread_join(tids[i], NULL);
+      scheduled += clients[i].scheduled;
+    }
+    elapsed += (now_ns() - start) / 1e9;
+
+    kill(-pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+  }
+
+  qsort(schedule_latencies, (size_t)n, sizeof(double), compare_doubles);
+  qsort(status_latencies, (size_t)n, sizeof(double), compare_doubles);
+  if (window)
+    snprintf(label, sizeof(label), "window %s ms", window);
+  else
+    snprintf(label, sizeof(label), "as they arrive");
+  printf("%-15s %5.1f%% scheduled  %8.0f requests/s  %8.0f accepted/s  "
+         "SCHEDULE p50 %7.1f us  p99 %7.1f us  PLANE_STATUS p50 %7.1f us  p99 %7.1f us\n",
+         label, 100.0 * (double)scheduled / (double)total, 2.0 * (double)total / elapsed,
+         (double)scheduled / elapsed, schedule_latencies[n / 2] / 1e3,
+         schedule_latencies[n * 99 / 100] / 1e3, status_latencies[n / 2] / 1e3,
+         status_latencies[n * 99 / 100] / 1e3);
+  fflush(stdout);
+  free(schedule_latencies);
+  free(status_latencies);
+  free(tids);
+  free(clients);
+}
+
+int main(int argc, char *argv[]) {
+  int num_clients = (argc > 1) ? atoi(argv[1]) : 32;
+  int num_gates = (argc > 2) ? atoi(argv[2]) : 16;
+  int rounds = (argc > 3) ? atoi(argv[3]) : 5;
+  const char *windows[] = {NULL, "0.2", "1", "5"};
+  char **options = argv + 4;
+  int num_options = (argc > 4) ? argc - 4 : 0;
+
+  printf("%d clients, %d gates, %d rounds\n", num_clients, num_gates, rounds);
+  for (size_t i = 0; i < sizeof(windows) / sizeof(windows[0]); i++)
+    run(windows[i], 25000 + 100 * (int)i, num_clients, num_gates, rounds, options, num_options);
+  return 0;
+}
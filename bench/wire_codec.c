@@ -0,0 +1,109 @@
+/** Benchmark of the text and binary encodings of requests and responses.
+ *
+ *  For each kind of request, measures the cost of one round of encoding work
+ *  as the hops see it: producing the request, parsing it on the other side,
+ *  formatting the response, and reading it back. The text round is
+ *  `snprintf` + `wire_parse_request` for the request and the text formatting
+ *  of the response; the binary round encodes and decodes the fixed-size
+ *  records.
+ *  Also reports the bytes each encoding puts on the wire. The airport's own
+ *  work (searching gates) is left out, since both encodings share it.
+ *
+ *  Usage: ./bench/wire_codec [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/airport.h"
+
+typedef struct {
+  const char *name;
+  wire_request_t req;
+  int slots; /* TIME_SLOT records in the response */
+} kind_t;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/** Fills in the response the airport would give to `kind`. */
+static int make_response(const kind_t *kind, wire_response_t *recs) {
+  const int32_t *a = kind->req.args;
+  if (kind->req.type == WIRE_TIME_STATUS) {
+    recs[0] = (wire_response_t){WIRE_TIME_STATUS, WIRE_OK, (uint16_t)kind->slots, {a[0], a[1], a[2], 0}};
+    for (int i = 1; i <= kind->slots; i++)
+      recs[i] = (wire_response_t){WIRE_TIME_SLOT, WIRE_OK, 0, {a[2] + i - 1, i & 1, (i & 1) ? 123456 : 0, 0}};
+    return 1 + kind->slots;
+  }
+  recs[0] = (wire_response_t){kind->req.type, WIRE_OK, 0, {a[1], 3, 30, 35}};
+  return 1;
+}
+
+/** Formats the text request line of `kind`, as a client would. */
+static int format_request(const kind_t *kind, char *buf) {
+  const int32_t *a = kind->req.args;
+  switch (kind->req.type) {
+  case WIRE_SCHEDULE:
+    return snprintf(buf, MAXLINE, "SCHEDULE %d %d %d %d %d\n", a[0], a[1], a[2], a[3], a[4]);
+  case WIRE_PLANE_STATUS:
+    return snprintf(buf, MAXLINE, "PLANE_STATUS %d %d\n", a[0], a[1]);
+  default:
+    return snprintf(buf, MAXLINE, "TIME_STATUS %d %d %d %d\n", a[0], a[1], a[2], a[3]);
+  }
+}
+
+static volatile long sink;
+
+static void run(const kind_t *kind, long iterations) {
+  wire_response_t recs[WIRE_MAX_RECORDS], decoded[WIRE_MAX_RECORDS];
+  uint8_t request[WIRE_REQUEST_SIZE], response[WIRE_MAX_RECORDS * WIRE_RESPONSE_SIZE];
+  char line[MAXLINE], text[MAXBUF];
+  int num_recs = make_response(kind, recs);
+  size_t text_req = 0, text_res = 0;
+  wire_request_t req;
+  double start, text_ns, binary_ns;
+
+  start = now_ns();
+  for (long i = 0; i < iterations; i++) {
+    text_req = (size_t)format_request(kind, line);
+    wire_parse_request(line, text_req, &req);
+    text_res = wire_format_text(recs, text, MAXBUF);
+    sink += req.args[1] + text[text_res - 2];
+  }
+  text_ns = (now_ns() - start) / (double)iterations;
+
+  start = now_ns();
+  for (long i = 0; i < iterations; i++) {
+    wire_encode_request(&kind->req, request);
+    wire_decode_request(request, &req);
+    for (int r = 0; r < num_recs; r++)
+      wire_encode_response(&recs[r], response + r * WIRE_RESPONSE_SIZE);
+    for (int r = 0; r < num_recs; r++)
+      wire_decode_response(response + r * WIRE_RESPONSE_SIZE, &decoded[r]);
+    sink += req.args[1] + decoded[num_recs - 1].values[0];
+  }
+  binary_ns = (now_ns() - start) / (double)iterations;
+
+  printf("%-16s %8.1f ns %8.1f ns %6.1fx %6zu B %5d B %6zu B %5d B\n", kind->name, text_ns,
+         binary_ns, text_ns / binary_ns, text_req, WIRE_REQUEST_SIZE, text_res,
+         num_recs * WIRE_RESPONSE_SIZE);
+}
+
+int main(int argc, char *argv[]) {
+  long iterations = (argc > 1) ? atol(argv[1]) : 1000000;
+  kind_t kinds[] = {
+      {"SCHEDULE", {WIRE_SCHEDULE, {12, 123456, 30, 5, 10}}, 0},
+      {"PLANE_STATUS", {WIRE_PLANE_STATUS, {12, 123456, 0, 0, 0}}, 0},
+      {"TIME_STATUS x4", {WIRE_TIME_STATUS, {12, 3, 30, 3, 0}}, 4},
+      {"TIME_STATUS x48", {WIRE_TIME_STATUS, {12, 3, 0, NUM_TIME_SLOTS - 1, 0}}, NUM_TIME_SLOTS},
+  };
+
+  printf("%-16s %11s %11s %7s %8s %7s %8s %7s\n", "", "text", "binary", "speedup", "text req",
+         "bin req", "text res", "bin res");
+  for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++)
+    run(&kinds[i], kinds[i].slots > 8 ? iterations / 10 : iterations);
+  return 0;
+}
@@ -226,6 +226,34 @@ run_test () {
   return $passed
 } 
 
+# Build and run a stress test program that checks its own results and exits
+# with a non-zero status on failure.
+run_stress_test () {
+  local testname=$1
+  local verbose=$2
+  local passed=1
+  local soutput=""
+
+  mkdir -p $OUTPUTDIR/$testname
+  printf "${BLUE}Running test ${BOLD}%-19s${NONE} " "${testname}:"
+
+  soutput=$(make tests/${testname} 2>&1 && ${TIMEOUT} ./tests/${testname} 2>&1)
+  if [ $? -ne 0 ]; then
+    passed=0
+    printf "${RED}failed!${NONE}\n"
+    echo "${soutput}" | tail -5 | sed 's/^/  - /'
+  else
+    printf "${GREEN}passed!${NONE}\n"
+  fi
+  echo "${soutput}" > $OUTPUTDIR/$testname/output
+
+  if [ "$verbose" == "1" ]; then
+    echo "${soutput}"
+  fi
+
+  return $passed
+}
+
 # Print usage information
 usage () {
   echo "usage: ./run_tests.sh [-h] [-v] [-n] [-t test]"
@@ -267,9 +295,24 @@ if [ "${test}" != "" ]; then
   ALL_TESTS=${test}
 else 
   BASIC_TESTS="basic-1 basic-2 basic-3 basic-4 basic-5 basic-6"
+  PARSE_TESTS="parse-1 parse-2"
   MULTI_TESTS="multi-1 multi-2"
   CONC_TESTS="concurrent-1 concurrent-2 concurrent-3"
-  ALL_TESTS="${BASIC_TESTS} ${MULTI_TESTS} ${CONC_TESTS}"
+  PIPE_TESTS="pipelined-1 pipelined-2"
+  REACTOR_TESTS="reactor-1 reactor-2 uring-1 uring-2"
+  BINARY_TESTS="binary-1 binary-2"
+  FLUSH_TESTS="flush-1 flush-2"
+  STREAM_TESTS="stream-1 stream-2 stream-3"
+  SHM_TESTS="shm-1 shm-2"
+  UNIX_TESTS="unix-1 unix-2 unix-3"
+  INPROC_TESTS="inproc-1 inproc-2 inproc-3"
+  POOL_TESTS="pools-1 pools-2"
+  GATE_TESTS="gates-1 gates-2"
+  BATCH_TESTS="batch-1 batch-2"
+  WINDOW_TESTS="window-1 window-2 window-3 window-4"
+  CACHE_TESTS="cache-1 cache-2"
+  STRESS_TESTS="stress_schedule"
+  ALL_TESTS="${BASIC_TESTS} ${PARSE_TESTS} ${MULTI_TESTS} ${CONC_TESTS} ${PIPE_TESTS} ${REACTOR_TESTS} ${BINARY_TESTS} ${FLUSH_TESTS} ${STREAM_TESTS} ${SHM_TESTS} ${UNIX_TESTS} ${INPROC_TESTS} ${POOL_TESTS} ${GATE_TESTS} ${BATCH_TESTS} ${WINDOW_TESTS} ${CACHE_TESTS} ${STRESS_TESTS}"
 fi
 
 # Timeout
@@ -291,7 +334,11 @@ mkdir -p ${OUTPUTDIR}
 (( tests_run = 0    ))
 (( tests_passed = 0 ))
 for t in $ALL_TESTS; do
-  run_test $t $verbose
+  if [ -f "${TESTDIR}/${t}.c" ]; then
+    run_stress_test $t $verbose
+  else
+    run_test $t $verbose
+  fi
   x=$?
   (( tests_run = $tests_run + 1 ))
   (( tests_passed = $tests_passed + $x ))
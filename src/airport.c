@@ -1,5 +1,7 @@
 #include "airport.h"
 
+#include <netinet/tcp.h>
+
 /** This is the main file in which you should implement the airport server code.
  *  There are many functions here which are pre-written for you. You should read
  *  the comments in the corresponding `airport.h` header file to understand what
@@ -12,13 +14,42 @@
  */
 
 /* This will be set by the `initialise_node` function. */
-static int AIRPORT_ID = -1;
+static int NODE_AIRPORT_ID = -1;
 
 /* This will be set by the `initialise_node` function. */
-static airport_t *AIRPORT_DATA = NULL;
+static airport_t *NODE_AIRPORT_DATA = NULL;
+
+/* The airport the calling thread has selected with `select_airport`, which
+ * takes the place of the process's own (with the controller's -t inproc). */
+static __thread int SELECTED_AIRPORT_ID = -1;
+static __thread airport_t *SELECTED_AIRPORT_DATA = NULL;
+
+#define AIRPORT_ID (SELECTED_AIRPORT_DATA ? SELECTED_AIRPORT_ID : NODE_AIRPORT_ID)
+#define AIRPORT_DATA (SELECTED_AIRPORT_DATA ? SELECTED_AIRPORT_DATA : NODE_AIRPORT_DATA)
+
+/* Hands connections from the controller to the workers */
+scheduler_t conn_scheduler;
+
+/* Hands pipelined requests to the request workers */
+scheduler_t request_scheduler;
+
+/* Set by the controller from its command line before the airports are forked. */
+server_mode_t SERVER_MODE = SERVER_THREADED;
+int FLUSH_EACH_RESPONSE = 0;
+shm_link_t *SHM_LINKS = NULL;
+uint64_t **SCHEDULE_VERSIONS = NULL;
+int AIRPORT_THREADS = 8;
+int AIRPORT_MIN_THREADS = 1;
+int NUM_AIRPORTS = 1;
+int PIN_AIRPORTS = 0;
+probe_policy_t PROBE_POLICY = PROBE_FIRST;
+int SCHEDULE_WINDOW_US = 0;
 
-/* Shared queue */
-shared_queue_t shared_queue;
+/* Event loops used in `SERVER_REACTOR` mode. */
+static reactor_t airport_reactor;
+
+static int park_schedule_frame(unsigned id, const char *request, pipelined_conn_t *pconn,
+                               reactor_conn_t *rconn);
 
 gate_t *get_gate_by_idx(int gate_idx) {
   if ((gate_idx) < 0 || (gate_idx > AIRPORT_DATA->num_gates))
@@ -27,6 +58,24 @@ gate_t *get_gate_by_idx(int gate_idx) {
     return &AIRPORT_DATA->gates[gate_idx];
 }
 
+/* Accessors for time slot fields, which seqlock readers may load while a
+ * writer is updating them. */
+#define SLOT_LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define SLOT_STORE(field, val) __atomic_store_n(&(field), (val), __ATOMIC_RELAXED)
+
+int set_time_slot(time_slot_t *ts, int plane_id, int start_idx, int end_idx) {
+  if (SLOT_LOAD(ts->status) == 1) {
+    return -1;
+  }
+  SLOT_STORE(ts->status, 1); /* Set to be occupied */
+  SLOT_STORE(ts->plane_id, plane_id);
+  SLOT_STORE(ts->start_time, start_idx);
+  SLOT_STORE(ts->end_time, end_idx);
+  return 0;
+}
+
+#ifndef COMPACT_GATES
+
 time_slot_t *get_time_slot_by_idx(gate_t *gate, int slot_idx) {
   if ((slot_idx < 0) || (slot_idx >= NUM_TIME_SLOTS))
     return NULL;
@@ -34,67 +83,238 @@ time_slot_t *get_time_slot_by_idx(gate_t *gate, int slot_idx) {
     return &gate->time_slots[slot_idx];
 }
 
-int check_time_slots_free(gate_t *gate, int start_idx, int end_idx) {
+void read_time_slots(gate_t *gate, int start_idx, int end_idx, time_slot_t *out) {
   time_slot_t *ts;
-  int idx;
-  int is_free = 1;
-  for (idx = start_idx; idx <= end_idx; idx++) {
-    ts = get_time_slot_by_idx(gate, idx);
-    pthread_mutex_lock(&ts->lock);
-    if (ts->status == 1) {
-      is_free = 0;
+  unsigned seq;
+  do {
+    seq = seqlock_read_begin(&gate->seqlock);
+    for (int idx = start_idx; idx <= end_idx; idx++) {
+      ts = &gate->time_slots[idx];
+      out[idx - start_idx].status = SLOT_LOAD(ts->status);
+      out[idx - start_idx].plane_id = SLOT_LOAD(ts->plane_id);
+      out[idx - start_idx].start_time = SLOT_LOAD(ts->start_time);
+      out[idx - start_idx].end_time = SLOT_LOAD(ts->end_time);
     }
-    pthread_mutex_unlock(&ts->lock);
-    if (!is_free) break;
-  }
-  return is_free;
+  } while (seqlock_read_retry(&gate->seqlock, seq));
 }
 
-int set_time_slot(time_slot_t *ts, int plane_id, int start_idx, int end_idx) {
-  if (ts->status == 1) {
-    return -1;
-  }
-  ts->status = 1; /* Set to be occupied */
-  ts->plane_id = plane_id;
-  ts->start_time = start_idx;
-  ts->end_time = end_idx;
+/** Writes a booking of `[start]..[end]` into the gate's time slots. Returns 0
+ *  on success, or -1 if the booking could not be stored. */
+static int store_booking(gate_t *gate, int plane_id, int start, int end) {
+  seqlock_write_begin(&gate->seqlock);
+  for (int idx = start; idx <= end; idx++)
+    set_time_slot(get_time_slot_by_idx(gate, idx), plane_id, start, end);
+  seqlock_write_end(&gate->seqlock);
   return 0;
 }
 
-int add_plane_to_slots(gate_t *gate, int plane_id, int start, int count) {
-  int ret = 0, end = start + count;
+int search_gate(gate_t *gate, int plane_id) {
+  int idx, next_idx, found;
   time_slot_t *ts = NULL;
-  for (int idx = start; idx <= end; idx++) {
-    ts = get_time_slot_by_idx(gate, idx);
-    pthread_mutex_lock(&ts->lock);
-    ret = set_time_slot(ts, plane_id, start, end);
-    pthread_mutex_unlock(&ts->lock);
-    if (ret < 0) break;
+  occupancy_t occ;
+  unsigned seq;
+
+  do {
+    seq = seqlock_read_begin(&gate->seqlock);
+    occ = __atomic_load_n(gate->occupancy, __ATOMIC_ACQUIRE);
+    found = -1;
+
+    // Only visit occupied slots, jumping over each booking as a whole
+    while (occ) {
+      idx = __builtin_ctzll(occ);
+      ts = &gate->time_slots[idx];
+      if (SLOT_LOAD(ts->status) == 0) {
+        next_idx = idx + 1;
+      } else if (SLOT_LOAD(ts->plane_id) == plane_id) {
+        found = idx;
+        break;
+      } else {
+        next_idx = SLOT_LOAD(ts->end_time) + 1;
+      }
+      // A racing writer can make the values inconsistent; the retry below
+      // will catch it, but the walk itself must stay in bounds
+      if (next_idx <= idx || next_idx > NUM_TIME_SLOTS)
+        next_idx = idx + 1;
+      occ &= ~occupancy_range(0, next_idx - 1);
+    }
+  } while (seqlock_read_retry(&gate->seqlock, seq));
+  return found;
+}
+
+static void free_gate(gate_t *gate) { seqlock_destroy(&gate->seqlock); }
+
+#else
+
+time_slot_t *get_time_slot_by_idx(gate_t *gate, int slot_idx) {
+  static __thread time_slot_t slot;
+  if ((slot_idx < 0) || (slot_idx >= NUM_TIME_SLOTS))
+    return NULL;
+  read_time_slots(gate, slot_idx, slot_idx, &slot);
+  return &slot;
+}
+
+/** Loads the bookings of a gate inside a seqlock read section. The count is
+ *  clamped to the array that was loaded, so a racing writer can make the
+ *  result stale (caught by the retry) but never out of bounds. */
+static booking_list_t *load_bookings(gate_t *gate, int *num_bookings) {
+  booking_list_t *list = __atomic_load_n(&gate->bookings, __ATOMIC_ACQUIRE);
+  int n = SLOT_LOAD(gate->num_bookings);
+  *num_bookings = (list == NULL) ? 0 : (n < list->capacity ? n : list->capacity);
+  return list;
+}
+
+void read_time_slots(gate_t *gate, int start_idx, int end_idx, time_slot_t *out) {
+  booking_list_t *list;
+  booking_t booking;
+  int num_bookings, from, to;
+  unsigned seq;
+  do {
+    seq = seqlock_read_begin(&gate->seqlock);
+    memset(out, 0, sizeof(time_slot_t) * (size_t)(end_idx - start_idx + 1));
+    list = load_bookings(gate, &num_bookings);
+    for (int i = 0; i < num_bookings; i++) {
+      booking = SLOT_LOAD(list->items[i]);
+      if (BOOKING_START(booking) > end_idx)
+        break;
+      from = BOOKING_START(booking) > start_idx ? BOOKING_START(booking) : start_idx;
+      to = BOOKING_END(booking) < end_idx ? BOOKING_END(booking) : end_idx;
+      for (int idx = from; idx <= to; idx++) {
+        out[idx - start_idx] = (time_slot_t){1, BOOKING_PLANE(booking),
+                                             BOOKING_START(booking), BOOKING_END(booking)};
+      }
+    }
+  } while (seqlock_read_retry(&gate->seqlock, seq));
+}
+
+/** Inserts a booking of `[start]..[end]` into the gate's sorted booking list,
+ *  growing the list if needed. Returns 0 on success, or -1 if the list could
+ *  not be grown. */
+static int store_booking(gate_t *gate, int plane_id, int start, int end) {
+  booking_list_t *list, *grown;
+  int pos, num_bookings, capacity;
+
+  seqlock_write_begin(&gate->seqlock);
+  list = gate->bookings;
+  num_bookings = gate->num_bookings;
+  if (list == NULL || num_bookings == list->capacity) {
+    // A gate holds at most one booking per time slot
+    capacity = (list == NULL) ? 4 : 2 * list->capacity;
+    if (capacity > NUM_TIME_SLOTS)
+      capacity = NUM_TIME_SLOTS;
+    grown = malloc(sizeof(booking_list_t) + sizeof(booking_t) * (size_t)capacity);
+    if (grown == NULL) {
+      seqlock_write_end(&gate->seqlock);
+      return -1;
+    }
+    grown->capacity = capacity;
+    grown->retired = list;
+    if (list)
+      memcpy(grown->items, list->items, sizeof(booking_t) * (size_t)num_bookings);
+    __atomic_store_n(&gate->bookings, grown, __ATOMIC_RELEASE);
+    list = grown;
   }
-  return ret;
+
+  for (pos = num_bookings; pos > 0 && BOOKING_START(list->items[pos - 1]) > start; pos--)
+    SLOT_STORE(list->items[pos], list->items[pos - 1]);
+  SLOT_STORE(list->items[pos], PACK_BOOKING(plane_id, start, end));
+  SLOT_STORE(gate->num_bookings, num_bookings + 1);
+  seqlock_write_end(&gate->seqlock);
+  return 0;
 }
 
 int search_gate(gate_t *gate, int plane_id) {
-  int idx, next_idx;
-  time_slot_t *ts = NULL;
-  for (idx = 0; idx < NUM_TIME_SLOTS; idx = next_idx) {
-    ts = get_time_slot_by_idx(gate, idx);
-    pthread_mutex_lock(&ts->lock);
-    if (ts->status == 0) {
-      next_idx = idx + 1;
-      pthread_mutex_unlock(&ts->lock);
-    } else if (ts->plane_id == plane_id) {
-      pthread_mutex_unlock(&ts->lock);
-      return idx;
-    } else {
-      next_idx = ts->end_time + 1;
-      pthread_mutex_unlock(&ts->lock);
+  booking_list_t *list;
+  booking_t booking;
+  int num_bookings, found;
+  unsigned seq;
+  do {
+    seq = seqlock_read_begin(&gate->seqlock);
+    list = load_bookings(gate, &num_bookings);
+    found = -1;
+    // Bookings are sorted by start time, so the first match is the earliest
+    for (int i = 0; i < num_bookings; i++) {
+      booking = SLOT_LOAD(list->items[i]);
+      if (BOOKING_PLANE(booking) == plane_id) {
+        found = BOOKING_START(booking);
+        break;
+      }
     }
+  } while (seqlock_read_retry(&gate->seqlock, seq));
+  return found;
+}
+
+static void free_gate(gate_t *gate) {
+  booking_list_t *list, *retired;
+  for (list = gate->bookings; list; list = retired) {
+    retired = list->retired;
+    free(list);
   }
-  return -1;
+  seqlock_destroy(&gate->seqlock);
+}
+
+#endif
+
+int check_time_slots_free(gate_t *gate, int start_idx, int end_idx) {
+  occupancy_t occ;
+  if (start_idx < 0 || end_idx >= NUM_TIME_SLOTS || start_idx > end_idx)
+    return 0;
+  occ = __atomic_load_n(gate->occupancy, __ATOMIC_ACQUIRE);
+  return (occ & occupancy_range(start_idx, end_idx)) == 0;
+}
+
+/** Brings the airport's free-interval index, if it keeps one, up to date with
+ *  a change to the occupancy word of `gate`. */
+static void reindex_gate(gate_t *gate) {
+  free_index_t *index = AIRPORT_DATA->free_index;
+  if (index == NULL)
+    return;
+  pthread_mutex_lock(&index->lock);
+  free_index_update(index, (int)(gate - AIRPORT_DATA->gates),
+                    __atomic_load_n(gate->occupancy, __ATOMIC_ACQUIRE));
+  pthread_mutex_unlock(&index->lock);
+}
+
+/** Stores the booking of a window `[start]..[end]` that the caller has already
+ *  claimed in the gate's occupancy bitmap, and indexes it. If the booking
+ *  cannot be stored, the claim is released again and -1 is returned. */
+static int fill_claimed_slots(gate_t *gate, int plane_id, int start, int end) {
+  if (store_booking(gate, plane_id, start, end) < 0) {
+    __atomic_fetch_and(gate->occupancy, ~occupancy_range(start, end), __ATOMIC_RELEASE);
+    reindex_gate(gate);
+    return -1;
+  }
+  if (plane_index_insert(AIRPORT_DATA->plane_index, plane_id,
+                         (int)(gate - AIRPORT_DATA->gates), start, end) < 0)
+    LOG("Could not index plane %d\n", plane_id);
+  // Only once the booking can be read, so that a response cached at the new
+  // versions has it
+  if (AIRPORT_DATA->versions) {
+    __atomic_add_fetch(&AIRPORT_DATA->versions[1 + (gate - AIRPORT_DATA->gates)], 1,
+                       __ATOMIC_RELEASE);
+    __atomic_add_fetch(&AIRPORT_DATA->versions[0], 1, __ATOMIC_RELEASE);
+  }
+  return 0;
+}
+
+int add_plane_to_slots(gate_t *gate, int plane_id, int start, int count) {
+  int end = start + count;
+  if (start < 0 || count < 0 || end >= NUM_TIME_SLOTS)
+    return -1;
+  // Reserve the whole window at once so that nothing is written on failure
+  if (!occupancy_try_claim(gate->occupancy, occupancy_range(start, end)))
+    return -1;
+  reindex_gate(gate);
+  return fill_claimed_slots(gate, plane_id, start, end);
 }
 
 time_info_t lookup_plane_in_airport(int plane_id) {
+  time_info_t result = {-1, -1, -1};
+  plane_index_lookup(AIRPORT_DATA->plane_index, plane_id, &result.gate_number,
+                     &result.start_time, &result.end_time);
+  return result;
+}
+
+time_info_t scan_plane_in_airport(int plane_id) {
   time_info_t result = {-1, -1, -1};
   int gate_idx, slot_idx;
   gate_t *gate;
@@ -103,39 +323,341 @@ time_info_t lookup_plane_in_airport(int plane_id) {
     if ((slot_idx = search_gate(gate, plane_id)) >= 0) {
       result.start_time = slot_idx;
       result.gate_number = gate_idx;
-      result.end_time = get_time_slot_by_idx(gate, slot_idx)->end_time;
+      time_slot_t ts;
+      read_time_slots(gate, slot_idx, slot_idx, &ts);
+      result.end_time = ts.end_time;
       break;
     }
   }
   return result;
 }
 
+/** Returns the last slot a flight may start in, bounded by both its remaining
+ *  fuel and the end of the day. */
+static int last_start_slot(int start, int duration, int fuel) {
+  int last = NUM_TIME_SLOTS - 1 - duration;
+  if (fuel < last - start)
+    last = start + fuel;
+  return last;
+}
+
 int assign_in_gate(gate_t *gate, int plane_id, int start, int duration, int fuel) {
-  int idx, end = start + duration;
-  for (idx = start; idx <= (start + fuel) && (end < NUM_TIME_SLOTS); idx++) {
-    if (check_time_slots_free(gate, idx, end)) {
-      add_plane_to_slots(gate, plane_id, idx, duration);
-      return idx;
+  int idx, last;
+  if (start < 0 || duration < 0 || fuel < 0)
+    return -1;
+
+  last = last_start_slot(start, duration, fuel);
+  idx = occupancy_claim_first_window(gate->occupancy, start, last, duration + 1);
+  if (idx < 0)
+    return -1;
+  reindex_gate(gate);
+  if (fill_claimed_slots(gate, plane_id, idx, idx + duration) < 0)
+    return -1;
+  return idx;
+}
+
+/* Whether `schedule_plane` searches the airport's free-interval index */
+#define PROBE_USES_FREE_INDEX (PROBE_POLICY == PROBE_EARLIEST || PROBE_POLICY == PROBE_BEST_FIT)
+
+/* Gates that fit compared by `PROBE_LEAST_LOADED` */
+#define PROBE_CANDIDATES 8
+
+/* Where the calling thread starts probing with `PROBE_ROTATE` and
+ * `PROBE_LEAST_LOADED`, as a fraction of the gates (out of 2^32), so that it
+ * means the same in airports of any size. Threads start a golden-ratio step
+ * apart, which spreads any number of them evenly over the gates. */
+static __thread uint32_t PROBE_START;
+static __thread int PROBE_STARTED;
+static uint32_t PROBE_THREADS;
+
+/** Finds the first gate in `[from, to)` with a window for the flight. */
+static int first_gate_between(int from, int to, int start, int last, int len) {
+  int gate_idx = occupancy_first_gate(AIRPORT_DATA->occupancy + from, to - from, start, last, len);
+  return (gate_idx < 0) ? -1 : from + gate_idx;
+}
+
+/** Finds the next gate to try to assign the flight in, under `PROBE_POLICY`,
+ *  from `*from` (the first gate of the pass, or the gate where the last try
+ *  lost a race). Moves on to the wrapped-around pass of `PROBE_ROTATE` once
+ *  the first one has no gate left. */
+static int next_gate(int *from, int *to, int first, int start, int last, int len) {
+  int num_gates = AIRPORT_DATA->num_gates, gate_idx;
+  if (PROBE_POLICY == PROBE_LEAST_LOADED)
+    return occupancy_least_loaded_gate(AIRPORT_DATA->occupancy, num_gates, first, start, last,
+                                       len, PROBE_CANDIDATES);
+  while (*from < *to) {
+    if ((gate_idx = first_gate_between(*from, *to, start, last, len)) >= 0)
+      return gate_idx;
+    // The gates before the start gate are probed last
+    if (*to == first || first == 0)
+      break;
+    *from = 0;
+    *to = first;
+  }
+  return -1;
+}
+
+/** Finds the gate and start of a window of `len` slots from `[start]..[last]`
+ *  with the airport's free-interval index, whose lock the caller holds, and
+ *  claims it, storing the start through `slot`. Returns the gate, or -1 if no
+ *  gate has such a window. */
+static int claim_from_index(free_index_t *index, int start, int last, int len, int *slot) {
+  int gate_idx = -1, claimed = 0;
+  occupancy_t *occ;
+
+  while (!claimed && (*slot = free_index_find(index, start, last, len,
+                                              PROBE_POLICY == PROBE_BEST_FIT, &gate_idx)) >= 0) {
+    occ = &AIRPORT_DATA->occupancy[gate_idx];
+    claimed = occupancy_try_claim(occ, occupancy_range(*slot, *slot + len - 1));
+    // If the claim failed, the leaf was behind a change still being indexed
+    free_index_update(index, gate_idx, __atomic_load_n(occ, __ATOMIC_ACQUIRE));
+  }
+  return claimed ? gate_idx : -1;
+}
+
+/** Picks a gate for a flight under `PROBE_POLICY` and claims its window in
+ *  the gate's occupancy word, storing the start through `slot`, but does not
+ *  store the booking. With the free-interval index, the caller holds its
+ *  lock. Returns the gate, or -1 if the flight fits in none. */
+static int claim_window(int start, int duration, int fuel, int *slot) {
+  int num_gates = AIRPORT_DATA->num_gates, gate_idx, first = 0, from, to, last;
+  gate_t *gate;
+
+  last = last_start_slot(start, duration, fuel);
+  if (PROBE_USES_FREE_INDEX && AIRPORT_DATA->free_index)
+    return claim_from_index(AIRPORT_DATA->free_index, start, last, duration + 1, slot);
+  if (PROBE_POLICY == PROBE_ROTATE || PROBE_POLICY == PROBE_LEAST_LOADED) {
+    if (!PROBE_STARTED) {
+      PROBE_START = __atomic_fetch_add(&PROBE_THREADS, 1, __ATOMIC_RELAXED) * 2654435769u;
+      PROBE_STARTED = 1;
+    }
+    first = (int)(((uint64_t)PROBE_START * (uint64_t)num_gates) >> 32);
+  }
+  from = first;
+  to = num_gates;
+  while ((gate_idx = next_gate(&from, &to, first, start, last, duration + 1)) >= 0) {
+    gate = get_gate_by_idx(gate_idx);
+    if ((*slot = occupancy_claim_first_window(gate->occupancy, start, last, duration + 1)) >= 0) {
+      reindex_gate(gate);
+      // Start from the next gate next time: rounded up, the fraction maps
+      // back to that gate, and wraps around to 0 after the last one
+      if (PROBE_POLICY == PROBE_ROTATE || PROBE_POLICY == PROBE_LEAST_LOADED)
+        PROBE_START = (uint32_t)((((uint64_t)gate_idx + 1) << 32) / (uint64_t)num_gates + 1);
+      return gate_idx;
     }
-    end++;
+    // Another thread claimed the window first; search again from this gate
+    from = gate_idx;
   }
   return -1;
 }
 
 time_info_t schedule_plane(int plane_id, int start, int duration, int fuel) {
   time_info_t result = {-1, -1, -1};
-  gate_t *gate;
+  free_index_t *index = PROBE_USES_FREE_INDEX ? AIRPORT_DATA->free_index : NULL;
   int gate_idx, slot;
-  for (gate_idx = 0; gate_idx < AIRPORT_DATA->num_gates; gate_idx++) {
-    gate = get_gate_by_idx(gate_idx);
-    if ((slot = assign_in_gate(gate, plane_id, start, duration, fuel)) >= 0) {
-      result.start_time = slot;
-      result.gate_number = gate_idx;
-      result.end_time = slot + duration;
+  if (start < 0 || duration < 0 || fuel < 0)
+    return result;
+
+  if (index)
+    pthread_mutex_lock(&index->lock);
+  gate_idx = claim_window(start, duration, fuel, &slot);
+  if (index)
+    pthread_mutex_unlock(&index->lock);
+  if (gate_idx >= 0 &&
+      fill_claimed_slots(get_gate_by_idx(gate_idx), plane_id, slot, slot + duration) == 0) {
+    result.start_time = slot;
+    result.gate_number = gate_idx;
+    result.end_time = slot + duration;
+  }
+  return result;
+}
+
+/** Orders flights by their deadline (the last slot their fuel lets them start
+ *  in), then their earliest start, then the order they were sent in. */
+static int compare_urgency(const void *a, const void *b) {
+  const int32_t *x = a, *y = b;
+  for (int i = 0; i < 3; i++) {
+    if (x[i] != y[i])
+      return (x[i] > y[i]) - (x[i] < y[i]);
+  }
+  return 0;
+}
+
+void schedule_batch(const wire_flight_t *flights, int count, int by_urgency,
+                    time_info_t *results) {
+  free_index_t *index = PROBE_USES_FREE_INDEX ? AIRPORT_DATA->free_index : NULL;
+  int32_t order[WIRE_BATCH_MAX][3]; // Deadline, earliest, position
+  int slots[WIRE_BATCH_MAX];
+  const wire_flight_t *f;
+
+  for (int i = 0; i < count; i++) {
+    f = &flights[i];
+    order[i][0] = by_urgency ? last_start_slot(f->earliest, f->duration, f->fuel) : 0;
+    order[i][1] = by_urgency ? f->earliest : 0;
+    order[i][2] = i;
+  }
+  if (by_urgency)
+    qsort(order, (size_t)count, sizeof(order[0]), compare_urgency);
+
+  // Claim every window in one pass, under a single hold of the index's lock
+  if (index)
+    pthread_mutex_lock(&index->lock);
+  for (int i = 0; i < count; i++) {
+    f = &flights[order[i][2]];
+    results[order[i][2]] = (time_info_t){-1, -1, -1};
+    if (f->earliest >= 0 && f->duration >= 0 && f->fuel >= 0)
+      results[order[i][2]].gate_number =
+          claim_window(f->earliest, f->duration, f->fuel, &slots[order[i][2]]);
+  }
+  if (index)
+    pthread_mutex_unlock(&index->lock);
+
+  // Then store the bookings, outside of it
+  for (int i = 0; i < count; i++) {
+    time_info_t *r = &results[i];
+    if (r->gate_number < 0)
+      continue;
+    if (fill_claimed_slots(get_gate_by_idx(r->gate_number), flights[i].plane, slots[i],
+                           slots[i] + flights[i].duration) < 0) {
+      r->gate_number = -1;
+      continue;
+    }
+    r->start_time = slots[i];
+    r->end_time = slots[i] + flights[i].duration;
+  }
+}
+
+/** Moves the open window to the end of the closed windows. Requires
+ *  `window_lock`. */
+static void close_window(airport_t *airport) {
+  schedule_window_t **tail = &airport->closed;
+  while (*tail)
+    tail = &(*tail)->next;
+  *tail = airport->window;
+  airport->window = NULL;
+}
+
+static int window_expired(const struct timespec *deadline) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec > deadline->tv_sec ||
+         (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec);
+}
+
+/** Places the flights of a closed window and hands out their results. */
+static void solve_window(schedule_window_t *window) {
+  time_info_t results[WIRE_BATCH_MAX];
+  schedule_batch(window->flights, window->count, 1, results);
+  for (int i = 0; i < window->count; i++)
+    window->done[i](window->ctx[i], &window->flights[i], results[i]);
+}
+
+/** Closes each window once its time is up and solves it, until the airport
+ *  is destroyed, solving whatever is left first. Requests only add their
+ *  flight to the open window, so no worker waits for one. */
+static void *window_thread_routine(void *arg) {
+  airport_t *airport = arg;
+  schedule_window_t *window;
+
+  select_airport(airport->window_airport_id, airport);
+  pthread_mutex_lock(&airport->window_lock);
+  while (1) {
+    if (airport->window &&
+        (airport->window_stopping || window_expired(&airport->window->deadline)))
+      close_window(airport);
+    if ((window = airport->closed) != NULL) {
+      airport->closed = window->next;
+      pthread_mutex_unlock(&airport->window_lock);
+      solve_window(window);
+      free(window);
+      pthread_mutex_lock(&airport->window_lock);
+    } else if (airport->window_stopping) {
       break;
+    } else if (airport->window) {
+      pthread_cond_timedwait(&airport->window_cond, &airport->window_lock,
+                             &airport->window->deadline);
+    } else {
+      pthread_cond_wait(&airport->window_cond, &airport->window_lock);
     }
   }
-  return result;
+  pthread_mutex_unlock(&airport->window_lock);
+  return NULL;
+}
+
+int schedule_window_submit(const wire_flight_t *flight, window_done_fn done, void *ctx) {
+  airport_t *airport = AIRPORT_DATA;
+  schedule_window_t *window;
+  int i;
+
+  pthread_mutex_lock(&airport->window_lock);
+  // Started here rather than with the airport, so that it is never forked
+  if (!airport->window_running) {
+    airport->window_airport_id = AIRPORT_ID;
+    if (pthread_create(&airport->window_thread, NULL, window_thread_routine, airport) != 0) {
+      pthread_mutex_unlock(&airport->window_lock);
+      return -1;
+    }
+    airport->window_running = 1;
+  }
+  if ((window = airport->window) == NULL) {
+    if ((window = calloc(1, sizeof(schedule_window_t))) == NULL) {
+      pthread_mutex_unlock(&airport->window_lock);
+      return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &window->deadline);
+    window->deadline.tv_nsec += (long)SCHEDULE_WINDOW_US * 1000;
+    window->deadline.tv_sec += window->deadline.tv_nsec / 1000000000;
+    window->deadline.tv_nsec %= 1000000000;
+    airport->window = window;
+    pthread_cond_signal(&airport->window_cond);
+  }
+  i = window->count++;
+  window->flights[i] = *flight;
+  window->done[i] = done;
+  window->ctx[i] = ctx;
+  // A full window is closed at once rather than at the end of its time
+  if (window->count == WIRE_BATCH_MAX) {
+    close_window(airport);
+    pthread_cond_signal(&airport->window_cond);
+  }
+  pthread_mutex_unlock(&airport->window_lock);
+  return 0;
+}
+
+/** A caller of `schedule_in_window` waiting for its result. */
+typedef struct {
+  airport_t *airport;
+  pthread_cond_t solved;
+  int done;
+  time_info_t result;
+} window_waiter_t;
+
+/** `window_done_fn` waking up the caller of `schedule_in_window`. */
+static void wake_window_waiter(void *ctx, const wire_flight_t *flight, time_info_t result) {
+  window_waiter_t *waiter = ctx;
+  (void)flight;
+  pthread_mutex_lock(&waiter->airport->window_lock);
+  waiter->result = result;
+  waiter->done = 1;
+  pthread_cond_signal(&waiter->solved);
+  pthread_mutex_unlock(&waiter->airport->window_lock);
+}
+
+time_info_t schedule_in_window(int plane_id, int start, int duration, int fuel) {
+  wire_flight_t flight = {plane_id, start, duration, fuel};
+  window_waiter_t waiter = {.airport = AIRPORT_DATA};
+
+  pthread_cond_init(&waiter.solved, NULL);
+  if (schedule_window_submit(&flight, wake_window_waiter, &waiter) < 0) {
+    pthread_cond_destroy(&waiter.solved);
+    return schedule_plane(plane_id, start, duration, fuel);
+  }
+  pthread_mutex_lock(&waiter.airport->window_lock);
+  while (!waiter.done)
+    pthread_cond_wait(&waiter.solved, &waiter.airport->window_lock);
+  pthread_mutex_unlock(&waiter.airport->window_lock);
+  pthread_cond_destroy(&waiter.solved);
+  return waiter.result;
 }
 
 airport_t *create_airport(int num_gates) {
@@ -147,37 +669,169 @@ airport_t *create_airport(int num_gates) {
   }
   if (data) {
     data->num_gates = num_gates;
+    data->occupancy = calloc((unsigned)num_gates, sizeof(occupancy_t));
+    data->plane_index = create_plane_index((size_t)num_gates * 8);
+    if (PROBE_USES_FREE_INDEX && data->occupancy)
+      data->free_index = create_free_index(data->occupancy, num_gates);
+    if (data->occupancy == NULL || data->plane_index == NULL ||
+        (PROBE_USES_FREE_INDEX && data->free_index == NULL)) {
+      free(data->occupancy);
+      destroy_plane_index(data->plane_index);
+      destroy_free_index(data->free_index);
+      free(data);
+      return NULL;
+    }
     for (int gate_idx = 0; gate_idx < num_gates; gate_idx++) {
-      for (int slot_idx = 0; slot_idx < NUM_TIME_SLOTS; slot_idx++) {
-        pthread_mutex_init(&data->gates[gate_idx].time_slots[slot_idx].lock, NULL);
-      }
+      data->gates[gate_idx].occupancy = &data->occupancy[gate_idx];
+      seqlock_init(&data->gates[gate_idx].seqlock);
     }
+    // Windows end on the monotonic clock (see `window_thread_routine`)
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&data->window_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&data->window_lock, NULL);
   }
   return data;
 }
 
+void destroy_airport(airport_t *data) {
+  if (data == NULL)
+    return;
+  // The window thread solves the windows still open before it stops
+  if (data->window_running) {
+    pthread_mutex_lock(&data->window_lock);
+    data->window_stopping = 1;
+    pthread_cond_signal(&data->window_cond);
+    pthread_mutex_unlock(&data->window_lock);
+    pthread_join(data->window_thread, NULL);
+  }
+  for (int gate_idx = 0; gate_idx < data->num_gates; gate_idx++)
+    free_gate(&data->gates[gate_idx]);
+  destroy_plane_index(data->plane_index);
+  destroy_free_index(data->free_index);
+  pthread_cond_destroy(&data->window_cond);
+  pthread_mutex_destroy(&data->window_lock);
+  free(data->occupancy);
+  free(data);
+}
+
+void attach_airport(int airport_id, airport_t *data) {
+  NODE_AIRPORT_ID = airport_id;
+  NODE_AIRPORT_DATA = data;
+}
+
+void select_airport(int airport_id, airport_t *data) {
+  SELECTED_AIRPORT_ID = airport_id;
+  SELECTED_AIRPORT_DATA = data;
+}
+
 void initialise_node(int airport_id, int num_gates, int listenfd) {
-  AIRPORT_ID = airport_id;
-  AIRPORT_DATA = create_airport(num_gates);
+  // Keep the airport's workers on the same cores
+  if (PIN_AIRPORTS && scheduler_pin_share(airport_id, NUM_AIRPORTS) < 0)
+    perror("sched_setaffinity");
+  attach_airport(airport_id, create_airport(num_gates));
   if (AIRPORT_DATA == NULL)
     exit(1);
+  if (SCHEDULE_VERSIONS != NULL)
+    AIRPORT_DATA->versions = SCHEDULE_VERSIONS[airport_id];
   airport_node_loop(listenfd);
 }
 
-void airport_node_loop(int listenfd) {
-  init_shared_queue(&shared_queue, 20);
+/** Writes the response frame of pipelined request `id` to `out`. */
+static void write_frame(unsigned id, const char *request, wio_t *out) {
+  wio_printf(out, "%c%u\n", PIPELINE_TAG, id);
+  process_request(request, strlen(request), out);
+}
+
+/** Answers a request received by the reactor. The frames of a pipelined
+ *  connection are independent of each other, so its connection is marked
+ *  unordered and its later frames are spread over the workers, and those
+ *  parked in a window are answered by the window thread. */
+static void airport_reactor_handler(reactor_conn_t *conn, reactor_line_t *line) {
+  char *rest, *request = line->buf;
+  wio_t out;
 
-  // Create worker threads for the airport node
-  pthread_t tid[NUM_THREADS];
-  for (int i = 0; i < NUM_THREADS; i++) {
-    if (pthread_create(&tid[i], NULL, airport_thread_routine, &shared_queue) < 0) {
+  if (line->binary) {
+    uint8_t out[WIRE_MAX_RECORDS * WIRE_RESPONSE_SIZE];
+    reactor_send(conn, (char *)out, build_binary_response((uint8_t *)request, out));
+    return;
+  }
+  if (strcmp(request, WIRE_HELLO) == 0) {
+    reactor_send(conn, WIRE_HELLO_OK, strlen(WIRE_HELLO_OK));
+    return;
+  }
+  reactor_output_init(&out, conn);
+  if (request[0] == PIPELINE_TAG) {
+    unsigned id = (unsigned)strtoul(request + 1, &rest, 10);
+    reactor_set_unordered(conn);
+    if (park_schedule_frame(id, rest, NULL, conn))
+      return;
+    write_frame(id, rest, &out);
+  } else {
+    process_request(request, line->len, &out);
+  }
+  wio_flush(&out);
+}
+
+/** Serves controller connections from the reactor. Returns only if the
+ *  reactor could not be started. */
+static void airport_reactor_loop(int listenfd) {
+  reactor_backend_t backend = (SERVER_MODE == SERVER_URING) ? REACTOR_URING : REACTOR_EPOLL;
+
+  if (scheduler_init(&conn_scheduler, AIRPORT_THREADS, REACTOR_QUEUE_SIZE) < 0)
+    return;
+  if (reactor_init(&airport_reactor, airport_reactor_handler, &conn_scheduler, backend) < 0) {
+    scheduler_deinit(&conn_scheduler);
+    return;
+  }
+  if (scheduler_start(&conn_scheduler, AIRPORT_MIN_THREADS, reactor_worker_routine,
+                      &airport_reactor) < 0) {
+    perror("pthread_create");
+    exit(1);
+  }
+  reactor_serve(&airport_reactor, listenfd);
+}
+
+/** Starts the threads that serve the airport's shared-memory channels, one
+ *  thread per channel, next to whichever server handles TCP connections. */
+static void start_channel_threads(shm_link_t *link) {
+  pthread_t tid;
+  shm_link_attach(link);
+  for (int c = 0; c < SHM_LINK_CHANNELS; c++) {
+    if (pthread_create(&tid, NULL, airport_channel_routine, &link->channels[c]) != 0) {
       perror("pthread_create");
       exit(1);
     }
   }
+}
+
+void airport_node_loop(int listenfd) {
+  if (SHM_LINKS != NULL)
+    start_channel_threads(&SHM_LINKS[AIRPORT_ID]);
+
+  if (SERVER_MODE != SERVER_THREADED) {
+    airport_reactor_loop(listenfd);
+    fprintf(stderr, "[Airport %d] Falling back to the threaded server\n", AIRPORT_ID);
+  }
+
+  if (scheduler_init(&conn_scheduler, AIRPORT_THREADS, 20) < 0 ||
+      scheduler_init(&request_scheduler, AIRPORT_THREADS, REACTOR_QUEUE_SIZE) < 0)
+    exit(1);
+
+  // Start the worker threads for the airport node, and the workers that
+  // process pipelined requests
+  if (scheduler_start(&conn_scheduler, AIRPORT_MIN_THREADS, airport_thread_routine,
+                      &conn_scheduler) < 0 ||
+      scheduler_start(&request_scheduler, AIRPORT_MIN_THREADS, airport_request_routine,
+                      &request_scheduler) < 0) {
+    perror("pthread_create");
+    exit(1);
+  }
 
   // Accept connections from the controller
-  int connfd;
+  int connfd, optval = 1;
   struct sockaddr_storage clientaddr;
   socklen_t clientlen = sizeof(struct sockaddr_storage);
 
@@ -186,247 +840,504 @@ void airport_node_loop(int listenfd) {
       perror("accept");
       continue;
     }
-    add_connection(&shared_queue, connfd);
+    // The frames of a pipelined connection are written as they are ready, by
+    // several threads, and a window's all at once: do not let Nagle hold them
+    // back waiting for an ACK (this fails harmlessly on Unix domain sockets)
+    setsockopt(connfd, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
+    scheduler_submit_fd(&conn_scheduler, connfd);
+  }
+
+  scheduler_deinit(&conn_scheduler);
+  scheduler_deinit(&request_scheduler);
+}
+
+/** Drops one reference to a pipelined connection, closing it after the last. */
+static void release_pipelined_conn(pipelined_conn_t *conn) {
+  if (__atomic_sub_fetch(&conn->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    LOG("Thread %lu: Closing pipelined connection\n", (unsigned long)pthread_self());
+    close(conn->fd);
+    pthread_mutex_destroy(&conn->write_lock);
+    free(conn);
   }
+}
 
-  deinit_shared_queue(&shared_queue);
+/** Queues a pipelined request (`#<id> <request>`) of `len` bytes read from
+ *  `conn` for the request workers. */
+static void dispatch_pipelined_request(pipelined_conn_t *conn, const char *line, size_t len) {
+  request_task_t *task = malloc(sizeof(request_task_t));
+  char *request;
+  if (task == NULL)
+    return;
+  task->conn = conn;
+  if (len > MAXLINE - 1)
+    len = MAXLINE - 1;
+  memcpy(task->request, line, len);
+  task->request[len] = '\0';
+  task->id = (unsigned)strtoul(task->request + 1, &request, 10);
+  memmove(task->request, request, strlen(request) + 1);
+  __atomic_add_fetch(&conn->refs, 1, __ATOMIC_ACQ_REL);
+  scheduler_submit(&request_scheduler, task);
+}
+
+/** Where a request worker's frame goes: the connection, once its write lock
+ *  has been taken. */
+typedef struct {
+  pipelined_conn_t *conn;
+  int locked;
+} frame_sink_t;
+
+/** `wio_sink_fn` writing a frame to its pipelined connection. Frames must not
+ *  interleave, so the write lock is taken at the first write and only
+ *  released once the whole frame is out: most frames fit in the buffer and
+ *  are generated without the lock, in parallel, and written at once. */
+static ssize_t frame_sink_write(void *ctx, const void *buf, size_t n) {
+  frame_sink_t *sink = ctx;
+  size_t max = sink->conn->msg_max ? sink->conn->msg_max : n, chunk;
+
+  if (!sink->locked) {
+    pthread_mutex_lock(&sink->conn->write_lock);
+    sink->locked = 1;
+  }
+  for (size_t done = 0; done < n; done += chunk) {
+    chunk = (n - done < max) ? n - done : max;
+    if (rio_writen(sink->conn->fd, (char *)buf + done, chunk) < 0)
+      return -1;
+  }
+  return (ssize_t)n;
+}
+
+void *airport_request_routine(void *arg) {
+  pthread_detach(pthread_self());
+  scheduler_t *sched = (scheduler_t *)arg;
+  request_task_t *task;
+  frame_sink_t sink;
+  wio_t out;
+
+  while ((task = scheduler_take(sched)) != NULL) {
+    // A SCHEDULE parked in a window is answered by the window thread
+    if (!park_schedule_frame(task->id, task->request, task->conn, NULL)) {
+      sink = (frame_sink_t){task->conn, 0};
+      wio_init_sink(&out, frame_sink_write, &sink, 0);
+      write_frame(task->id, task->request, &out);
+      wio_flush(&out);
+      if (sink.locked)
+        pthread_mutex_unlock(&task->conn->write_lock);
+    }
+    release_pipelined_conn(task->conn);
+    free(task);
+  }
+  return NULL;
+}
+
+/** Answers binary requests on a connection that has just sent `WIRE_HELLO`,
+ *  until it is closed. */
+static void serve_binary_requests(rio_t *rio, wio_t *out) {
+  uint8_t request[WIRE_REQUEST_SIZE], response[WIRE_MAX_RECORDS * WIRE_RESPONSE_SIZE];
+  size_t len;
+
+  wio_writen(out, WIRE_HELLO_OK, strlen(WIRE_HELLO_OK));
+  wio_flush(out);
+  while (rio_readnb(rio, request, WIRE_REQUEST_SIZE) == WIRE_REQUEST_SIZE) {
+    len = build_binary_response(request, response);
+    if (wio_writen(out, response, len) < 0 || (rio->rio_cnt <= 0 && wio_flush(out) < 0))
+      break;
+  }
+}
+
+/** Answers the requests read from `rio` on `out`, until the connection sends
+ *  an empty line, or is closed (returning 0). Pipelined requests need the
+ *  connection's descriptor `connfd`; `*pconn` is set if there were any. */
+static int serve_connection(int connfd, rio_t *rio, wio_t *out, pipelined_conn_t **pconn) {
+  char *line;
+  ssize_t n;
+
+  // Read the request from the connection, and parse it where it was read
+  while ((n = rio_readlinep(rio, &line, MAXLINE)) > 0) {
+    // If the request is an empty line, break
+    if (n == 1 && line[0] == '\n') {
+      break;
+    }
+
+    // The rest of the connection uses the binary protocol
+    if ((size_t)n == strlen(WIRE_HELLO) && memcmp(line, WIRE_HELLO, (size_t)n) == 0) {
+      serve_binary_requests(rio, out);
+      n = 0;
+      break;
+    }
+
+    // Pipelined requests are handed to the request workers
+    if (line[0] == PIPELINE_TAG && connfd >= 0) {
+      if (*pconn == NULL && (*pconn = calloc(1, sizeof(pipelined_conn_t))) != NULL) {
+        (*pconn)->fd = connfd;
+        (*pconn)->refs = 1;
+        (*pconn)->msg_max = out->wio_msg_max;
+        pthread_mutex_init(&(*pconn)->write_lock, NULL);
+      }
+      if (*pconn)
+        dispatch_pipelined_request(*pconn, line, (size_t)n);
+      continue;
+    }
+    LOG("Thread %lu: Processing request: %.*s", (unsigned long)pthread_self(), (int)n, line);
+    process_request(line, (size_t)n, out);
+
+    // Only write the buffered responses once the requests that arrived
+    // with this one have been answered too
+    if (rio->rio_cnt <= 0 && wio_flush(out) < 0)
+      break;
+  }
+  wio_flush(out);
+  return n > 0;
 }
 
 void *airport_thread_routine(void *arg) {
   pthread_detach(pthread_self());
-  shared_queue_t *s_que = (shared_queue_t *)arg;
+  scheduler_t *sched = (scheduler_t *)arg;
 
   // Handle requests from the controller
   int connfd;
-  char buf[MAXBUF];
   rio_t rio;
-  while (1) {
-    // Get a connection from the shared queue
-    connfd = get_connection(s_que);
+  wio_t out;
+  // Get a connection from the scheduler, until this worker is no longer needed
+  while ((connfd = scheduler_take_fd(sched)) >= 0) {
     LOG("Thread %lu: Handling new connection\n", (unsigned long)pthread_self());
 
     rio_readinitb(&rio, connfd);
-    ssize_t n;
-
-    // Read the request from the connection
-    while ((n = rio_readlineb(&rio, buf, MAXLINE)) > 0) {
-      // Null-terminate the buffer
-      buf[n] = '\0';
-      
-      // If the request is an empty line, break
-      if (strcmp(buf, "\n") == 0) {
-        break;
-      }
-      LOG("Thread %lu: Processing request: %s", (unsigned long)pthread_self(), buf);
-      process_request(buf, connfd);
-    }
+    wio_init(&out, connfd, FLUSH_EACH_RESPONSE);
+    out.wio_msg_max = socket_message_max(connfd);
+    pipelined_conn_t *pconn = NULL;
+    serve_connection(connfd, &rio, &out, &pconn);
 
-    // Close the connection
+    // Close the connection, or leave that to the last outstanding request
     LOG("Thread %lu: Closing connection\n", (unsigned long)pthread_self());
-    close(connfd);
+    if (pconn)
+      release_pipelined_conn(pconn);
+    else
+      close(connfd);
   }
   return NULL;
 }
 
-void process_request(char *request_buf, int connfd) {
-  char response[MAXBUF];
-  char command[20];
-  int args[5];
-  int toks_cnt;
-  toks_cnt = sscanf(request_buf, "%s %d %d %d %d %d", command, &args[0], &args[1], &args[2], &args[3], &args[4]);
+void *airport_channel_routine(void *arg) {
+  pthread_detach(pthread_self());
+  shm_channel_t *channel = arg;
+  pipelined_conn_t *pconn = NULL;
+  rio_t rio;
+  wio_t out;
+
+  // The channel stays open for as long as the controller is alive, so an
+  // empty line is just skipped
+  rio_readinit_source(&rio, shm_ring_read, &channel->requests);
+  wio_init_sink(&out, shm_ring_write, &channel->responses, FLUSH_EACH_RESPONSE);
+  while (serve_connection(-1, &rio, &out, &pconn))
+    ;
+  LOG("Thread %lu: Controller gone, closing channel\n", (unsigned long)pthread_self());
+  return NULL;
+}
 
+void process_request(const char *request_buf, size_t len, wio_t *out) {
+  write_response(request_buf, len, out);
 
-  if (is_valid_schedule_request(command, toks_cnt)) {
-    process_schedule(args, response);
+  // Terminate the response so the controller knows where it ends
+  wio_writen(out, RESPONSE_END, strlen(RESPONSE_END));
+}
+
+void write_response(const char *request_buf, size_t len, wio_t *out) {
+  wire_request_t req;
+  wire_response_t recs[WIRE_MAX_RECORDS];
+
+  if (wire_parse_request(request_buf, len, &req) < 0) {
+    wire_error(recs, 0, WIRE_INVALID_REQUEST, 0);
+    wire_write_text(recs, out);
+    return;
+  }
+  // The flights of a batch are only parsed here, from the whole line
+  if (req.type == WIRE_SCHEDULE_BATCH) {
+    process_schedule_batch(request_buf, len, &req, out);
+    return;
+  }
+  write_parsed_response(&req, out);
+}
+
+void write_parsed_response(const wire_request_t *req, wio_t *out) {
+  wire_response_t recs[WIRE_MAX_RECORDS];
+
+  if (req->type == WIRE_AIRPORT_STATUS) {
+    process_airport_status(req->args, out);
+    return;
+  }
+  execute_request(req, recs);
+  wire_write_text(recs, out);
+}
+
+size_t build_binary_response(const uint8_t *request, uint8_t *out) {
+  wire_request_t req;
+  wire_response_t recs[WIRE_MAX_RECORDS];
+  int n;
+  wire_decode_request(request, &req);
+  n = execute_request(&req, recs);
+  for (int i = 0; i < n; i++)
+    wire_encode_response(&recs[i], out + i * WIRE_RESPONSE_SIZE);
+  return (size_t)n * WIRE_RESPONSE_SIZE;
+}
+
+int execute_request(const wire_request_t *req, wire_response_t *out) {
+  memset(out, 0, sizeof(wire_response_t));
+  out->type = req->type;
+  switch (req->type) {
+  case WIRE_SCHEDULE:
+    process_schedule(req->args, out);
+    break;
+  case WIRE_PLANE_STATUS:
+    process_plane_status(req->args, out);
+    break;
+  case WIRE_TIME_STATUS:
+    process_time_status(req->args, out);
+    break;
+  default:
+    wire_error(out, req->type, WIRE_INVALID_REQUEST, 0);
+    break;
+  }
+  return 1 + out->count;
+}
+
+/** Checks the earliest time, duration and fuel of a SCHEDULE, filling in the
+ *  error `response` if one is invalid. Returns 0 if they are all valid. */
+static int check_schedule(int earliest_time, int duration, int fuel,
+                          wire_response_t *response) {
+  if (earliest_time < 0 || earliest_time >= NUM_TIME_SLOTS) {
+    wire_error(response, WIRE_SCHEDULE, WIRE_INVALID_EARLIEST, earliest_time);
+    return -1;
   }
 
-  else if (is_valid_plane_status_request(command, toks_cnt)) {
-    process_plane_status(args, response);
+  if (duration < 0 || duration >= NUM_TIME_SLOTS || earliest_time + duration >= NUM_TIME_SLOTS) {
+    wire_error(response, WIRE_SCHEDULE, WIRE_INVALID_DURATION, duration);
+    return -1;
   }
 
-  else if (is_valid_time_status_request(command, toks_cnt)) {
-    process_time_status(args, response);
+  if (fuel < 0) {
+    wire_error(response, WIRE_SCHEDULE, WIRE_INVALID_FUEL, fuel);
+    return -1;
   }
+  return 0;
+}
 
+/** Fills in the `response` to the SCHEDULE of `plane_id`: its booking if
+ *  `time_info` has one, or else the error. */
+static void fill_schedule_response(int plane_id, time_info_t time_info,
+                                   wire_response_t *response) {
+  // Fill in the booking if the plane was scheduled
+  if (time_info.start_time != -1) {
+    *response = (wire_response_t){WIRE_SCHEDULE, WIRE_OK, 0,
+      {plane_id, time_info.gate_number, time_info.start_time, time_info.end_time}};
+  }
   else {
-    snprintf(response, MAXLINE, "Error: Invalid request provided\n");
+    wire_error(response, WIRE_SCHEDULE, WIRE_CANNOT_SCHEDULE, plane_id);
   }
-  rio_writen(connfd, response, strlen(response));
 }
 
-void process_schedule(int *args, char *response) {
+void process_schedule(const int32_t *args, wire_response_t *response) {
   // Extract the arguments from the request
   int plane_id = args[1];
   int earliest_time = args[2]; 
   int duration = args[3];
   int fuel = args[4];
 
-  if (earliest_time < 0 || earliest_time >= NUM_TIME_SLOTS) {
-    snprintf(response, MAXLINE, "Error: Invalid 'earliest' time (%d)\n", earliest_time);
+  if (check_schedule(earliest_time, duration, fuel, response) < 0)
     return;
-  }
 
-  if (duration < 0 || duration >= NUM_TIME_SLOTS || earliest_time + duration >= NUM_TIME_SLOTS) {
-    snprintf(response, MAXLINE, "Error: Invalid 'duration' value (%d)\n", duration);
-    return;
+  time_info_t time_info = SCHEDULE_WINDOW_US
+                              ? schedule_in_window(plane_id, earliest_time, duration, fuel)
+                              : schedule_plane(plane_id, earliest_time, duration, fuel);
+  fill_schedule_response(plane_id, time_info, response);
+}
+
+/** A pipelined SCHEDULE parked in the airport's window: where its response
+ *  frame goes once the window has been solved. */
+typedef struct {
+  unsigned id;
+  pipelined_conn_t *pconn; // With the threaded server
+  reactor_conn_t *rconn;   // Or with the reactor
+} parked_frame_t;
+
+/** `window_done_fn` sending the response frame of a parked SCHEDULE, from the
+ *  window thread. */
+static void send_parked_frame(void *ctx, const wire_flight_t *flight, time_info_t result) {
+  parked_frame_t *frame = ctx;
+  char text[MAXLINE];
+  wire_response_t response;
+  frame_sink_t sink;
+  size_t len;
+
+  fill_schedule_response(flight->plane, result, &response);
+  len = (size_t)snprintf(text, sizeof(text), "%c%u\n", PIPELINE_TAG, frame->id);
+  len += wire_format_text(&response, text + len, sizeof(text) - len);
+  len += (size_t)snprintf(text + len, sizeof(text) - len, "%s", RESPONSE_END);
+
+  if (frame->rconn) {
+    reactor_send_held(frame->rconn, text, len);
+  } else {
+    sink = (frame_sink_t){frame->pconn, 0};
+    frame_sink_write(&sink, text, len);
+    pthread_mutex_unlock(&frame->pconn->write_lock);
+    release_pipelined_conn(frame->pconn);
   }
+  free(frame);
+}
 
-  if (fuel < 0) {
-    snprintf(response, MAXLINE, "Error: Invalid 'fuel' value (%d)\n", fuel);
+/** Parks a pipelined SCHEDULE request (`#<id>` already taken off) in the
+ *  airport's window, with `SCHEDULE_WINDOW_US`, rather than have the worker
+ *  wait for the window to be solved. Its frame is then sent by the window
+ *  thread, on the threaded server's `pconn` or the reactor's `rconn`, which
+ *  is kept open until then. Returns 1 if the request was parked, and 0 if
+ *  it should be answered as usual. */
+static int park_schedule_frame(unsigned id, const char *request, pipelined_conn_t *pconn,
+                               reactor_conn_t *rconn) {
+  parked_frame_t *frame;
+  wire_response_t error;
+  wire_flight_t flight;
+  wire_request_t req;
+
+  // Invalid requests get their error straight away
+  if (!SCHEDULE_WINDOW_US || wire_parse_request(request, strlen(request), &req) < 0 ||
+      req.type != WIRE_SCHEDULE ||
+      check_schedule(req.args[2], req.args[3], req.args[4], &error) < 0 ||
+      (frame = malloc(sizeof(parked_frame_t))) == NULL)
+    return 0;
+  *frame = (parked_frame_t){id, pconn, rconn};
+  flight = (wire_flight_t){req.args[1], req.args[2], req.args[3], req.args[4]};
+  if (rconn)
+    reactor_hold(rconn);
+  else
+    __atomic_add_fetch(&pconn->refs, 1, __ATOMIC_ACQ_REL);
+
+  // Without a window, the flight is placed on its own and answered at once
+  if (schedule_window_submit(&flight, send_parked_frame, frame) < 0)
+    send_parked_frame(frame, &flight,
+                      schedule_plane(flight.plane, flight.earliest, flight.duration, flight.fuel));
+  return 1;
+}
+
+void process_schedule_batch(const char *request_buf, size_t len, const wire_request_t *req,
+                            wio_t *out) {
+  wire_flight_t flights[WIRE_BATCH_MAX], valid[WIRE_BATCH_MAX];
+  wire_response_t recs[1 + WIRE_BATCH_MAX];
+  time_info_t results[WIRE_BATCH_MAX];
+  int count, num_valid = 0, scheduled = 0, positions[WIRE_BATCH_MAX];
+
+  if ((count = wire_parse_batch(request_buf, len, req, flights)) < 0) {
+    wire_error(recs, WIRE_SCHEDULE_BATCH, WIRE_INVALID_REQUEST, 0);
+    wire_write_text(recs, out);
     return;
   }
 
-  time_info_t time_info = schedule_plane(plane_id, earliest_time, duration, fuel);
-
-  // Format the response if the plane was scheduled
-  if (time_info.start_time != -1) {
-    snprintf(response, MAXLINE, "SCHEDULED %d at GATE %d: %02d:%02d-%02d:%02d\n", 
-      plane_id, time_info.gate_number, 
-      IDX_TO_HOUR(time_info.start_time), IDX_TO_MINS(time_info.start_time),
-      IDX_TO_HOUR(time_info.end_time), IDX_TO_MINS(time_info.end_time));
+  // Invalid flights get their error, and the rest are scheduled together
+  for (int i = 0; i < count; i++) {
+    if (check_schedule(flights[i].earliest, flights[i].duration, flights[i].fuel,
+                       &recs[1 + i]) == 0) {
+      positions[num_valid] = i;
+      valid[num_valid++] = flights[i];
+    }
   }
-  else {
-    snprintf(response, MAXLINE, "Error: Cannot schedule %d\n", plane_id);
+  if (num_valid > 0)
+    schedule_batch(valid, num_valid, req->args[1], results);
+  for (int i = 0; i < num_valid; i++) {
+    time_info_t *r = &results[i];
+    if (r->start_time != -1) {
+      recs[1 + positions[i]] = (wire_response_t){WIRE_SCHEDULE, WIRE_OK, 0,
+        {valid[i].plane, r->gate_number, r->start_time, r->end_time}};
+      scheduled++;
+    } else {
+      wire_error(&recs[1 + positions[i]], WIRE_SCHEDULE, WIRE_CANNOT_SCHEDULE, valid[i].plane);
+    }
   }
+
+  recs[0] = (wire_response_t){WIRE_SCHEDULE_BATCH, WIRE_OK, (uint16_t)count,
+    {AIRPORT_ID, scheduled, count, 0}};
+  wire_write_text(recs, out);
 }
 
-void process_plane_status(int *args, char *response) {
+void process_plane_status(const int32_t *args, wire_response_t *response) {
   // Extract the arguments from the request
   int plane_id = args[1];
 
   time_info_t time_info = lookup_plane_in_airport(plane_id);
 
-  // Format the response if the plane was scheduled
+  // Fill in the booking if the plane was scheduled
   if (time_info.start_time != -1) {
-    snprintf(response, MAXLINE, "PLANE %d scheduled at GATE %d: %02d:%02d-%02d:%02d\n",
-      plane_id, time_info.gate_number, 
-      IDX_TO_HOUR(time_info.start_time), IDX_TO_MINS(time_info.start_time),
-      IDX_TO_HOUR(time_info.end_time), IDX_TO_MINS(time_info.end_time));
+    *response = (wire_response_t){WIRE_PLANE_STATUS, WIRE_OK, 0,
+      {plane_id, time_info.gate_number, time_info.start_time, time_info.end_time}};
   }
   else {
-    snprintf(response, MAXLINE, "PLANE %d not scheduled at airport %d\n", plane_id, AIRPORT_ID);
+    *response = (wire_response_t){WIRE_PLANE_STATUS, WIRE_NOT_SCHEDULED, 0,
+      {plane_id, AIRPORT_ID, 0, 0}};
   }
 }
 
-void process_time_status(int *args, char *response) {
+void process_time_status(const int32_t *args, wire_response_t *response) {
   // Extract the arguments from the request
   int gate_num = args[1];
   int start_idx = args[2];
   int duration = args[3];
 
   if (gate_num < 0 || gate_num >= AIRPORT_DATA->num_gates) {
-    snprintf(response, MAXLINE, "Error: Invalid 'gate' value (%d)\n", gate_num);
+    wire_error(response, WIRE_TIME_STATUS, WIRE_INVALID_GATE, gate_num);
     return;
   }
 
   if (duration < 0 || duration >= NUM_TIME_SLOTS || start_idx + duration >= NUM_TIME_SLOTS) {
-    snprintf(response, MAXLINE, "Error: Invalid 'duration' value (%d)\n", duration);
+    wire_error(response, WIRE_TIME_STATUS, WIRE_INVALID_DURATION, duration);
     return;
   }
 
   // Get the gate from the gate index
   gate_t *gate = get_gate_by_idx(gate_num);
   if (gate == NULL) {
-    snprintf(response, MAXLINE, "Error: Invalid 'gate' value (%d)\n", gate_num);
+    wire_error(response, WIRE_TIME_STATUS, WIRE_INVALID_GATE, gate_num);
     return;
   }
 
-  // Temporary string to store the status of the gate
-  char status_str[MAXBUF] = "";
   int end_idx = start_idx + duration;
 
-  for (int i = start_idx; i <= end_idx; i++) {
-    time_slot_t *slot = get_time_slot_by_idx(gate, i);
-
-    pthread_mutex_lock(&slot->lock);
-    if (slot == NULL) {
-      snprintf(response, MAXLINE, "Error: Invalid request provided\n");
-      pthread_mutex_unlock(&slot->lock);
-      return;
-    }
-
-    // Get the status of the slot and the flight id
-    char status = (slot->status == 1) ? 'A' : 'F';
-    int flight_id = (slot->status == 1) ? slot->plane_id : 0;
-
-    pthread_mutex_unlock(&slot->lock);
-    char line[MAXLINE];
-
-    // Format the response line to be added to the status string
-    snprintf(line, sizeof(line), "AIRPORT %d GATE %d %02d:%02d: %c - %d\n", 
-      AIRPORT_ID, gate_num, IDX_TO_HOUR(i), IDX_TO_MINS(i), status, flight_id);
-
-    strcat(status_str, line);
+  if (get_time_slot_by_idx(gate, start_idx) == NULL) {
+    wire_error(response, WIRE_TIME_STATUS, WIRE_INVALID_REQUEST, 0);
+    return;
   }
-  strcpy(response, status_str);
-}
-
-int is_valid_schedule_request(char *command, int toks_cnt) {
-  // Check if the command is "SCHEDULE" and the number of tokens is 6
-  // toks_cnt = 1 (for command) + 5 (for args)
-  return strcmp(command, "SCHEDULE") == 0 && toks_cnt == 6;
-}
 
-int is_valid_plane_status_request(char *command, int toks_cnt) {
-  // Check if the command is "PLANE_STATUS" and the number of tokens is 3
-  // toks_cnt = 1 (for command) + 2 (for args)
-  return strcmp(command, "PLANE_STATUS") == 0 && toks_cnt == 3;
-}
-
-int is_valid_time_status_request(char *command, int toks_cnt) {
-  // Check if the command is "TIME_STATUS" and the number of tokens is 5
-  // toks_cnt = 1 (for command) + 4 (for args)
-  return strcmp(command, "TIME_STATUS") == 0 && toks_cnt == 5;
-}
+  // Take a consistent snapshot of the requested slots without locking
+  time_slot_t slots[NUM_TIME_SLOTS];
+  read_time_slots(gate, start_idx, end_idx, slots);
 
-void init_shared_queue(shared_queue_t *s_que, int n) {
-  s_que->n = n;
-  s_que->count = 0;
-  s_que->front = s_que->rear = 0;
-  s_que->fds_buf = calloc(n, sizeof(int));
-  pthread_mutex_init(&s_que->lock, NULL);
-  pthread_cond_init(&s_que->slots, NULL);
-  pthread_cond_init(&s_que->items, NULL);
+  *response = (wire_response_t){WIRE_TIME_STATUS, WIRE_OK, (uint16_t)(end_idx - start_idx + 1),
+    {AIRPORT_ID, gate_num, start_idx, 0}};
+  for (int i = start_idx; i <= end_idx; i++) {
+    time_slot_t *slot = &slots[i - start_idx];
+    int occupied = (slot->status == 1);
+    response[1 + i - start_idx] = (wire_response_t){WIRE_TIME_SLOT, WIRE_OK, 0,
+      {i, occupied, occupied ? slot->plane_id : 0, 0}};
+  }
 }
 
-void deinit_shared_queue(shared_queue_t *s_que) {
-  free(s_que->fds_buf);
-  pthread_mutex_destroy(&s_que->lock);
-  pthread_cond_destroy(&s_que->slots);
-  pthread_cond_destroy(&s_que->items);
-}
+void process_airport_status(const int32_t *args, wio_t *out) {
+  wire_response_t recs[WIRE_MAX_RECORDS];
+  int first = args[1];
+  int last = (args[2] == -1) ? AIRPORT_DATA->num_gates - 1 : args[2];
 
-void add_connection(shared_queue_t *s_que, int connfd) {
-  pthread_mutex_lock(&s_que->lock);
-  while (s_que->count == s_que->n) {
-    pthread_cond_wait(&s_que->slots, &s_que->lock);
+  if (first < 0 || first >= AIRPORT_DATA->num_gates) {
+    wire_error(recs, WIRE_AIRPORT_STATUS, WIRE_INVALID_GATE, first);
+    wire_write_text(recs, out);
+    return;
   }
-
-  // Add the file descriptor to the rear of the queue
-  s_que->fds_buf[s_que->rear] = connfd;
-  s_que->rear = (s_que->rear + 1) % s_que->n;  
-  s_que->count++;
-
-  // Signal the thread that there is an item in the queue
-  pthread_cond_signal(&s_que->items);
-  pthread_mutex_unlock(&s_que->lock);
-}
-
-int get_connection(shared_queue_t *s_que) {
-  int connfd;
-  pthread_mutex_lock(&s_que->lock);
-  while (s_que->count == 0) {
-    pthread_cond_wait(&s_que->items, &s_que->lock);
+  if (last < first || last >= AIRPORT_DATA->num_gates) {
+    wire_error(recs, WIRE_AIRPORT_STATUS, WIRE_INVALID_GATE, args[2]);
+    wire_write_text(recs, out);
+    return;
   }
-  
-  // Remove the file descriptor from the front of the queue
-  connfd = s_que->fds_buf[s_que->front];
-  s_que->front = (s_que->front + 1) % s_que->n;
-  s_que->count--;
 
-  // Signal the thread that there is a slot in the queue
-  pthread_cond_signal(&s_que->slots);
-  pthread_mutex_unlock(&s_que->lock);
-  return connfd;
+  // Stream one gate at a time: each gate is a consistent snapshot, and only
+  // one gate's records are held however many gates are dumped
+  for (int gate_num = first; gate_num <= last; gate_num++) {
+    int32_t gate_args[4] = {args[0], gate_num, 0, NUM_TIME_SLOTS - 1};
+    process_time_status(gate_args, recs);
+    wire_write_text(recs, out);
+  }
 }
-
@@ -1,7 +1,16 @@
 #ifndef AIRPORT_HEADER
 #define AIRPORT_HEADER
 
+#include "free_index.h"
 #include "network_utils.h"
+#include "occupancy.h"
+#include "pipeline.h"
+#include "plane_index.h"
+#include "reactor.h"
+#include "scheduler.h"
+#include "seqlock.h"
+#include "shm_link.h"
+#include "wire.h"
 #include <errno.h>
 #include <pthread.h>
 #include <stdio.h>
@@ -26,20 +35,121 @@
 #define IDX_TO_HOUR(idx) (((idx) >> 1))
 #define IDX_TO_MINS(idx) ((idx) & 1 ? 30lu : 0lu)
 
-/* Number of threads in thread pool */
-#define NUM_THREADS 8
+/* Empty line sent by airports after each response, so that the controller
+ * can tell where a reply ends on a connection that stays open. */
+#define RESPONSE_END "\n"
+
+/* Bounds of each of an airport's worker pools: the most workers (the
+ * controller's -W), and how many the pool starts with and keeps while idle
+ * (see `scheduler_start`). Set by the controller before the airports are
+ * forked. */
+extern int AIRPORT_THREADS;
+extern int AIRPORT_MIN_THREADS;
+
+/* Airports sharing this machine, and whether each forked airport pins its
+ * workers to its own share of the CPUs (the controller's -C). Set by the
+ * controller before the airports are forked. */
+extern int NUM_AIRPORTS;
+extern int PIN_AIRPORTS;
+
+/** How the controller and airport servers handle their client connections.
+ *  The mode is picked once at startup, before the airport nodes are forked. */
+typedef enum {
+  SERVER_THREADED, /* Each worker serves one blocking connection at a time */
+  SERVER_REACTOR,  /* Event loops multiplex every connection (see reactor.h) */
+  SERVER_URING,    /* Same, with the reactor's io_uring backend */
+} server_mode_t;
+
+extern server_mode_t SERVER_MODE;
+
+/* Responses are normally buffered per connection and written in batches
+ * while more requests are already waiting (see `wio_t`). Set (with the
+ * controller's -f) to write every response as soon as it is ready instead,
+ * for interactive clients. */
+extern int FLUSH_EACH_RESPONSE;
+
+/** How `schedule_plane` picks a gate for a flight. Picked with the
+ *  controller's -g before the airports are created. */
+typedef enum {
+  PROBE_FIRST,        /* Lowest-index gate first (deterministic, the default) */
+  PROBE_ROTATE,       /* From a start gate of each thread's own, wrapping around */
+  PROBE_LEAST_LOADED, /* Same, taking the least occupied of the next few gates */
+  PROBE_EARLIEST,     /* Earliest start across all gates (see `free_index.h`) */
+  PROBE_BEST_FIT,     /* Same, in the gate whose free run fits it most tightly */
+} probe_policy_t;
+
+extern probe_policy_t PROBE_POLICY;
+
+/* How long, in microseconds, an airport collects SCHEDULE requests before
+ * placing them together (see `schedule_in_window`). Set with the
+ * controller's -B; 0 places each request as soon as it arrives. */
+extern int SCHEDULE_WINDOW_US;
+
+/* With `-t shm`, the shared-memory links of the airports, indexed by airport
+ * id, mapped by the controller before the airports are forked (see
+ * `shm_link.h`). NULL when the airports are only reached over TCP. */
+extern shm_link_t *SHM_LINKS;
+
+/* With the controller's response cache (-c), the version numbers of the
+ * schedule of each airport, indexed by airport id, mapped by the controller
+ * before the airports are forked (see `schedule_versions_create`). NULL
+ * otherwise. */
+extern uint64_t **SCHEDULE_VERSIONS;
 
 /** Struct Definitions for airports and their schedules. **/
 
-/* Thread pool shared queue structure*/
-struct shared_queue_t {
-  pthread_mutex_t lock;
-  pthread_cond_t slots, items; // conditional variables
-  int front, rear, count, n;
-  int *fds_buf; // Buffer to store file descriptors
+/** A connection from the controller that carries pipelined requests (see
+ *  `pipeline.h`). Its requests are processed by the request workers in any
+ *  order, so responses are written under `write_lock`, and the connection is
+ *  closed once the reading thread and every outstanding request are done. */
+typedef struct pipelined_conn_t pipelined_conn_t;
+
+struct pipelined_conn_t {
+  int fd;
+  int refs; // Reading thread plus one per request in the queue
+  size_t msg_max; // Largest single write (see `socket_message_max`)
+  pthread_mutex_t write_lock;
 };
 
-typedef struct shared_queue_t shared_queue_t;
+/** A single pipelined request waiting for a request worker. */
+typedef struct request_task_t request_task_t;
+
+struct request_task_t {
+  pipelined_conn_t *conn;
+  unsigned id;
+  char request[MAXLINE];
+};
+
+/** This structure is used to represent a (gate index, start time, end time)
+ *  triple. This is used as a return value for functions
+ */
+typedef struct time_info_t time_info_t;
+
+struct time_info_t {
+  int gate_number;
+  int start_time;
+  int end_time;
+};
+
+/** @brief Called by the airport's window thread with the `result` of a
+ *         `flight` handed to `schedule_window_submit`, once its window has
+ *         been solved.
+ */
+typedef void (*window_done_fn)(void *ctx, const wire_flight_t *flight, time_info_t result);
+
+/** SCHEDULE requests collected in one window of `SCHEDULE_WINDOW_US`, each
+ *  with the callback its result goes to. It is freed by the window thread
+ *  once it has been solved. */
+typedef struct schedule_window_t schedule_window_t;
+
+struct schedule_window_t {
+  int count;                // Flights collected, at most `WIRE_BATCH_MAX`
+  struct timespec deadline; // When it closes, on the monotonic clock
+  schedule_window_t *next;  // Next closed window waiting to be solved
+  wire_flight_t flights[WIRE_BATCH_MAX];
+  window_done_fn done[WIRE_BATCH_MAX];
+  void *ctx[WIRE_BATCH_MAX];
+};
 
 typedef struct airport_t airport_t;
 
@@ -54,18 +164,60 @@ struct time_slot_t {
   /* When occupied, this is the index of the time slot in which the plane will
    * leave this gate. */
   int end_time;
-  /* Mutex lock for the time slot */
-  pthread_mutex_t lock;
 };
 
 typedef struct time_slot_t time_slot_t;
 
-/** This `gate_t` structure is currently just a wrapper for an array of time
- *  slots. We define it like this to make it easy to include any necessary extra
- *  information when implementing multithreading. */
+/** Each gate holds its array of time slots along with an occupancy bitmap that
+ *  mirrors the `status` of every slot (see `occupancy.h`). Windows are claimed
+ *  in the bitmap with a compare-and-swap, and the slots are then filled in by
+ *  a writer holding the gate's `seqlock`. Readers never lock: they take
+ *  snapshots under the seqlock and retry if a writer got in the way. */
+#ifndef COMPACT_GATES
 struct gate_t {
+  /* Points to this gate's word in `airport_t.occupancy`. Bit `i` is set when
+   * `time_slots[i]` is occupied. */
+  occupancy_t *occupancy;
+  /* Serialises writers to `time_slots` and validates lock-free readers. */
+  seqlock_t seqlock;
   time_slot_t time_slots[NUM_TIME_SLOTS];
 };
+#else
+/** When built with `COMPACT_GATES` (`make COMPACT=1`), a gate does not store
+ *  a copy of the booking in every time slot. Instead it keeps a small list of
+ *  bookings sorted by start time, each packed into one 64-bit word, so a gate
+ *  costs a few dozen bytes plus 8 bytes per booking instead of a full slot
+ *  array. Time slots are materialised from the bookings on demand.
+ */
+typedef uint64_t booking_t;
+
+#define PACK_BOOKING(plane_id, start, end) \
+  ((uint64_t)(unsigned)(plane_id) | ((uint64_t)(start) << 32) | ((uint64_t)(end) << 40))
+#define BOOKING_PLANE(b) ((int)(unsigned)((b) & 0xffffffffu))
+#define BOOKING_START(b) ((int)(((b) >> 32) & 0xff))
+#define BOOKING_END(b) ((int)(((b) >> 40) & 0xff))
+
+/** Bookings array of a gate. When it fills up, a larger copy replaces it, and
+ *  the old array is kept on the `retired` chain until the airport is freed so
+ *  that lock-free readers still walking it are never left dangling. */
+typedef struct booking_list_t booking_list_t;
+
+struct booking_list_t {
+  int capacity;
+  booking_list_t *retired;
+  booking_t items[];
+};
+
+struct gate_t {
+  /* Points to this gate's word in `airport_t.occupancy`. Bit `i` is set when
+   * time slot `i` is occupied. */
+  occupancy_t *occupancy;
+  /* Serialises writers to `bookings` and validates lock-free readers. */
+  seqlock_t seqlock;
+  int num_bookings;
+  booking_list_t *bookings; // Sorted by start time, NULL until the first booking
+};
+#endif
 
 typedef struct gate_t gate_t;
 
@@ -75,22 +227,39 @@ typedef struct gate_t gate_t;
  */
 struct airport_t {
   int num_gates;  // Number of gates in this airport
+  /* Occupancy bitmap of every gate, stored contiguously so that
+   * `schedule_plane` can test many gates at once with `occupancy_first_gate`. */
+  occupancy_t *occupancy;
+  /* Maps each scheduled plane_id to its booking, filled in by
+   * `add_plane_to_slots` so PLANE_STATUS does not need to scan the gates. */
+  plane_index_t *plane_index;
+  /* Free runs of every gate, kept when the airport is created under
+   * `PROBE_EARLIEST` or `PROBE_BEST_FIT`, and NULL otherwise. */
+  free_index_t *free_index;
+  /* The window collecting SCHEDULE requests with `SCHEDULE_WINDOW_US`, or
+   * NULL until the next request opens one, and the closed windows waiting to
+   * be solved, oldest first. Both are handled by the airport's window thread,
+   * started with the first window and woken on `window_cond`. */
+  schedule_window_t *window, *closed;
+  pthread_mutex_t window_lock;
+  pthread_cond_t window_cond;
+  pthread_t window_thread;
+  int window_airport_id; // Identifier the window thread selects the airport by
+  int window_running;    // Set once the window thread has been started
+  int window_stopping;   // Set by `destroy_airport` to stop it
+  /* Version numbers of the schedule, shared with the controller to tell
+   * which of its cached responses are out of date: `versions[0]` for the
+   * whole airport and `versions[1 + g]` for gate `g`, each bumped once a
+   * booking has been stored. NULL unless the controller caches responses. */
+  uint64_t *versions;
   gate_t gates[]; // Array of each gate.
 };
 
-/** This structure is used to represent a (gate index, start time, end time)
- *  triple. This is used as a return value for functions
- */
-typedef struct time_info_t time_info_t;
-
-struct time_info_t {
-  int gate_number;
-  int start_time;
-  int end_time;
-};
-
 /** Helper functions and macros defined for you to use. */
 
+/** @brief Frees an airport allocated by `create_airport`. */
+void destroy_airport(airport_t *data);
+
 /** @brief Allocates sufficient memory for an airport struct containing all
  *         information needed in an individual airport node.
  *
@@ -116,6 +285,22 @@ airport_t *create_airport(int num_gates);
  */
 void initialise_node(int airport_id, int num_gates, int listenfd);
 
+/** @brief Makes `data` the airport served by this process under the identifier
+ *         `airport_id`, without starting the server loop. This is used by
+ *         `initialise_node`, and lets benchmarks drive an airport directly.
+ */
+void attach_airport(int airport_id, airport_t *data);
+
+/** @brief Makes `data` the airport that the calling thread's requests go to,
+ *         under the identifier `airport_id`, in place of the one attached to
+ *         the process. With `NULL`, the thread goes back to that one.
+ *
+ *  This is how the controller hosts every airport in its own address space
+ *  (-t inproc): a worker selects the target airport of each request before
+ *  answering it with the functions below.
+ */
+void select_airport(int airport_id, airport_t *data);
+
 /** The following functions all require the airport to be instantiated  */
 
 /** @brief Returns a pointer to the `gate_idx`th gate schedule of the "global"
@@ -125,9 +310,21 @@ gate_t *get_gate_by_idx(int gate_idx);
 
 /** @brief Returns a pointer to the `slot_idx`th time slot in a gate. If the
  *         given `slot_idx` is out of range, returns NULL.
+ *
+ *  @note  With `COMPACT_GATES`, the slot is materialised from the gate's
+ *         bookings into a per-thread copy, which stays valid until the next
+ *         call from the same thread. Changes made through it are not stored.
  */
 time_slot_t *get_time_slot_by_idx(gate_t *gate, int slot_idx);
 
+/** @brief Copies the time slots `[start_idx]..[end_idx]` (inclusive) of a gate
+ *         into `out` as one consistent snapshot, without taking any lock.
+ *
+ *  @note  The range must be within `[0]..[NUM_TIME_SLOTS-1]`, and `out` must
+ *         have room for `end_idx - start_idx + 1` slots.
+ */
+void read_time_slots(gate_t *gate, int start_idx, int end_idx, time_slot_t *out);
+
 /** @brief  Checks whether the time slots of a given gate in the range
  *          `[start_idx]..[end_idx]` (inclusive) are all currently unoccupied.
  *
@@ -139,20 +336,21 @@ int check_time_slots_free(gate_t *gate, int start_idx, int end_idx);
  *         on the `plane_id`, `start_idx` and `end_idx` arguments. If the time
  *         slot is already marked as occupied, this function returns `-1` and
  *         the values in the time slot are not modified.
+ *
+ *  @note  The caller must hold the write side of the gate's seqlock.
  */
 int set_time_slot(time_slot_t *ts, int plane_id, int start_idx, int end_idx);
 
 /** @brief   Marks the time slots `[start]..[start_count]` (inclusive) of the
- *           given `gate` as occupied by a plane.
+ *           given `gate` as occupied by a plane, and records the booking in
+ *           the airport's plane index.
  *
- *  @returns `0` if all time slots successfully set, `-1` if there was an issue
- *           assigning any of the time slots.
+ *           The whole range is first reserved in the gate's occupancy bitmap
+ *           with a single compare-and-swap, so either every slot is assigned
+ *           or none of them are modified.
  *
- *  @warning In the case of a "partial success" where assigning the first `n`
- *           slots was successful, but the `n+1`th was already occupied, this
- *           function will return -1 to indicate an error, but any successfully
- *           updated time slots will remain modified. It is a good idea to call
- *           `check_time_slots_free` prior to calling this function.
+ *  @returns `0` if all time slots successfully set, `-1` if any of the time
+ *           slots was already occupied or out of range.
  */
 int add_plane_to_slots(gate_t *gate, int plane_id, int start, int count);
 
@@ -163,8 +361,8 @@ int add_plane_to_slots(gate_t *gate, int plane_id, int start, int count);
  */
 int search_gate(gate_t *gate, int plane_id);
 
-/** @brief   Searches through each gate of the airport for information about
- *           when a flight given by `plane_id` is
+/** @brief   Looks up information about when a flight given by `plane_id` is
+ *           scheduled, using the airport's plane index.
  *
  *  @returns A `time_info_t` structure that contains the gate number and start
  *           time for a given plane id. If the plane_id is not found anywhere in
@@ -172,10 +370,19 @@ int search_gate(gate_t *gate, int plane_id);
  * */
 time_info_t lookup_plane_in_airport(int plane_id);
 
+/** @brief   Same as `lookup_plane_in_airport`, but searches through each gate of
+ *           the airport with `search_gate` instead of using the plane index.
+ */
+time_info_t scan_plane_in_airport(int plane_id);
+
 /** @brief   Attempt to assign the given flight in this `gate`, based on it's
  *           required parameters (earliest landing time, duration of time to
  *           remain in the gate, remaining fuel).
  *
+ *           The earliest free window is found and reserved with one atomic
+ *           compare-and-swap on the gate's occupancy word, so concurrent
+ *           callers on the same gate always claim non-overlapping windows.
+ *
  *           If this function returns an index >= 0, this means the schedule was
  *           updated so that each time slot in range `[start]..[start+duration]`
  *           (inclusive) was updated to contain this flight information.
@@ -204,12 +411,86 @@ int assign_in_gate(gate_t *gate, int plane_id, int start, int duration, int fuel
 /** @brief  A function to attempt to schedule a flight in this airport, based on
  *          the required parameters.
  *
- *          This function will call `assign_in_gate` for each gate in the airport,
- *          and set the values of the returned `time_info_t` structure to the
- *          gate number and assigned starting time if successful.
+ *          This function picks a gate with a suitable window, calls
+ *          `assign_in_gate` on it, and sets the values of the returned
+ *          `time_info_t` structure to the gate number and assigned starting
+ *          time if successful. Which gate is picked depends on `PROBE_POLICY`:
+ *
+ *          - `PROBE_FIRST`: the lowest-index gate, found with
+ *            `occupancy_first_gate`. The result is the same as calling
+ *            `assign_in_gate` on each gate in order.
+ *
+ *          - `PROBE_ROTATE`: the first gate at or after the calling thread's
+ *            start gate, wrapping around. Each thread starts at a different
+ *            gate, and moves on past the gate it last assigned, so that
+ *            concurrent callers claim windows in different gates rather than
+ *            all retrying on gate 0.
+ *
+ *          - `PROBE_LEAST_LOADED`: of the first few gates that fit from the
+ *            same start gate, the one with the fewest occupied slots (see
+ *            `occupancy_least_loaded_gate`), which also spreads the bookings
+ *            evenly over the gates.
+ *
+ *          - `PROBE_EARLIEST`: the lowest-index gate of those where the flight
+ *            can start soonest, found with the airport's `free_index`, so that
+ *            a plane is not kept waiting (and burning fuel) at the first gate
+ *            with any window when another gate is free earlier.
+ *
+ *          - `PROBE_BEST_FIT`: of the same gates, the one whose free run from
+ *            that start is the shortest.
+ *
+ *          Under all but `PROBE_FIRST`, a plane may get a different gate than
+ *          with `PROBE_FIRST`, and under the last two a different start time.
+ *          The last two look up and claim the window under the index's lock,
+ *          and fall back to `PROBE_FIRST` in an airport created without the
+ *          index.
  */
 time_info_t schedule_plane(int plane_id, int start, int duration, int fuel);
 
+/** @brief Schedules the `count` flights of a batch at once, storing the
+ *         booking of `flights[i]` (or -1s if it could not be scheduled) in
+ *         `results[i]`.
+ *
+ *         Windows are claimed for every flight in one pass, and only then are
+ *         the bookings stored, so that the free-interval index (with
+ *         `PROBE_EARLIEST` or `PROBE_BEST_FIT`) is locked once per batch rather
+ *         than once per flight. With `by_urgency`, the flights are placed in
+ *         order of the last slot their fuel lets them start in, so that the
+ *         planes that can wait least get the first pick; otherwise in the
+ *         order given. Each is placed as `schedule_plane` would.
+ *
+ *  @note  `count` is at most `WIRE_BATCH_MAX`.
+ */
+void schedule_batch(const wire_flight_t *flights, int count, int by_urgency,
+                    time_info_t *results);
+
+/** @brief Adds a flight to the airport's current window of SCHEDULE
+ *         requests, without waiting for it: `done` is called with `ctx` and
+ *         the result, from the airport's window thread, once the window has
+ *         been solved.
+ *
+ *         The first request to arrive opens a window, and the window closes
+ *         `SCHEDULE_WINDOW_US` later, or as soon as it holds `WIRE_BATCH_MAX`
+ *         flights. Its flights are then placed together with
+ *         `schedule_batch` by urgency, so that a plane short of fuel is not
+ *         refused a gate taken a moment earlier by one that could have
+ *         waited. Requests arriving in the meantime open the next window.
+ *
+ *  @returns 0 on success, -1 if the flight could not be added (e.g. out of
+ *           memory), in which case `done` is never called.
+ */
+int schedule_window_submit(const wire_flight_t *flight, window_done_fn done, void *ctx);
+
+/** @brief Schedules a flight in the airport's current window of SCHEDULE
+ *         requests (see `schedule_window_submit`), blocking the caller until
+ *         the window has been solved. Servers park pipelined requests with
+ *         `schedule_window_submit` instead, so that this is only used where
+ *         the caller has nothing else to do in the meantime.
+ *
+ *  @returns The same as `schedule_plane`.
+ */
+time_info_t schedule_in_window(int plane_id, int start, int duration, int fuel);
+
 /** @brief The main server loop for an individual airport node.
  *
  *  @todo  Implement this function!
@@ -220,91 +501,116 @@ time_info_t schedule_plane(int plane_id, int start, int duration, int fuel);
  */
 void airport_node_loop(int listenfd);
 
-/** @brief Process the request from controller *
+/** @brief Process the request from controller and write the response to it,
+ *         followed by `RESPONSE_END`.
+ * @param request_buf The buffer containing the request from controller
+ * @param len The length of the request (it need not be NUL-terminated)
+ * @param out The buffered connection to the controller
+ */
+void process_request(const char *request_buf, size_t len, wio_t *out);
+
+/** @brief Process the request from controller, generating the response
+ *         (without `RESPONSE_END`) straight into the output buffer `out`.
+ *         Long responses are written out in chunks as they are generated.
  * @param request_buf The buffer containing the request from controller
- * @param connfd The file descriptor of the connection to the controller
+ * @param len The length of the request (it need not be NUL-terminated)
+ * @param out The buffered connection to write the response to
+ */
+void write_response(const char *request_buf, size_t len, wio_t *out);
+
+/** @brief Same as `write_response`, for a request that is already parsed.
+ * @param req The request record
+ * @param out The buffered connection to write the response to
  */
-void process_request(char *request_buf, int connfd);
+void write_parsed_response(const wire_request_t *req, wio_t *out);
+
+/** @brief The thread routine that serves one of the airport's shared-memory
+ *         channels, for as long as the controller is alive.
+ * @param arg The channel (a `shm_channel_t`)
+ * @return NULL
+ */
+void *airport_channel_routine(void *arg);
+
+/** @brief The thread routine for the airport workers that process pipelined
+ *         requests and write their response frames.
+ * @param arg The scheduler of the request workers (a `scheduler_t`)
+ * @return NULL
+ */
+void *airport_request_routine(void *arg);
+
+/** @brief Executes a request record, storing the response records (a header,
+ *         followed by `header.count` TIME_SLOT records) in `out`, which must
+ *         hold `WIRE_MAX_RECORDS` records. Both the text and the binary
+ *         protocol are answered from these records.
+ * @param req The request record
+ * @param out The response records
+ * @return The number of response records
+ */
+int execute_request(const wire_request_t *req, wire_response_t *out);
+
+/** @brief Process a request record received in the binary protocol, storing
+ *         the encoded response records in `out`, which must hold
+ *         `WIRE_MAX_RECORDS * WIRE_RESPONSE_SIZE` bytes.
+ * @param request The encoded request record (`WIRE_REQUEST_SIZE` bytes)
+ * @param out The buffer to store the encoded response in
+ * @return The length of the response
+ */
+size_t build_binary_response(const uint8_t *request, uint8_t *out);
 
 /** @brief Process the schedule request 
  * @param args The arguments array of the request 
- * @param response The response buffer to store the response to the controller
+ * @param response The response record to fill in
 */
-void process_schedule(int *args, char *response);
+void process_schedule(const int32_t *args, wire_response_t *response);
+
+/**
+ * @brief Process the schedule batch request, whose head is already parsed
+ *        into `req`, writing one header line and then the response of each
+ *        flight, in the order they were sent, to `out`
+ * @param request_buf The buffer containing the whole request line
+ * @param len The length of the request (it need not be NUL-terminated)
+ * @param req The parsed head of the request (airport, order)
+ * @param out The buffered connection to write the response to
+*/
+void process_schedule_batch(const char *request_buf, size_t len, const wire_request_t *req,
+                            wio_t *out);
 
 /** 
  * @brief Process the plane status request
  * @param args The arguments array of the request 
- * @param response The response buffer to store the response to the controller
+ * @param response The response record to fill in
 */
-void process_plane_status(int *args, char *response);
+void process_plane_status(const int32_t *args, wire_response_t *response);
 
 /** 
  * @brief Process the time status request
  * @param args The arguments array of the request 
- * @param response The response buffer to store the response to the controller
-*/
-void process_time_status(int *args, char *response);
-
-/** 
- * @brief Check if the schedule request is valid
- * @param command The command string of the request
- * @param toks_cnt The number of tokens in the request where toks_cnt = 1 (for command) + 5 (for args)
- * @return 1 if the request is valid, 0 otherwise
+ * @param response The header record, followed by room for one record per
+ *                 requested time slot
 */
-int is_valid_schedule_request(char *command, int toks_cnt);
-
-/** 
- * @brief Check if the plane status request is valid
- * @param command The command string of the request
- * @param toks_cnt The number of tokens in the request where toks_cnt = 1 (for command) + 2 (for args)
- * @return 1 if the request is valid, 0 otherwise
-*/
-int is_valid_plane_status_request(char *command, int toks_cnt);
+void process_time_status(const int32_t *args, wire_response_t *response);
 
 /**
- * @brief Check if the time status request is valid
- * @param command The command string of the request
- * @param toks_cnt The number of tokens in the request where toks_cnt = 1 (for command) + 4 (for args)
- * @return 1 if the request is valid, 0 otherwise
+ * @brief Process the airport status request, streaming the time status of
+ *        every slot of the requested gates to `out`, one gate at a time
+ * @param args The arguments array of the request (airport, first gate, last
+ *             gate or -1)
+ * @param out The buffered connection to write the response to
 */
-int is_valid_time_status_request(char *command, int toks_cnt);
+void process_airport_status(const int32_t *args, wio_t *out);
 
-/* Thread pool helper functions */
-
-/** @brief Initialize the shared queue 
- * @param s_que The shared queue to initialize
- * @param n The size of the shared queue
-*/
-void init_shared_queue(shared_queue_t *s_que, int n);
-
-/** @brief Add a client connection to the shared queue
- * @param s_que The shared queue to add the connection to
- * @param connfd The file descriptor of the connection to add
-*/
-void add_connection(shared_queue_t *s_que, int connfd);
-
-/** @brief Get a client connection from the shared queue
- * @param s_que The shared queue to get the connection from
- * @return The file descriptor of the connection
-*/
-int get_connection(shared_queue_t *s_que);
+/* Thread pool routines */
 
 /** @brief The thread routine for the airport node
- * @param arg The argument to the thread routine
+ * @param arg The scheduler handing out connections (a `scheduler_t`)
  * @return NULL
 */
 void *airport_thread_routine(void *arg);
 
 /** @brief The thread routine for the controller node
- * @param arg The argument to the thread routine
+ * @param arg The scheduler handing out connections (a `scheduler_t`)
  * @return NULL
 */
 void *controller_thread_routine(void *arg);
 
-/** @brief Deinitialize the shared queue
- * @param s_que The shared queue to deinitialize
-*/
-void deinit_shared_queue(shared_queue_t *s_que);
-
 #endif
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "conn_pool.h"
+#include "wire.h"
+
+#include <poll.h>
+
+void conn_pool_init(conn_pool_t *pool, const sock_addr_t *addr, int size) {
+  pool->addr = *addr;
+  pool->size = size;
+  pool->num_open = 0;
+  pool->idle = NULL;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->available, NULL);
+}
+
+void conn_pool_deinit(conn_pool_t *pool) {
+  pooled_conn_t *conn, *next;
+  for (conn = pool->idle; conn; conn = next) {
+    next = conn->next;
+    close(conn->fd);
+    free(conn);
+  }
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->available);
+}
+
+/* Opens a new connection to the pool's airport, switched to the binary protocol
+ * if `binary` is set, or returns NULL on failure. */
+static pooled_conn_t *conn_open(conn_pool_t *pool, int binary) {
+  pooled_conn_t *conn;
+  int fd;
+
+  if ((fd = open_addr_clientfd(&pool->addr)) < 0)
+    return NULL;
+  if ((conn = malloc(sizeof(pooled_conn_t))) == NULL) {
+    close(fd);
+    return NULL;
+  }
+  conn->fd = fd;
+  conn->next = NULL;
+  conn->binary = binary;
+  rio_readinitb(&conn->rio, fd);
+  if (binary && wire_negotiate(fd, &conn->rio) < 0) {
+    close(fd);
+    free(conn);
+    return NULL;
+  }
+  return conn;
+}
+
+/* An idle connection should have nothing to read: if it is readable, the
+ * airport either closed it or sent data nobody asked for. */
+static int conn_is_healthy(pooled_conn_t *conn) {
+  struct pollfd pfd = {.fd = conn->fd, .events = POLLIN};
+  return conn->rio.rio_cnt == 0 && poll(&pfd, 1, 0) == 0;
+}
+
+/* Unlinks and returns the first idle connection of the given kind (or of
+ * either kind if `binary` is negative). Requires `pool->lock`. */
+static pooled_conn_t *take_idle(conn_pool_t *pool, int binary) {
+  pooled_conn_t **link, *conn;
+  for (link = &pool->idle; (conn = *link) != NULL; link = &conn->next) {
+    if (binary < 0 || conn->binary == binary) {
+      *link = conn->next;
+      return conn;
+    }
+  }
+  return NULL;
+}
+
+pooled_conn_t *conn_pool_acquire(conn_pool_t *pool, int binary) {
+  pooled_conn_t *conn = NULL, *stale = NULL;
+
+  pthread_mutex_lock(&pool->lock);
+  while ((conn = take_idle(pool, binary)) == NULL && pool->num_open == pool->size) {
+    // Full, but an idle connection of the other kind can make way for ours
+    if ((stale = take_idle(pool, -1)) != NULL)
+      break;
+    pthread_cond_wait(&pool->available, &pool->lock);
+  }
+  if (conn == NULL && stale == NULL)
+    pool->num_open++; // Reserve a place for the connection opened below
+  pthread_mutex_unlock(&pool->lock);
+
+  if (stale) {
+    close(stale->fd);
+    free(stale);
+  }
+  if (conn && !conn_is_healthy(conn)) {
+    close(conn->fd);
+    free(conn);
+    conn = NULL;
+  }
+  if (conn == NULL && (conn = conn_open(pool, binary)) == NULL)
+    conn_pool_release(pool, NULL, 0);
+  return conn;
+}
+
+void conn_pool_release(conn_pool_t *pool, pooled_conn_t *conn, int healthy) {
+  if (!healthy && conn) {
+    close(conn->fd);
+    free(conn);
+    conn = NULL;
+  }
+  pthread_mutex_lock(&pool->lock);
+  if (conn) {
+    conn->next = pool->idle;
+    pool->idle = conn;
+  } else {
+    pool->num_open--;
+  }
+  pthread_cond_signal(&pool->available);
+  pthread_mutex_unlock(&pool->lock);
+}
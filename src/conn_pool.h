@@ -0,0 +1,67 @@
+#ifndef CONN_POOL_HEADER
+#define CONN_POOL_HEADER
+
+#include "network_utils.h"
+#include <pthread.h>
+
+/** A pool of long-lived connections from the controller to one airport node.
+ *
+ *  Connections are opened lazily, up to `size` at once, and handed out to one
+ *  controller worker at a time. Since each airport worker thread serves one
+ *  connection for as long as it stays open, `size` should not exceed the
+ *  number of worker threads in the airport. The airport's address is resolved
+ *  once before the pool is created, so reconnecting never repeats the lookup.
+ *
+ *  Airports terminate each response with `RESPONSE_END` (see `airport.h`),
+ *  which is how the controller knows where a reply ends without waiting for
+ *  the airport to close the socket. Connections can also be switched to the
+ *  binary protocol (see `wire.h`) when they are opened; text and binary
+ *  connections share the `size` budget, and an idle connection of the other
+ *  kind is replaced when the pool is full.
+ */
+typedef struct pooled_conn_t pooled_conn_t;
+
+struct pooled_conn_t {
+  int fd;
+  rio_t rio;           /* Buffered reader for the airport's responses */
+  int binary;          /* Speaks the binary protocol rather than text */
+  pooled_conn_t *next; /* Next idle connection in the pool */
+};
+
+typedef struct conn_pool_t conn_pool_t;
+
+struct conn_pool_t {
+  pthread_mutex_t lock;
+  pthread_cond_t available; /* Signalled when a connection is released */
+  int size;                 /* Maximum number of open connections */
+  int num_open;             /* Connections currently open (idle or in use) */
+  pooled_conn_t *idle;      /* Stack of idle connections */
+  sock_addr_t addr;         /* The airport's address, TCP or Unix domain */
+};
+
+/** @brief Initialises a pool of at most `size` connections to `addr`. No
+ *         connection is opened until one is first acquired.
+ */
+void conn_pool_init(conn_pool_t *pool, const sock_addr_t *addr, int size);
+
+/** @brief Closes every idle connection and releases the pool's resources. */
+void conn_pool_deinit(conn_pool_t *pool);
+
+/** @brief Takes a connection speaking the text protocol, or the binary one if
+ *         `binary` is set, out of the pool, blocking while all `size`
+ *         connections are in use.
+ *
+ *         Idle connections are health checked before being handed out: if the
+ *         airport closed its end (or sent unexpected data), the connection is
+ *         dropped and a fresh one is opened in its place.
+ *
+ *  @returns The connection, or `NULL` if a new connection could not be opened.
+ */
+pooled_conn_t *conn_pool_acquire(conn_pool_t *pool, int binary);
+
+/** @brief Returns a connection to the pool. If `healthy` is 0, for example
+ *         after a read or write error, the connection is closed instead.
+ */
+void conn_pool_release(conn_pool_t *pool, pooled_conn_t *conn, int healthy);
+
+#endif
@@ -1,26 +1,52 @@
 #include <errno.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
 #include "airport.h"
+#include "conn_pool.h"
+#include "pipeline.h"
+#include "status_cache.h"
 
 #define PORT_STRLEN 6
 #define DEFAULT_PORTNUM 1024
 #define MIN_PORTNUM 1024
 #define MAX_PORTNUM 65535
 
+/* Most workers -w or -W may give a pool. */
+#define MAX_POOL_THREADS 1024
+
 /** Struct that contains information associated with each airport node. */
 typedef struct airport_node_info {
   int id;    /* Airport identifier */
   int port;  /* Port num associated with this airport's listening socket */
   pid_t pid; /* PID of the child process for this airport. */
+  conn_pool_t pool; /* Persistent connections used to forward requests, and
+                       binary requests even with -P */
+  pipeline_t pipeline; /* Pipelined connection used instead of `pool` with -P */
+  shm_endpoint_t *shm; /* Shared-memory channels used instead of `pool` for
+                          text requests with -t shm */
+  airport_t *data;     /* The airport itself, hosted by the controller with
+                          -t inproc instead of being forked */
 } node_info_t;
 
+/** How the controller reaches its airport nodes (-t). Either way, clients
+ *  connect to the controller over TCP. */
+typedef enum {
+  TRANSPORT_TCP, /* Loopback TCP connections to each airport's port */
+  TRANSPORT_SHM, /* Rings in memory shared with the forked airports */
+  TRANSPORT_UNIX,      /* Unix domain stream sockets, one per airport */
+  TRANSPORT_SEQPACKET, /* Unix domain SOCK_SEQPACKET sockets, one per airport */
+  TRANSPORT_INPROC,    /* No airport nodes: the controller's workers answer
+                          requests from the airports in its own memory */
+} transport_t;
+
 /** Struct that contains parameters for the controller node and ATC network as
  *  a whole. */
 typedef struct controller_params_t {
@@ -29,28 +55,143 @@ typedef struct controller_params_t {
   int num_airports;           /* number of airports to create */
   int *gate_counts;           /* array containing the number of gates in each airport */
   node_info_t *airport_nodes; /* array of info associated with each airport */
+  int pipelined;              /* whether requests are pipelined to airports (-P) */
+  int binary;                 /* whether text requests use the binary protocol (-b) */
+  transport_t transport;      /* how requests reach the airports (-t) */
+  int num_threads;            /* most workers of the controller (-w) */
+  int min_threads;            /* workers the controller starts with */
+  int airport_threads;        /* most workers in each pool of an airport (-W) */
+  int cache_kb;               /* most memory of the response cache, in KB (-c) */
+  status_cache_t *cache;      /* responses to status requests (-c), or NULL */
 } controller_params_t;
 
 controller_params_t ATC_INFO;
 
-shared_queue_t controller_shared_queue;
+scheduler_t controller_scheduler;
+
+/* Event loops used in `SERVER_REACTOR` mode. */
+reactor_t controller_reactor;
+
+static void controller_reactor_handler(reactor_conn_t *conn, reactor_line_t *request);
+
+/** @brief Writes the path of the Unix domain socket of the airport on `port`
+ *         (with -t unix or seqpacket) to `path`: a socket file in
+ *         `$XDG_RUNTIME_DIR/atc-<controller port>` (or under /tmp), so that
+ *         controllers on different ports do not collide.
+ *
+ *  @returns The directory's length in `path`.
+ */
+static size_t airport_socket_path(int port, char *path, size_t size) {
+  const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+  int dir_len;
+
+  if (runtime_dir == NULL || runtime_dir[0] == '\0')
+    runtime_dir = "/tmp";
+  dir_len = snprintf(path, size, "%s/atc-%d", runtime_dir, ATC_INFO.portnum);
+  snprintf(path + dir_len, size - (size_t)dir_len, "/airport-%d.sock", port);
+  return (size_t)dir_len;
+}
+
+/** @brief Resolves the address the controller connects to the airport `node`
+ *         at: its TCP port, or its Unix domain socket.
+ *
+ *  @returns 0 on success, -1 on failure.
+ */
+static int airport_address(node_info_t *node, sock_addr_t *addr) {
+  char path[MAXLINE], port_str[PORT_STRLEN];
+
+  if (ATC_INFO.transport == TRANSPORT_UNIX || ATC_INFO.transport == TRANSPORT_SEQPACKET) {
+    airport_socket_path(node->port, path, sizeof(path));
+    return make_unix_addr(path,
+                          ATC_INFO.transport == TRANSPORT_SEQPACKET ? SOCK_SEQPACKET : SOCK_STREAM,
+                          addr);
+  }
+  snprintf(port_str, PORT_STRLEN, "%d", node->port);
+  return resolve_inet_addr("localhost", port_str, addr);
+}
+
+/** @brief Opens the listening socket the airport on `port` serves: the TCP
+ *         port itself, or with -t unix or seqpacket, a Unix domain socket in
+ *         a directory only the user can enter. Clients still reach the
+ *         controller over TCP.
+ *
+ *  @returns The socket, or -1 (with errno set) on failure.
+ */
+static int open_airport_listenfd(char *port) {
+  char path[MAXLINE];
+  size_t dir_len;
+
+  if (ATC_INFO.transport != TRANSPORT_UNIX && ATC_INFO.transport != TRANSPORT_SEQPACKET)
+    return open_listenfd(port);
+  dir_len = airport_socket_path(atoi(port), path, sizeof(path));
+  path[dir_len] = '\0';
+  if (mkdir(path, 0700) < 0 && errno != EEXIST)
+    return -1;
+  path[dir_len] = '/';
+  return open_unix_listenfd(path,
+                            ATC_INFO.transport == TRANSPORT_SEQPACKET ? SOCK_SEQPACKET : SOCK_STREAM);
+}
 
 /** @brief The main server loop of the controller.
  *
  *  @todo  Implement this function!
  */
 void controller_server_loop(void) {
-  init_shared_queue(&controller_shared_queue, 20);
+  sock_addr_t addr;
 
-  // Create worker threads for the controller
-  pthread_t tid[NUM_THREADS];
-  for (int i = 0; i < NUM_THREADS; i++) {
-    if (pthread_create(&tid[i], NULL, controller_thread_routine, &controller_shared_queue) != 0) {
-      perror("pthread_create");
+  // A pooled connection can be closed by its airport at any time, so report
+  // failed writes as errors rather than being killed by SIGPIPE
+  signal(SIGPIPE, SIG_IGN);
+
+  // The controller may use every CPU, and keeps at least 8 workers unless -w
+  // says otherwise, so that the threaded server still serves 8 clients at
+  // once on a small machine
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cpus < 1)
+    cpus = 1;
+  if (ATC_INFO.num_threads == 0)
+    ATC_INFO.num_threads = (cpus > 8) ? (int)cpus : 8;
+  ATC_INFO.min_threads = (cpus < ATC_INFO.num_threads) ? (int)cpus : ATC_INFO.num_threads;
+
+  // Set up the connection pool of each airport. Each pooled connection keeps
+  // one airport worker busy, so never open more than the airport has, minus
+  // the pipelined connection's. The pool still carries binary requests with -P.
+  for (int idx = 0; idx < ATC_INFO.num_airports && ATC_INFO.transport != TRANSPORT_INPROC; idx++) {
+    node_info_t *node = &ATC_INFO.airport_nodes[idx];
+    if (airport_address(node, &addr) < 0 ||
+        (ATC_INFO.pipelined && pipeline_init(&node->pipeline, &addr) < 0))
       exit(1);
+    conn_pool_init(&node->pool, &addr,
+                   ATC_INFO.pipelined ? AIRPORT_THREADS - 1 : AIRPORT_THREADS);
+    if (SHM_LINKS != NULL) {
+      if ((node->shm = malloc(sizeof(shm_endpoint_t))) == NULL)
+        exit(1);
+      shm_endpoint_init(node->shm, &SHM_LINKS[idx]);
     }
   }
 
+  // In reactor mode the workers answer requests read by the event loops,
+  // rather than each serving a whole connection
+  reactor_backend_t backend = (SERVER_MODE == SERVER_URING) ? REACTOR_URING : REACTOR_EPOLL;
+  if (scheduler_init(&controller_scheduler, ATC_INFO.num_threads,
+                     SERVER_MODE != SERVER_THREADED ? REACTOR_QUEUE_SIZE : 20) < 0)
+    exit(1);
+  int reactor = (SERVER_MODE != SERVER_THREADED &&
+                 reactor_init(&controller_reactor, controller_reactor_handler,
+                              &controller_scheduler, backend) == 0);
+
+  // Start the worker threads for the controller, more of which are started
+  // while every one of them is busy
+  if (scheduler_start(&controller_scheduler, ATC_INFO.min_threads,
+                      reactor ? reactor_worker_routine : controller_thread_routine,
+                      reactor ? (void *)&controller_reactor : &controller_scheduler) < 0) {
+    perror("pthread_create");
+    exit(1);
+  }
+
+  if (reactor)
+    reactor_serve(&controller_reactor, ATC_INFO.listenfd);
+
   int connfd;
   struct sockaddr_storage clientaddr;
   socklen_t clientlen = sizeof(struct sockaddr_storage);
@@ -61,25 +202,409 @@ void controller_server_loop(void) {
       perror("accept");
       continue;
     }
-    add_connection(&controller_shared_queue, connfd);
+    scheduler_submit_fd(&controller_scheduler, connfd);
+  }
+
+  scheduler_deinit(&controller_scheduler);
+}
+
+/** @brief Relays an airport's response from `rio` to the client's buffer
+ *         `out` as it arrives, however long it is, up to the `RESPONSE_END`
+ *         that marks its end. Sets `*relayed` once any of it was.
+ *
+ *  @returns 0 once the whole response was relayed, -1 if the connection
+ *           broke first.
+ */
+static int relay_response(rio_t *rio, wio_t *out, int *relayed) {
+  char *line;
+  ssize_t n;
+
+  // Copy each line straight out of the connection's read buffer into the
+  // client's
+  while ((n = rio_readlinep(rio, &line, MAXLINE)) > 0) {
+    if ((size_t)n == strlen(RESPONSE_END) && memcmp(line, RESPONSE_END, (size_t)n) == 0)
+      return 0;
+    wio_writen(out, line, (size_t)n);
+    *relayed = 1;
+  }
+  return -1;
+}
+
+/** @brief Forwards one request line to an airport over a pooled connection,
+ *         and relays the airport's response to the client's buffer `out`.
+ *
+ *  If the pooled connection turns out to be broken before any of the response
+ *  was received, the request is retried once on a fresh connection.
+ *
+ *  @returns 0 once the whole response was relayed, -1 otherwise.
+ */
+static int forward_request(int airport_id, char *request, wio_t *out) {
+  conn_pool_t *pool = &ATC_INFO.airport_nodes[airport_id].pool;
+  pooled_conn_t *conn;
+  int relayed = 0;
+
+  for (int attempt = 0; attempt < 2 && !relayed; attempt++) {
+    if ((conn = conn_pool_acquire(pool, 0)) == NULL)
+      break;
+    if (rio_writen(conn->fd, request, strlen(request)) < 0) {
+      conn_pool_release(pool, conn, 0);
+      continue;
+    }
+    if (relay_response(&conn->rio, out, &relayed) == 0) {
+      conn_pool_release(pool, conn, 1);
+      return 0;
+    }
+    conn_pool_release(pool, conn, 0);
+  }
+
+  if (!relayed)
+    wio_printf(out, "Error: Airport %d is unavailable\n", airport_id);
+  return -1;
+}
+
+/** @brief Forwards one request line to an airport over one of its
+ *         shared-memory channels (-t shm), and relays the airport's response
+ *         to the client's buffer `out`.
+ *
+ *  Channels do not break unless the airport has died, so there is no retry;
+ *  the airport is reported as unavailable from then on.
+ *
+ *  @returns 0 once the whole response was relayed, -1 otherwise.
+ */
+static int forward_shm_request(int airport_id, char *request, wio_t *out) {
+  shm_endpoint_t *ep = ATC_INFO.airport_nodes[airport_id].shm;
+  int idx, relayed = 0, ret = 0;
+
+  if (__atomic_load_n(&ep->failed, __ATOMIC_RELAXED)) {
+    wio_printf(out, "Error: Airport %d is unavailable\n", airport_id);
+    return -1;
+  }
+  idx = shm_endpoint_acquire(ep);
+  if (shm_ring_write(&ep->link->channels[idx].requests, request, strlen(request)) < 0 ||
+      relay_response(&ep->rio[idx], out, &relayed) < 0) {
+    __atomic_store_n(&ep->failed, 1, __ATOMIC_RELAXED);
+    if (!relayed)
+      wio_printf(out, "Error: Airport %d is unavailable\n", airport_id);
+    ret = -1;
+  }
+  shm_endpoint_release(ep, idx);
+  return ret;
+}
+
+/** @brief Answers a request to an airport hosted by the controller (-t inproc)
+ *         in place, writing the response straight to the client's buffer
+ *         `out`: no copy of the request or response is ever made.
+ */
+static void answer_in_process(int airport_id, const wire_request_t *req, const char *buf,
+                              size_t n, wio_t *out) {
+  select_airport(airport_id, ATC_INFO.airport_nodes[airport_id].data);
+  // Only the head of a batch has been parsed; its flights are in the line
+  if (req->type == WIRE_SCHEDULE_BATCH)
+    process_schedule_batch(buf, n, req, out);
+  else
+    write_parsed_response(req, out);
+  select_airport(-1, NULL);
+}
+
+/** @brief Answers a binary request record to an airport hosted by the
+ *         controller (-t inproc), storing the encoded response records in
+ *         `response` (`WIRE_MAX_RECORDS * WIRE_RESPONSE_SIZE` bytes).
+ *
+ *  @returns The length of the response.
+ */
+static size_t answer_binary_in_process(int airport_id, const uint8_t *request, uint8_t *response) {
+  size_t len;
+  select_airport(airport_id, ATC_INFO.airport_nodes[airport_id].data);
+  len = build_binary_response(request, response);
+  select_airport(-1, NULL);
+  return len;
+}
+
+/** @brief Forwards one request line to an airport over its pipelined channel,
+ *         and writes the airport's response to the client's buffer `out`.
+ *
+ *  @returns 0 on success, -1 if the airport is unavailable.
+ */
+static int forward_pipelined_request(int airport_id, char *request, wio_t *out) {
+  char *reply;
+  size_t len;
+
+  if (pipeline_request(&ATC_INFO.airport_nodes[airport_id].pipeline, request, &reply, &len) < 0) {
+    wio_printf(out, "Error: Airport %d is unavailable\n", airport_id);
+    return -1;
+  }
+  wio_writen(out, reply, len);
+  free(reply);
+  return 0;
+}
+
+/** @brief Forwards one binary request record to an airport over a pooled
+ *         binary connection, and stores the encoded response records in
+ *         `response` (`WIRE_MAX_RECORDS * WIRE_RESPONSE_SIZE` bytes).
+ *
+ *  Like `forward_request`, a request whose connection broke before any of
+ *  the response was received is retried once on a fresh connection.
+ *
+ *  @returns The length of the response.
+ */
+static size_t forward_binary_request(int airport_id, const uint8_t *request, uint8_t *response) {
+  conn_pool_t *pool = &ATC_INFO.airport_nodes[airport_id].pool;
+  pooled_conn_t *conn;
+  wire_response_t header;
+  size_t rest;
+
+  for (int attempt = 0; attempt < 2; attempt++) {
+    if ((conn = conn_pool_acquire(pool, 1)) == NULL)
+      break;
+    if (rio_writen(conn->fd, (char *)request, WIRE_REQUEST_SIZE) < 0 ||
+        rio_readnb(&conn->rio, response, WIRE_RESPONSE_SIZE) != WIRE_RESPONSE_SIZE) {
+      conn_pool_release(pool, conn, 0);
+      continue;
+    }
+
+    // The header says how many slot records follow
+    wire_decode_response(response, &header);
+    rest = (size_t)header.count * WIRE_RESPONSE_SIZE;
+    if (header.count < WIRE_MAX_RECORDS &&
+        rio_readnb(&conn->rio, response + WIRE_RESPONSE_SIZE, rest) == (ssize_t)rest) {
+      conn_pool_release(pool, conn, 1);
+      return WIRE_RESPONSE_SIZE + rest;
+    }
+    conn_pool_release(pool, conn, 0);
+    break;
   }
 
-  deinit_shared_queue(&controller_shared_queue);
+  wire_error(&header, request[0], WIRE_UNAVAILABLE, airport_id);
+  wire_encode_response(&header, response);
+  return WIRE_RESPONSE_SIZE;
+}
+
+/** @brief Answers one binary request record from a client, storing the
+ *         encoded response records in `response`
+ *         (`WIRE_MAX_RECORDS * WIRE_RESPONSE_SIZE` bytes).
+ *
+ *  @returns The length of the response.
+ */
+static size_t answer_binary_request(const uint8_t *request, uint8_t *response) {
+  wire_request_t req;
+  wire_response_t error;
+
+  wire_decode_request(request, &req);
+  if (req.type != WIRE_SCHEDULE && req.type != WIRE_PLANE_STATUS && req.type != WIRE_TIME_STATUS)
+    wire_error(&error, req.type, WIRE_INVALID_REQUEST, 0);
+  else if (req.args[0] < 0 || req.args[0] >= ATC_INFO.num_airports)
+    wire_error(&error, req.type, WIRE_NO_SUCH_AIRPORT, req.args[0]);
+  else if (ATC_INFO.transport == TRANSPORT_INPROC)
+    return answer_binary_in_process(req.args[0], request, response);
+  else
+    return forward_binary_request(req.args[0], request, response);
+  wire_encode_response(&error, response);
+  return WIRE_RESPONSE_SIZE;
+}
+
+/** @brief Forwards a text request to an airport in the binary protocol (-b),
+ *         and renders the airport's response as text straight into the
+ *         client's buffer `out`.
+ *
+ *  @returns 0 on success, -1 if the airport is unavailable.
+ */
+static int forward_request_as_binary(const wire_request_t *req, wio_t *out) {
+  uint8_t request[WIRE_REQUEST_SIZE], reply[WIRE_MAX_RECORDS * WIRE_RESPONSE_SIZE];
+  wire_response_t recs[WIRE_MAX_RECORDS];
+  size_t len;
+
+  wire_encode_request(req, request);
+  len = forward_binary_request(req->args[0], request, reply);
+  for (size_t i = 0; i < len / WIRE_RESPONSE_SIZE; i++)
+    wire_decode_response(reply + i * WIRE_RESPONSE_SIZE, &recs[i]);
+  wire_write_text(recs, out);
+  return (recs[0].status == WIRE_UNAVAILABLE) ? -1 : 0;
+}
+
+/** @brief Has the airport `airport_id` answer the request line `buf` of
+ *         length `n`, parsed into `req`, however the controller reaches it,
+ *         writing the response to the client's buffer `out`.
+ *
+ *  @returns 0 on success, -1 if the airport is unavailable.
+ *
+ *  @note  `buf` must have room for one more character, as a newline is added
+ *         to the request if it does not end in one.
+ */
+static int answer_from_airport(int airport_id, const wire_request_t *req, char *buf, size_t n,
+                               wio_t *out) {
+  if (ATC_INFO.transport == TRANSPORT_INPROC) {
+    answer_in_process(airport_id, req, buf, n, out);
+    return 0;
+  }
+  // The airport reads whole lines, so make sure the request ends in one
+  if (buf[n - 1] != '\n') {
+    buf[n++] = '\n';
+    buf[n] = '\0';
+  }
+  // AIRPORT_STATUS and SCHEDULE_BATCH have no binary form, as a dump or a
+  // batch can exceed its records
+  if (ATC_INFO.pipelined)
+    return forward_pipelined_request(airport_id, buf, out);
+  if (ATC_INFO.transport == TRANSPORT_SHM)
+    return forward_shm_request(airport_id, buf, out);
+  if (ATC_INFO.binary && req->type != WIRE_AIRPORT_STATUS && req->type != WIRE_SCHEDULE_BATCH)
+    return forward_request_as_binary(req, out);
+  return forward_request(airport_id, buf, out);
+}
+
+/** A response on its way to the client's buffer `out`, whose text is kept
+ *  to be cached. */
+typedef struct {
+  wio_t *out;
+  char text[STATUS_CACHE_TEXT_MAX];
+  size_t len;
+  int overflowed; // Too long to be cached
+} captured_response_t;
+
+/** `wio_sink_fn` passing a response on to the client, keeping a copy. */
+static ssize_t capture_write(void *ctx, const void *buf, size_t n) {
+  captured_response_t *capture = ctx;
+  if (!capture->overflowed && n <= sizeof(capture->text) - capture->len) {
+    memcpy(capture->text + capture->len, buf, n);
+    capture->len += n;
+  } else {
+    capture->overflowed = 1;
+  }
+  return wio_writen(capture->out, buf, n);
+}
+
+/** @brief Answers a PLANE_STATUS or TIME_STATUS request from the response
+ *         cache (-c) if it holds the response at the current version of the
+ *         airport's schedule (of the gate's, for TIME_STATUS), or else from
+ *         the airport, caching its response.
+ */
+static void answer_cached(int airport_id, const wire_request_t *req, char *buf, size_t n,
+                          wio_t *out) {
+  uint64_t *versions = SCHEDULE_VERSIONS[airport_id], version;
+  int gate = req->args[1];
+  captured_response_t capture;
+  wio_t capture_out;
+  size_t len;
+  int ok;
+
+  // A gate out of range only ever gets an error, so any version will do
+  if (req->type == WIRE_TIME_STATUS && gate >= 0 && gate < ATC_INFO.gate_counts[airport_id])
+    version = __atomic_load_n(&versions[1 + gate], __ATOMIC_ACQUIRE);
+  else
+    version = __atomic_load_n(&versions[0], __ATOMIC_ACQUIRE);
+  // A hit is copied straight into the client's buffer
+  if ((len = status_cache_lookup(ATC_INFO.cache, req, version,
+                                 wio_reserve(out, STATUS_CACHE_TEXT_MAX))) > 0) {
+    wio_commit(out, len);
+    return;
+  }
+
+  // The version was read first, so the response is at least as new as it
+  capture.out = out;
+  capture.len = 0;
+  capture.overflowed = 0;
+  wio_init_sink(&capture_out, capture_write, &capture, 0);
+  ok = (answer_from_airport(airport_id, req, buf, n, &capture_out) == 0);
+  wio_flush(&capture_out);
+  if (ok && !capture.overflowed)
+    status_cache_store(ATC_INFO.cache, req, version, capture.text, capture.len);
+}
+
+/** @brief Answers CACHE_STATUS with the hit rate and memory use of the
+ *         response cache (-c).
+ */
+static void answer_cache_status(wio_t *out) {
+  status_cache_stats_t stats;
+  uint64_t lookups;
+
+  if (ATC_INFO.cache == NULL) {
+    wio_printf(out, "CACHE disabled\n");
+    return;
+  }
+  status_cache_stats(ATC_INFO.cache, &stats);
+  lookups = stats.hits + stats.misses;
+  wio_printf(out,
+             "CACHE: %" PRIu64 " hits, %" PRIu64 " misses (%.1f%% hit rate), %zu entries, "
+             "%zu bytes (%zu of %zu in entries)\n",
+             stats.hits, stats.misses, lookups ? 100.0 * (double)stats.hits / (double)lookups : 0,
+             stats.entries, stats.bytes, stats.entry_bytes, stats.capacity);
+}
+
+/** @brief Answers one request line `buf` of length `n` from a client, writing
+ *         the response to the client's buffer `out`.
+ *
+ *  @note  `buf` must have room for one more character, as a newline is added
+ *         to the request if it does not end in one.
+ */
+static void answer_request(char *buf, size_t n, wio_t *out) {
+  // Parse the request once; with -b the parsed record is what gets forwarded
+  wire_request_t req;
+  int airport_id;
+  if (wire_parse_request(buf, n, &req) < 0) {
+    wio_printf(out, "Error: Invalid request provided\n");
+    return;
+  }
+  if (req.type == WIRE_CACHE_STATUS) {
+    answer_cache_status(out);
+    return;
+  }
+  airport_id = req.args[0];
+
+  // If the airport id is valid, forward the request to the airport
+  if (airport_id >= 0 && airport_id < ATC_INFO.num_airports) {
+    if (ATC_INFO.cache && (req.type == WIRE_PLANE_STATUS || req.type == WIRE_TIME_STATUS))
+      answer_cached(airport_id, &req, buf, n, out);
+    else
+      answer_from_airport(airport_id, &req, buf, n, out);
+    return;
+  }
+  wio_printf(out, "Error: Airport %d does not exist\n", airport_id);
+}
+
+/** Answers a request received by the reactor in `SERVER_REACTOR` mode. */
+static void controller_reactor_handler(reactor_conn_t *conn, reactor_line_t *request) {
+  uint8_t response[WIRE_MAX_RECORDS * WIRE_RESPONSE_SIZE];
+  wio_t out;
+
+  if (request->binary) {
+    reactor_send(conn, (char *)response, answer_binary_request((uint8_t *)request->buf, response));
+  } else if (strcmp(request->buf, WIRE_HELLO) == 0) {
+    reactor_send(conn, WIRE_HELLO_OK, strlen(WIRE_HELLO_OK));
+  } else {
+    reactor_output_init(&out, conn);
+    answer_request(request->buf, request->len, &out);
+    wio_flush(&out);
+  }
+}
+
+/** Answers binary requests from a client that has just sent `WIRE_HELLO`,
+ *  until it hangs up. */
+static void serve_binary_client(rio_t *rio, wio_t *out) {
+  uint8_t request[WIRE_REQUEST_SIZE], response[WIRE_MAX_RECORDS * WIRE_RESPONSE_SIZE];
+  size_t len;
+
+  wio_writen(out, WIRE_HELLO_OK, strlen(WIRE_HELLO_OK));
+  wio_flush(out);
+  while (rio_readnb(rio, request, WIRE_REQUEST_SIZE) == WIRE_REQUEST_SIZE) {
+    len = answer_binary_request(request, response);
+    if (wio_writen(out, response, len) < 0 || (rio->rio_cnt <= 0 && wio_flush(out) < 0))
+      break;
+  }
 }
 
 void *controller_thread_routine(void *arg) {
   pthread_detach(pthread_self());
-  shared_queue_t *s_que = (shared_queue_t *)arg;
-  int connfd, airport_id;
+  scheduler_t *sched = (scheduler_t *)arg;
+  int connfd;
   char buf[MAXBUF];
-  rio_t controller_rio, airport_rio;
-
-  while (1) {
-    // Get a connection from the shared queue
-    connfd = get_connection(s_que);
+  rio_t controller_rio;
+  wio_t out;
 
-    // Initialize the Rio buffer for the controller
+  // Get a connection from the scheduler, until this worker is no longer needed
+  while ((connfd = scheduler_take_fd(sched)) >= 0) {
+    // Initialize the Rio buffers for the controller
     rio_readinitb(&controller_rio, connfd);
+    wio_init(&out, connfd, FLUSH_EACH_RESPONSE);
     ssize_t n;
 
     // Read the request from the connection
@@ -92,49 +617,18 @@ void *controller_thread_routine(void *arg) {
         break;
       }
 
-      // Extract the command and the arguments from the request
-      char command[20], response[MAXBUF], port_str[PORT_STRLEN];
-      int args[5];
-      int toks_cnt;
-      toks_cnt = sscanf(buf, "%s %d %d %d %d %d", command, &args[0], &args[1], &args[2], &args[3], &args[4]);
-
-      // If the request is valid, extract the airport id
-      if (is_valid_schedule_request(command, toks_cnt) ||
-          is_valid_plane_status_request(command, toks_cnt) ||
-          is_valid_time_status_request(command, toks_cnt)) {
-        airport_id = args[0]; 
-      }
-      else {
-        sprintf(response, "Error: Invalid request provided\n");
-        rio_writen(connfd, response, strlen(response));
-        continue;
+      // The rest of the connection uses the binary protocol
+      if (strcmp(buf, WIRE_HELLO) == 0) {
+        serve_binary_client(&controller_rio, &out);
+        break;
       }
 
-      // If the airport id is valid, open a connection to the airport
-      if (airport_id >= 0 && airport_id < ATC_INFO.num_airports) {
-        snprintf(port_str, PORT_STRLEN, "%d", ATC_INFO.airport_nodes[airport_id].port);
-        int airport_fd = open_clientfd("localhost", port_str);
-
-        // Initialize the Rio buffer for the airport
-        rio_readinitb(&airport_rio, airport_fd);
-
-        // Send the request to the airport
-        rio_writen(airport_fd, buf, strlen(buf));
-        rio_writen(airport_fd, "\n", 1);
-
-        // Read the response from the airport
-        ssize_t n;
-        while ((n = rio_readlineb(&airport_rio, response, MAXLINE)) > 0) {
-          rio_writen(connfd, response, n);
-        }
-
-        close(airport_fd);
-      }
-      else {
-        sprintf(response, "Error: Airport %d does not exist\n", airport_id);
-        rio_writen(connfd, response, strlen(response));
-      }
+      // Responses to requests the client sent together go out together
+      answer_request(buf, (size_t)n, &out);
+      if (controller_rio.rio_cnt <= 0 && wio_flush(&out) < 0)
+        break;
     }
+    wio_flush(&out);
     close(connfd);
   }
   return NULL;
@@ -150,13 +644,91 @@ void sigchld_handler(int sig) {
   return;
 }
 
+/** @brief Hosts every airport in the controller itself (-t inproc), and
+ *         serves clients without forking any airport node. Does not return.
+ */
+static void serve_in_process(void) {
+  char port_str[PORT_STRLEN];
+
+  snprintf(port_str, PORT_STRLEN, "%d", ATC_INFO.portnum);
+  if ((ATC_INFO.listenfd = open_listenfd(port_str)) < 0) {
+    perror("[Controller] open_listenfd");
+    exit(1);
+  }
+
+  for (int idx = 0; idx < ATC_INFO.num_airports; idx++) {
+    node_info_t *node = &ATC_INFO.airport_nodes[idx];
+    node->id = idx;
+    if ((node->data = create_airport(ATC_INFO.gate_counts[idx])) == NULL) {
+      fprintf(stderr, "[Controller] Could not create airport %d\n", idx);
+      exit(1);
+    }
+    if (SCHEDULE_VERSIONS != NULL)
+      node->data->versions = SCHEDULE_VERSIONS[idx];
+  }
+
+  controller_server_loop();
+  exit(0);
+}
+
+/** @brief Sizes the pools of each airport from the number of CPUs online,
+ *         unless -W set their maximum. Both the airports and the controller's
+ *         connection pools follow these sizes, so they are set once, before
+ *         the airports are forked.
+ *
+ *  The airports split the CPUs between them: each pool of an airport starts
+ *  with the airport's share, and may grow to twice that (between 2 and 8),
+ *  so that many airports on one machine do not each run 8 workers per pool.
+ */
+static void size_airport_pools(int num_airports) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int share, max_threads = ATC_INFO.airport_threads;
+
+  if (cpus < 1)
+    cpus = 1;
+  share = (int)((cpus + num_airports - 1) / num_airports);
+  if (max_threads == 0)
+    max_threads = (2 * share < 2) ? 2 : (2 * share > 8) ? 8 : 2 * share;
+  AIRPORT_THREADS = max_threads;
+  AIRPORT_MIN_THREADS = (share < max_threads) ? share : max_threads;
+  NUM_AIRPORTS = num_airports;
+}
+
+/** @brief Sets up what the airports share with the controller, once the
+ *         arguments are parsed and before `initialise_network` forks the
+ *         airports, so that every airport inherits it. With -t inproc there
+ *         is nothing to fork, and the controller is served from here.
+ */
+void prepare_network(void) {
+  size_airport_pools(ATC_INFO.num_airports);
+
+  // The versions the cache is checked against are bumped by the airports
+  if (ATC_INFO.cache_kb > 0 &&
+      ((SCHEDULE_VERSIONS = schedule_versions_create(ATC_INFO.gate_counts,
+                                                     ATC_INFO.num_airports)) == NULL ||
+       (ATC_INFO.cache = create_status_cache((size_t)ATC_INFO.cache_kb * 1024)) == NULL)) {
+    fprintf(stderr, "Could not set up the response cache, running without it.\n");
+    SCHEDULE_VERSIONS = NULL;
+  }
+
+  // The links must be mapped before the airports are forked to be shared
+  if (ATC_INFO.transport == TRANSPORT_SHM &&
+      (SHM_LINKS = shm_links_create(ATC_INFO.num_airports)) == NULL) {
+    fprintf(stderr, "Shared memory is not available, using TCP.\n");
+    ATC_INFO.transport = TRANSPORT_TCP;
+  }
+
+  if (ATC_INFO.transport == TRANSPORT_INPROC)
+    serve_in_process();
+}
+
 /** You should not modify any of the functions below this point, nor should you
  *  call these functions from anywhere else in your code. These functions are
  *  used to handle the initial setup of the Air Traffic Control system.
  */
 
 /** @brief This function spawns child processes for each airport node, and
- *         opens a listening socket for the controller to u.
+ *         opens a listening socket for the controller to use.
  */
 void initialise_network(void) {
   char port_str[PORT_STRLEN];
@@ -176,7 +748,7 @@ void initialise_network(void) {
     node->id = idx;
     node->port = ++port_num;
     snprintf(port_str, PORT_STRLEN, "%d", port_num);
-    if ((lfd = open_listenfd(port_str)) < 0) {
+    if ((lfd = open_airport_listenfd(port_str)) < 0) {
       perror("open_listenfd");
       continue;
     }
@@ -200,9 +772,47 @@ void initialise_network(void) {
 
 /** @brief Prints usage information for the program and then exits. */
 void print_usage(char *program_name) {
-  printf("Usage: %s [-n N] [-p P] -- [gate count list]\n", program_name);
+  printf("Usage: %s [-n N] [-p P] [-P | -b] [-e | -u] [-f] [-t TRANSPORT] [-w W] [-W W] [-C]"
+         " [-g POLICY] [-B MS] [-c KB] -- [gate count list]\n",
+         program_name);
   printf("  -n: Number of airports to create.\n");
   printf("  -p: Port number to use for controller.\n");
+  printf("  -P: Pipeline requests to each airport over a single connection.\n");
+  printf("  -b: Forward text requests to the airports in the binary protocol.\n");
+  printf("  -e: Serve connections from epoll event loops instead of one thread each.\n");
+  printf("  -u: Like -e, but with io_uring (falls back to the default if unsupported).\n");
+  printf("  -f: Write every response at once, rather than batching responses to\n"
+         "      requests that arrive together.\n");
+  printf("  -t: How the controller reaches the airports: over loopback TCP (tcp,\n"
+         "      the default), Unix domain stream sockets (unix) or SOCK_SEQPACKET\n"
+         "      sockets (seqpacket) under $XDG_RUNTIME_DIR (or /tmp), or rings in\n"
+         "      shared memory (shm; text requests only, cannot be combined with\n"
+         "      -P or -b). With inproc, no airport processes are forked: the\n"
+         "      controller hosts every airport itself (cannot be combined with\n"
+         "      -P or -b).\n");
+  printf("  -w: Most worker threads of the controller (default: the number of\n"
+         "      CPUs, and at least 8). It starts with one per CPU, starts more\n"
+         "      while all of them are busy, and lets idle ones exit.\n");
+  printf("  -W: Most worker threads in each pool of each airport (at least 2;\n"
+         "      default: twice the airport's share of the CPUs, between 2 and 8).\n");
+  printf("  -C: Pin each forked airport to its own share of the CPUs.\n");
+  printf("  -g: How SCHEDULE picks a gate: the lowest index that fits (first, the\n"
+         "      default), the first that fits from a different gate for each thread\n"
+         "      (rotate), or the least occupied of the next few gates that fit from\n"
+         "      there (least); rotate and least spread concurrent requests over\n"
+         "      the gates. Or, from an index of the free slots of every gate, the\n"
+         "      earliest start in any gate (earliest), in the gate whose free run\n"
+         "      fits the flight most tightly (best).\n");
+  printf("  -B: Collect the SCHEDULE requests of each airport for MS milliseconds\n"
+         "      (e.g. 1-5, fractions allowed), then place them together, the planes\n"
+         "      with the least fuel to spare first. Each request is answered once\n"
+         "      its window is solved. Implies -g earliest unless -g is given, and\n"
+         "      -P, so that requests waiting for their window do not hold up the\n"
+         "      others (cannot be combined with -t shm or -b). A worker of the\n"
+         "      controller waits for each, so -w bounds how many a window gets.\n");
+  printf("  -c: Cache up to KB kilobytes of PLANE_STATUS and TIME_STATUS responses\n"
+         "      in the controller, until a booking changes them. CACHE_STATUS\n"
+         "      reports the hit rate and memory use.\n");
   printf("  -h: Print this help message and exit.\n");
   exit(0);
 }
@@ -258,8 +868,10 @@ int parse_args(int argc, char *argv[]) {
   int atc_portnum = DEFAULT_PORTNUM;
   int num_airports = 0;
   int max_portnum = MAX_PORTNUM;
+  int policy_set = 0;
+  double window_ms = 0;
 
-  while ((c = getopt(argc, argv, "n:p:h")) != -1) {
+  while ((c = getopt(argc, argv, "n:p:Pbeuft:w:W:Cg:B:c:h")) != -1) {
     switch (c) {
     case 'n':
       sscanf(optarg, "%d", &num_airports);
@@ -268,6 +880,86 @@ int parse_args(int argc, char *argv[]) {
     case 'p':
       sscanf(optarg, "%d", &atc_portnum);
       break;
+    case 'P':
+      ATC_INFO.pipelined = 1;
+      break;
+    case 'b':
+      ATC_INFO.binary = 1;
+      break;
+    case 'e':
+      SERVER_MODE = SERVER_REACTOR;
+      break;
+    case 'u':
+      SERVER_MODE = SERVER_URING;
+      break;
+    case 'f':
+      FLUSH_EACH_RESPONSE = 1;
+      break;
+    case 't':
+      if (strcmp(optarg, "tcp") == 0) {
+        ATC_INFO.transport = TRANSPORT_TCP;
+      } else if (strcmp(optarg, "shm") == 0) {
+        ATC_INFO.transport = TRANSPORT_SHM;
+      } else if (strcmp(optarg, "unix") == 0) {
+        ATC_INFO.transport = TRANSPORT_UNIX;
+      } else if (strcmp(optarg, "seqpacket") == 0) {
+        ATC_INFO.transport = TRANSPORT_SEQPACKET;
+      } else if (strcmp(optarg, "inproc") == 0) {
+        ATC_INFO.transport = TRANSPORT_INPROC;
+      } else {
+        fprintf(stderr, "Unknown transport: %s\n", optarg);
+        ret = -1;
+      }
+      break;
+    case 'w':
+      sscanf(optarg, "%d", &ATC_INFO.num_threads);
+      if (ATC_INFO.num_threads < 1 || ATC_INFO.num_threads > MAX_POOL_THREADS) {
+        fprintf(stderr, "-w must be between 1-%d.\n", MAX_POOL_THREADS);
+        ret = -1;
+      }
+      break;
+    case 'W':
+      sscanf(optarg, "%d", &ATC_INFO.airport_threads);
+      if (ATC_INFO.airport_threads < 2 || ATC_INFO.airport_threads > MAX_POOL_THREADS) {
+        fprintf(stderr, "-W must be between 2-%d.\n", MAX_POOL_THREADS);
+        ret = -1;
+      }
+      break;
+    case 'C':
+      PIN_AIRPORTS = 1;
+      break;
+    case 'g':
+      policy_set = 1;
+      if (strcmp(optarg, "first") == 0) {
+        PROBE_POLICY = PROBE_FIRST;
+      } else if (strcmp(optarg, "rotate") == 0) {
+        PROBE_POLICY = PROBE_ROTATE;
+      } else if (strcmp(optarg, "least") == 0) {
+        PROBE_POLICY = PROBE_LEAST_LOADED;
+      } else if (strcmp(optarg, "earliest") == 0) {
+        PROBE_POLICY = PROBE_EARLIEST;
+      } else if (strcmp(optarg, "best") == 0) {
+        PROBE_POLICY = PROBE_BEST_FIT;
+      } else {
+        fprintf(stderr, "Unknown gate policy: %s\n", optarg);
+        ret = -1;
+      }
+      break;
+    case 'B':
+      sscanf(optarg, "%lf", &window_ms);
+      if (window_ms < 0.001 || window_ms > 1000) {
+        fprintf(stderr, "-B must be between 0.001-1000 ms.\n");
+        ret = -1;
+      }
+      SCHEDULE_WINDOW_US = (int)(window_ms * 1000);
+      break;
+    case 'c':
+      sscanf(optarg, "%d", &ATC_INFO.cache_kb);
+      if (ATC_INFO.cache_kb < 1 || ATC_INFO.cache_kb > 1024 * 1024) {
+        fprintf(stderr, "-c must be between 1-%d KB.\n", 1024 * 1024);
+        ret = -1;
+      }
+      break;
     case 'h':
       print_usage(argv[0]);
       break;
@@ -288,6 +980,38 @@ int parse_args(int argc, char *argv[]) {
     ret = -1;
   }
 
+  if (ATC_INFO.pipelined && ATC_INFO.binary) {
+    fprintf(stderr, "-P and -b cannot be combined.\n");
+    ret = -1;
+  }
+  if ((ATC_INFO.transport == TRANSPORT_SHM || ATC_INFO.transport == TRANSPORT_INPROC) &&
+      (ATC_INFO.pipelined || ATC_INFO.binary)) {
+    fprintf(stderr, "-t %s cannot be combined with -P or -b.\n",
+            ATC_INFO.transport == TRANSPORT_SHM ? "shm" : "inproc");
+    ret = -1;
+  }
+
+  // Windows are placed with the free-interval search unless told otherwise.
+  // The airports answer the requests of a window once it is solved, so they
+  // are pipelined, and do not hold a pooled connection each until then.
+  if (SCHEDULE_WINDOW_US > 0) {
+    if (!policy_set)
+      PROBE_POLICY = PROBE_EARLIEST;
+    if (ATC_INFO.transport == TRANSPORT_SHM || ATC_INFO.binary) {
+      fprintf(stderr, "-B cannot be combined with -t shm or -b.\n");
+      ret = -1;
+    } else if (ATC_INFO.transport != TRANSPORT_INPROC) {
+      ATC_INFO.pipelined = 1;
+    }
+  }
+
+  // Detect io_uring once, before the airports are forked, so that every node
+  // agrees on the mode
+  if (SERVER_MODE == SERVER_URING && !uring_supported()) {
+    fprintf(stderr, "io_uring is not supported here, using the threaded server.\n");
+    SERVER_MODE = SERVER_THREADED;
+  }
+
   if (ret >= 0) {
     if ((gate_counts = parse_gate_counts(argv[optind], num_airports)) == NULL)
       return -1;
@@ -303,6 +1027,7 @@ int parse_args(int argc, char *argv[]) {
 int main(int argc, char *argv[]) {
   if (parse_args(argc, argv) < 0)
     return 1;
+  prepare_network();
   initialise_network();
   controller_server_loop();
   return 0;
@@ -0,0 +1,87 @@
+#include "free_index.h"
+
+#include <stdlib.h>
+
+#define NODE(index, n) (&(index)->runs[(size_t)(n) * FREE_INDEX_SLOTS])
+
+/** Fills in the words of a leaf from the occupancy word of its gate. */
+static void fill_leaf(uint64_t *leaf, occupancy_t occ) {
+  // Slots past the end of the day end every run
+  occupancy_t taken = occ | (~(occupancy_t)0 << FREE_INDEX_SLOTS);
+  for (int slot = 0; slot < FREE_INDEX_SLOTS; slot++) {
+    int run = __builtin_ctzll(taken >> slot);
+    leaf[slot] = run ? (uint64_t)1 << run : 0;
+  }
+}
+
+/** Recomputes node `n` from its children. Returns 0 if it did not change. */
+static int merge_node(free_index_t *index, int n) {
+  uint64_t *node = NODE(index, n), *left = NODE(index, 2 * n), *right = NODE(index, 2 * n + 1);
+  uint64_t changed = 0;
+  for (int slot = 0; slot < FREE_INDEX_SLOTS; slot++) {
+    uint64_t runs = left[slot] | right[slot];
+    changed |= runs ^ node[slot];
+    node[slot] = runs;
+  }
+  return changed != 0;
+}
+
+free_index_t *create_free_index(const occupancy_t *occ, int num_gates) {
+  free_index_t *index = calloc(1, sizeof(free_index_t));
+  if (index == NULL)
+    return NULL;
+  index->num_gates = num_gates;
+  index->num_leaves = 1;
+  while (index->num_leaves < num_gates)
+    index->num_leaves <<= 1;
+  // Leaves past the last gate stay empty
+  index->runs = calloc((size_t)index->num_leaves * 2 * FREE_INDEX_SLOTS, sizeof(uint64_t));
+  if (index->runs == NULL) {
+    free(index);
+    return NULL;
+  }
+  pthread_mutex_init(&index->lock, NULL);
+  for (int gate = 0; gate < num_gates; gate++)
+    fill_leaf(NODE(index, index->num_leaves + gate), occ[gate]);
+  for (int n = index->num_leaves - 1; n >= 1; n--)
+    merge_node(index, n);
+  return index;
+}
+
+void destroy_free_index(free_index_t *index) {
+  if (index == NULL)
+    return;
+  pthread_mutex_destroy(&index->lock);
+  free(index->runs);
+  free(index);
+}
+
+void free_index_update(free_index_t *index, int gate, occupancy_t occ) {
+  int n = index->num_leaves + gate;
+  fill_leaf(NODE(index, n), occ);
+  // Stop as soon as a node comes out the same, as then so do all above it
+  for (n >>= 1; n >= 1 && merge_node(index, n); n >>= 1)
+    ;
+}
+
+int free_index_find(free_index_t *index, int first, int last, int len, int best_fit, int *gate) {
+  uint64_t *root = NODE(index, 1), want = 0;
+  int slot, n = 1;
+  if (first < 0 || first > last || len < 1 || len > FREE_INDEX_SLOTS)
+    return -1;
+  if (last >= FREE_INDEX_SLOTS)
+    last = FREE_INDEX_SLOTS - 1;
+  // Runs of `len` slots or more
+  for (slot = first; slot <= last; slot++) {
+    if ((want = root[slot] & (~(uint64_t)0 << len)) != 0)
+      break;
+  }
+  if (slot > last)
+    return -1;
+  if (best_fit)
+    want &= -want; // Only the shortest of them
+  while (n < index->num_leaves)
+    n = (NODE(index, 2 * n)[slot] & want) ? 2 * n : 2 * n + 1;
+  *gate = n - index->num_leaves;
+  return slot;
+}
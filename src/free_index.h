@@ -0,0 +1,63 @@
+#ifndef FREE_INDEX_HEADER
+#define FREE_INDEX_HEADER
+
+#include "occupancy.h"
+#include <pthread.h>
+
+/* Time slots in a day (`NUM_TIME_SLOTS`) */
+#define FREE_INDEX_SLOTS 48
+
+/** Index of the free runs of every gate of an airport, to find the earliest
+ *  window across all gates rather than the first gate with any window.
+ *
+ *  It is a segment tree over the gates. For each time slot, a leaf holds the
+ *  length of the free run starting there in its gate as a single set bit (bit
+ *  `n` for a run of `n` slots), and each inner node the OR of its children:
+ *  the set of run lengths that start in that slot somewhere below it. Whether
+ *  any gate has `len` free slots from slot `i` is then one test of the root's
+ *  word for slot `i`, and the lowest such gate, or the one with the shortest
+ *  such run, is found by walking down one path of the tree. A change to a gate
+ *  only updates the nodes above its leaf.
+ *
+ *  The index follows the occupancy words, and is not updated by itself:
+ *  whoever changes a word calls `free_index_update` afterwards. Queries and
+ *  updates are made under `lock`.
+ */
+typedef struct free_index_t free_index_t;
+
+struct free_index_t {
+  int num_gates;
+  int num_leaves; // Power of two, at least `num_gates`
+  pthread_mutex_t lock;
+  /* Node `n` of the tree (the root is 1, and the leaf of gate `g` is
+   * `num_leaves + g`) at `runs[n * FREE_INDEX_SLOTS + slot]` */
+  uint64_t *runs;
+};
+
+/** @brief Allocates an index of the `num_gates` gates whose occupancy words
+ *         are `occ[0]..occ[num_gates - 1]`.
+ *
+ *  @returns A pointer to the index, or `NULL` if allocation failed.
+ */
+free_index_t *create_free_index(const occupancy_t *occ, int num_gates);
+
+/** @brief Frees the index. */
+void destroy_free_index(free_index_t *index);
+
+/** @brief Brings the leaf of `gate` up to date with its occupancy word `occ`,
+ *         and the nodes above it. The caller holds `index->lock`.
+ */
+void free_index_update(free_index_t *index, int gate, occupancy_t occ);
+
+/** @brief Finds the earliest slot in `[first]..[last]` from which some gate
+ *         has `len` free slots, and stores that gate through `gate`: the
+ *         lowest-index one, or with `best_fit`, the one whose free run from
+ *         that slot is the shortest (ties to the lowest index), so that longer
+ *         runs are left whole for longer flights. The caller holds
+ *         `index->lock`.
+ *
+ *  @returns The slot, or -1 if no gate has such a window.
+ */
+int free_index_find(free_index_t *index, int first, int last, int len, int best_fit, int *gate);
+
+#endif
@@ -1,5 +1,10 @@
 #include "network_utils.h"
 
+#include <netinet/tcp.h>
+#include <stdarg.h>
+#include <sys/un.h>
+#include <time.h>
+
 void gai_error(int code, char *msg) { /* getaddrinfo-style error */
   fprintf(stderr, "%s: %s\n", msg, gai_strerror(code));
   exit(0);
@@ -134,6 +139,106 @@ ssize_t rio_writen(int fd, char *usrbuf, size_t n) {
 }
 
 /*
+ * resolve_inet_addr - Resolve <hostname, port> once, for connecting to it
+ *     repeatedly with open_addr_clientfd. Returns -1 on failure.
+ */
+int resolve_inet_addr(char *hostname, char *port, sock_addr_t *sa) {
+  struct addrinfo hints, *listp;
+  int rc;
+
+  memset(&hints, 0, sizeof(struct addrinfo));
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_NUMERICSERV | AI_ADDRCONFIG;
+  if ((rc = getaddrinfo(hostname, port, &hints, &listp)) != 0) {
+    fprintf(stderr, "getaddrinfo error: %s\n", gai_strerror(rc));
+    return -1;
+  }
+  memcpy(&sa->addr, listp->ai_addr, listp->ai_addrlen);
+  sa->addrlen = listp->ai_addrlen;
+  sa->socktype = SOCK_STREAM;
+  freeaddrinfo(listp);
+  return 0;
+}
+
+/*
+ * make_unix_addr - The address of the Unix domain socket at path, of type
+ *     SOCK_STREAM or SOCK_SEQPACKET. Returns -1 if path is too long.
+ */
+int make_unix_addr(const char *path, int socktype, sock_addr_t *sa) {
+  struct sockaddr_un *un = (struct sockaddr_un *)&sa->addr;
+
+  if (strlen(path) >= sizeof(un->sun_path)) {
+    fprintf(stderr, "Socket path too long: %s\n", path);
+    return -1;
+  }
+  memset(sa, 0, sizeof(sock_addr_t));
+  un->sun_family = AF_UNIX;
+  strcpy(un->sun_path, path);
+  sa->addrlen = sizeof(struct sockaddr_un);
+  sa->socktype = socktype;
+  return 0;
+}
+
+/*
+ * open_addr_clientfd - Open a connection to a resolved address. Returns -1
+ *     and sets errno on error.
+ */
+int open_addr_clientfd(const sock_addr_t *sa) {
+  int fd, optval = 1;
+
+  if ((fd = socket(sa->addr.ss_family, sa->socktype, 0)) < 0)
+    return -1;
+  if (connect(fd, (const SA *)&sa->addr, sa->addrlen) < 0) {
+    close(fd);
+    return -1;
+  }
+  // Requests and responses are small, so do not let Nagle delay them
+  if (sa->addr.ss_family != AF_UNIX)
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
+  return fd;
+}
+
+/*
+ * open_unix_listenfd - Open a listening Unix domain socket at path,
+ *     replacing a stale socket file left there. Returns -1 and sets errno
+ *     on error.
+ */
+int open_unix_listenfd(const char *path, int socktype) {
+  sock_addr_t sa;
+  int listenfd;
+
+  if (make_unix_addr(path, socktype, &sa) < 0) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  if ((listenfd = socket(AF_UNIX, socktype, 0)) < 0)
+    return -1;
+  unlink(path);
+  if (bind(listenfd, (SA *)&sa.addr, sa.addrlen) < 0 || listen(listenfd, LISTENQ) < 0) {
+    close(listenfd);
+    return -1;
+  }
+  return listenfd;
+}
+
+/*
+ * socket_message_max - SEQPACKET_MAX for a SOCK_SEQPACKET socket, else 0
+ */
+size_t socket_message_max(int fd) {
+  int type = 0;
+  socklen_t len = sizeof(type);
+  if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) == 0 && type == SOCK_SEQPACKET)
+    return SEQPACKET_MAX;
+  return 0;
+}
+
+/*
+ * rio_input - read() from the descriptor, or the source function if set
+ *
+ * rio_fill - Refills the internal buffer via a call to read() if it is
+ *    empty. Returns the number of unread bytes in it, 0 on EOF, or -1 on
+ *    error.
+ *
  * rio_read - This is a wrapper for the Unix read() function that
  *    transfers min(n, rio_cnt) bytes from an internal buffer to a user
  *    buffer, where n is the number of bytes requested by the user and
@@ -141,12 +246,16 @@ ssize_t rio_writen(int fd, char *usrbuf, size_t n) {
  *    entry, rio_read() refills the internal buffer via a call to
  *    read() if the internal buffer is empty.
  */
-static ssize_t rio_read(rio_t *rp, char *usrbuf, size_t n) {
-  ssize_t cnt;
+static ssize_t rio_input(rio_t *rp, void *buf, size_t n) {
+  if (rp->rio_source != NULL)
+    return rp->rio_source(rp->rio_ctx, buf, n);
+  return read(rp->rio_fd, buf, n);
+}
 
+static ssize_t rio_fill(rio_t *rp) {
   while (rp->rio_cnt <= 0) { /* Refill if buf is empty */
-    rp->rio_cnt = read(rp->rio_fd, rp->rio_buf,
-                       sizeof(rp->rio_buf));
+    rp->rio_cnt = rio_input(rp, rp->rio_buf,
+                            sizeof(rp->rio_buf));
     if (rp->rio_cnt < 0) {
       if (errno != EINTR) /* Interrupted by sig handler return */
         return -1;
@@ -155,6 +264,14 @@ static ssize_t rio_read(rio_t *rp, char *usrbuf, size_t n) {
     else
       rp->rio_bufptr = rp->rio_buf; /* Reset buffer ptr */
   }
+  return rp->rio_cnt;
+}
+
+static ssize_t rio_read(rio_t *rp, char *usrbuf, size_t n) {
+  ssize_t cnt;
+
+  if ((cnt = rio_fill(rp)) <= 0)
+    return cnt;
 
   /* Copy min(n, rp->rio_cnt) bytes from internal buf to user buf */
   cnt = (ssize_t)n;
@@ -171,10 +288,21 @@ static ssize_t rio_read(rio_t *rp, char *usrbuf, size_t n) {
  */
 void rio_readinitb(rio_t *rp, int fd) {
   rp->rio_fd = fd;
+  rp->rio_source = NULL;
+  rp->rio_ctx = NULL;
   rp->rio_cnt = 0;
   rp->rio_bufptr = rp->rio_buf;
 }
 
+/*
+ * rio_readinit_source - Associate a source function with a read buffer
+ */
+void rio_readinit_source(rio_t *rp, rio_source_fn source, void *ctx) {
+  rio_readinitb(rp, -1);
+  rp->rio_source = source;
+  rp->rio_ctx = ctx;
+}
+
 /*
  * rio_readnb - Robustly read n bytes (buffered)
  */
@@ -196,26 +324,229 @@ ssize_t rio_readnb(rio_t *rp, void *usrbuf, size_t n) {
 
 /*
  * rio_readlineb - Robustly read a text line (buffered)
+ *    Copies the line (up to maxlen - 1 bytes) a whole buffered chunk at a
+ *    time, finding its end with memchr.
  */
 ssize_t rio_readlineb(rio_t *rp, void *usrbuf, size_t maxlen) {
-  ssize_t n, rc;
-  char c, *bufp = usrbuf;
-
-  for (n = 1; n < maxlen; n++) {
-    if ((rc = rio_read(rp, &c, 1)) == 1) {
-      *bufp++ = c;
-      if (c == '\n') {
-        n++;
-        break;
-      }
-    } else if (rc == 0) {
-      if (n == 1)
-        return 0; /* EOF, no data read */
-      else
-        break; /* EOF, some data was read */
-    } else
+  char *bufp = usrbuf, *nl = NULL;
+  size_t n = 0, cnt;
+  ssize_t rc;
+
+  while (nl == NULL && n + 1 < maxlen) {
+    if ((rc = rio_fill(rp)) < 0)
       return -1; /* Error */
+    else if (rc == 0)
+      break; /* EOF */
+
+    cnt = (size_t)rp->rio_cnt;
+    if (cnt > maxlen - 1 - n)
+      cnt = maxlen - 1 - n;
+    if ((nl = memchr(rp->rio_bufptr, '\n', cnt)) != NULL)
+      cnt = (size_t)(nl - rp->rio_bufptr) + 1;
+    memcpy(bufp + n, rp->rio_bufptr, cnt);
+    rp->rio_bufptr += cnt;
+    rp->rio_cnt -= (ssize_t)cnt;
+    n += cnt;
+  }
+  bufp[n] = 0;
+  return (ssize_t)n;
+}
+
+/*
+ * rio_readlinep - Robustly read a text line (buffered, zero-copy)
+ *    Like rio_readlineb, but points *linep at the line inside the internal
+ *    buffer instead of copying it out. A line that straddles the end of the
+ *    buffer is first moved to its start.
+ */
+ssize_t rio_readlinep(rio_t *rp, char **linep, size_t maxlen) {
+  size_t len, avail, scanned = 0;
+  ssize_t rc;
+  char *nl;
+
+  if (maxlen > sizeof(rp->rio_buf) + 1)
+    maxlen = sizeof(rp->rio_buf) + 1;
+  if (maxlen <= 1)
+    return 0;
+
+  while (1) {
+    avail = (rp->rio_cnt > 0) ? (size_t)rp->rio_cnt : 0;
+    len = (avail < maxlen - 1) ? avail : maxlen - 1;
+    if ((nl = memchr(rp->rio_bufptr + scanned, '\n', len - scanned)) != NULL) {
+      len = (size_t)(nl - rp->rio_bufptr) + 1;
+      break;
+    }
+    if (len == maxlen - 1)
+      break; /* No room for more */
+    scanned = len;
+
+    // Read the rest of the line after the part already buffered
+    if (avail > 0 && rp->rio_bufptr != rp->rio_buf)
+      memmove(rp->rio_buf, rp->rio_bufptr, avail);
+    rp->rio_bufptr = rp->rio_buf;
+    rc = rio_input(rp, rp->rio_buf + avail, sizeof(rp->rio_buf) - avail);
+    if (rc < 0) {
+      if (errno != EINTR)
+        return -1; /* Error */
+    } else if (rc == 0) {
+      break; /* EOF, possibly with some data read */
+    } else {
+      rp->rio_cnt = (ssize_t)avail + rc;
+    }
+  }
+  *linep = rp->rio_bufptr;
+  rp->rio_bufptr += len;
+  rp->rio_cnt -= (ssize_t)len;
+  return (ssize_t)len;
+}
+
+/*
+ * monotonic_us - Microseconds on the monotonic clock
+ */
+uint64_t monotonic_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/*
+ * writev_all - Robustly write every byte of iov[0..cnt) (unbuffered)
+ */
+static ssize_t writev_all(int fd, struct iovec *iov, int cnt) {
+  ssize_t nwritten;
+
+  while (cnt > 0) {
+    if ((nwritten = writev(fd, iov, cnt)) <= 0) {
+      if (errno == EINTR) /* Interrupted by sig handler return */
+        continue;         /* and call writev() again */
+      return -1;          /* errno set by writev() */
+    }
+    /* Skip what was written, possibly stopping inside an iovec */
+    while (cnt > 0 && (size_t)nwritten >= iov->iov_len) {
+      nwritten -= (ssize_t)iov->iov_len;
+      iov++;
+      cnt--;
+    }
+    if (cnt > 0) {
+      iov->iov_base = (char *)iov->iov_base + nwritten;
+      iov->iov_len -= (size_t)nwritten;
+    }
+  }
+  return 0;
+}
+
+/*
+ * wio_init - Associate a descriptor with an output buffer
+ */
+void wio_init(wio_t *wp, int fd, int immediate) {
+  wp->wio_fd = fd;
+  wp->wio_sink = NULL;
+  wp->wio_ctx = NULL;
+  wp->wio_immediate = immediate;
+  wp->wio_msg_max = 0;
+  wp->wio_cnt = 0;
+  wp->wio_since = 0;
+}
+
+/*
+ * wio_init_sink - Associate a sink function with an output buffer
+ */
+void wio_init_sink(wio_t *wp, wio_sink_fn sink, void *ctx, int immediate) {
+  wio_init(wp, -1, immediate);
+  wp->wio_sink = sink;
+  wp->wio_ctx = ctx;
+}
+
+/*
+ * wio_output - Hand iov[0..cnt) to the descriptor or the sink
+ */
+static ssize_t wio_output(wio_t *wp, struct iovec *iov, int cnt) {
+  if (wp->wio_sink == NULL && wp->wio_msg_max == 0)
+    return writev_all(wp->wio_fd, iov, cnt);
+  if (wp->wio_sink == NULL) {
+    // One write per message of at most wio_msg_max bytes
+    for (int i = 0; i < cnt; i++) {
+      for (size_t done = 0, n; done < iov[i].iov_len; done += n) {
+        n = iov[i].iov_len - done;
+        if (n > wp->wio_msg_max)
+          n = wp->wio_msg_max;
+        if (rio_writen(wp->wio_fd, (char *)iov[i].iov_base + done, n) < 0)
+          return -1;
+      }
+    }
+    return 0;
+  }
+  for (int i = 0; i < cnt; i++) {
+    if (iov[i].iov_len > 0 && wp->wio_sink(wp->wio_ctx, iov[i].iov_base, iov[i].iov_len) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+/*
+ * wio_flush - Write out everything buffered
+ */
+ssize_t wio_flush(wio_t *wp) {
+  struct iovec iov = {wp->wio_buf, wp->wio_cnt};
+  ssize_t rc = (wp->wio_cnt > 0) ? wio_output(wp, &iov, 1) : 0;
+  wp->wio_cnt = 0;
+  return rc;
+}
+
+/*
+ * wio_reserve - Return a cursor with room for n (<= WIO_BUFSIZE) bytes at
+ *    the end of the buffered output, flushing it first if needed
+ */
+char *wio_reserve(wio_t *wp, size_t n) {
+  if (wp->wio_cnt + n > sizeof(wp->wio_buf))
+    wio_flush(wp);
+  return wp->wio_buf + wp->wio_cnt;
+}
+
+/*
+ * wio_commit - Add the n bytes written at the wio_reserve cursor
+ */
+ssize_t wio_commit(wio_t *wp, size_t n) {
+  int due = wp->wio_immediate;
+  if (!due) {
+    uint64_t now = monotonic_us();
+    if (wp->wio_cnt == 0)
+      wp->wio_since = now;
+    else
+      due = (now - wp->wio_since >= WIO_MAX_DELAY_US);
+  }
+  wp->wio_cnt += n;
+  if (due || wp->wio_cnt == sizeof(wp->wio_buf))
+    return wio_flush(wp) < 0 ? -1 : (ssize_t)n;
+  return (ssize_t)n;
+}
+
+/*
+ * wio_printf - Formatted write (buffered), truncated to MAXLINE - 1 bytes
+ */
+ssize_t wio_printf(wio_t *wp, const char *fmt, ...) {
+  char *cursor = wio_reserve(wp, MAXLINE);
+  va_list ap;
+  int n;
+
+  va_start(ap, fmt);
+  n = vsnprintf(cursor, MAXLINE, fmt, ap);
+  va_end(ap);
+  if (n < 0)
+    return -1;
+  return wio_commit(wp, ((size_t)n < MAXLINE) ? (size_t)n : MAXLINE - 1);
+}
+
+/*
+ * wio_writen - Robustly write n bytes (buffered)
+ *    Data that does not fit in the buffer goes out in the same writev() as
+ *    the buffered bytes, without being copied.
+ */
+ssize_t wio_writen(wio_t *wp, const void *usrbuf, size_t n) {
+  if (wp->wio_cnt + n > sizeof(wp->wio_buf)) {
+    struct iovec iov[2] = {{wp->wio_buf, wp->wio_cnt}, {(void *)usrbuf, n}};
+    wp->wio_cnt = 0;
+    return wio_output(wp, iov, 2) < 0 ? -1 : (ssize_t)n;
   }
-  *bufp = 0;
-  return n - 1;
+  memcpy(wp->wio_buf + wp->wio_cnt, usrbuf, n);
+  return wio_commit(wp, n);
 }
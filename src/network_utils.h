@@ -13,6 +13,8 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <stdint.h>
 #include <unistd.h>
 
 #define LISTENQ 1024 /* Second argument to listen() */
@@ -27,17 +29,79 @@ int open_clientfd(char *hostname, char *port);
 int open_listenfd(char *port);
 void gai_error(int code, char *msg);
 
+/* A resolved address to connect to, over TCP or a Unix domain socket. */
+typedef struct {
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+    int socktype; /* SOCK_STREAM, or SOCK_SEQPACKET for Unix domain sockets */
+} sock_addr_t;
+
+int resolve_inet_addr(char *hostname, char *port, sock_addr_t *sa);
+int make_unix_addr(const char *path, int socktype, sock_addr_t *sa);
+int open_addr_clientfd(const sock_addr_t *sa);
+int open_unix_listenfd(const char *path, int socktype);
+
+/* Buffered input, from a descriptor or, like wio_t's sink, from a source
+ * function that behaves like read(), e.g. a shared-memory ring. */
 #define RIO_BUFSIZE 8192
+typedef ssize_t (*rio_source_fn)(void *ctx, void *buf, size_t n);
 typedef struct {
     int rio_fd;                /* Descriptor for this internal buf */
+    rio_source_fn rio_source;  /* Or where to read from, if set */
+    void *rio_ctx;             /* Argument of rio_source */
     ssize_t rio_cnt;               /* Unread bytes in internal buf */
     char *rio_bufptr;          /* Next unread byte in internal buf */
     char rio_buf[RIO_BUFSIZE]; /* Internal buffer */
 } rio_t;
 
 void rio_readinitb(rio_t *rp, int fd);
+void rio_readinit_source(rio_t *rp, rio_source_fn source, void *ctx);
 ssize_t rio_readnb(rio_t *rp, void *usrbuf, size_t n);
 ssize_t rio_readlineb(rio_t *rp, void *usrbuf, size_t maxlen);
+/* Zero-copy rio_readlineb: the line is not NUL-terminated, and stays valid
+ * until the next read from rp. */
+ssize_t rio_readlinep(rio_t *rp, char **linep, size_t maxlen);
 ssize_t rio_writen(int fd, char *usrbuf, size_t n);
 
+/* SOCK_SEQPACKET sockets deliver each write as one message, and a read that
+ * is too small for the next message truncates it. Larger writes are split
+ * so that a message always fits in what rio_readlinep leaves of a reader's
+ * buffer. socket_message_max returns this limit for such a socket, or 0 (no
+ * limit) for a stream. */
+#define SEQPACKET_MAX (RIO_BUFSIZE - MAXLINE)
+size_t socket_message_max(int fd);
+
+/* Buffered output: responses are coalesced into wio_buf and written with one
+ * system call once the caller flushes (typically when it has no more input
+ * buffered), the buffer fills up, or the oldest buffered byte has waited
+ * WIO_MAX_DELAY_US. With wio_immediate, every write is flushed at once.
+ *
+ * Output can also be generated in place: wio_reserve returns a cursor with
+ * room for n bytes inside wio_buf (flushing first if needed), and
+ * wio_commit adds the bytes written there. Instead of a descriptor, the
+ * output can go to a sink function, e.g. the reactor's reactor_send. */
+#define WIO_BUFSIZE 16384
+#define WIO_MAX_DELAY_US 1000
+typedef ssize_t (*wio_sink_fn)(void *ctx, const void *buf, size_t n);
+typedef struct {
+    int wio_fd;                /* Descriptor for this internal buf */
+    wio_sink_fn wio_sink;      /* Or where to flush it to, if set */
+    void *wio_ctx;             /* Argument of wio_sink */
+    int wio_immediate;         /* Flush after every write */
+    size_t wio_msg_max;        /* Largest single write, 0 for no limit */
+    size_t wio_cnt;            /* Buffered bytes not yet written */
+    uint64_t wio_since;        /* When the oldest buffered byte was added */
+    char wio_buf[WIO_BUFSIZE]; /* Internal buffer */
+} wio_t;
+
+void wio_init(wio_t *wp, int fd, int immediate);
+void wio_init_sink(wio_t *wp, wio_sink_fn sink, void *ctx, int immediate);
+ssize_t wio_writen(wio_t *wp, const void *usrbuf, size_t n);
+ssize_t wio_printf(wio_t *wp, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+char *wio_reserve(wio_t *wp, size_t n);
+ssize_t wio_commit(wio_t *wp, size_t n);
+ssize_t wio_flush(wio_t *wp);
+uint64_t monotonic_us(void);
+
 #endif
@@ -0,0 +1,143 @@
+#include "occupancy.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OCCUPANCY_X86 1
+#endif
+
+/** The multi-gate search evaluates the same candidate window against several
+ *  gates' occupancy words at once. The window test itself is the same as in
+ *  `occupancy_first_window`: invert the word, AND it with shifted copies of
+ *  itself until every surviving bit starts a free run of `len` slots, then
+ *  mask with the allowed starts. Since the shift amounts are the same for every
+ *  gate, each step maps onto a single vector instruction.
+ */
+
+int occupancy_first_gate_scalar(const occupancy_t *occ, int num_gates, int first,
+                                int last, int len) {
+  occupancy_t allowed;
+  int gate_idx;
+  if (first < 0 || first > last)
+    return -1;
+  allowed = occupancy_range(first, last);
+  for (gate_idx = 0; gate_idx < num_gates; gate_idx++) {
+    if (occupancy_window_starts(occ[gate_idx], len) & allowed)
+      return gate_idx;
+  }
+  return -1;
+}
+
+#ifdef OCCUPANCY_X86
+
+__attribute__((target("sse4.1"))) int
+occupancy_first_gate_sse4(const occupancy_t *occ, int num_gates, int first, int last,
+                          int len) {
+  __m128i ones = _mm_set1_epi64x(-1), zero = _mm_setzero_si128(), allowed, starts, hit;
+  int gate_idx = 0, have, step, mask;
+  if (first < 0 || first > last)
+    return -1;
+  allowed = _mm_set1_epi64x((long long)occupancy_range(first, last));
+
+  for (; gate_idx + 2 <= num_gates; gate_idx += 2) {
+    starts = _mm_andnot_si128(_mm_loadu_si128((const __m128i *)&occ[gate_idx]), ones);
+    for (have = 1; have < len; have += step) {
+      step = (len - have < have) ? len - have : have;
+      starts = _mm_and_si128(starts, _mm_srl_epi64(starts, _mm_cvtsi32_si128(step)));
+    }
+    starts = _mm_and_si128(starts, allowed);
+    if (!_mm_testz_si128(starts, starts)) {
+      hit = _mm_cmpeq_epi64(starts, zero);
+      mask = ~_mm_movemask_pd(_mm_castsi128_pd(hit)) & 0x3;
+      return gate_idx + __builtin_ctz((unsigned)mask);
+    }
+  }
+
+  // Scalar tail for an odd number of gates
+  if (gate_idx < num_gates &&
+      occupancy_first_gate_scalar(&occ[gate_idx], num_gates - gate_idx, first, last, len) == 0)
+    return gate_idx;
+  return -1;
+}
+
+__attribute__((target("avx2"))) int
+occupancy_first_gate_avx2(const occupancy_t *occ, int num_gates, int first, int last,
+                          int len) {
+  __m256i ones = _mm256_set1_epi64x(-1), zero = _mm256_setzero_si256(), allowed, starts, hit;
+  int gate_idx = 0, have, step, mask, tail;
+  if (first < 0 || first > last)
+    return -1;
+  allowed = _mm256_set1_epi64x((long long)occupancy_range(first, last));
+
+  for (; gate_idx + 4 <= num_gates; gate_idx += 4) {
+    starts = _mm256_andnot_si256(_mm256_loadu_si256((const __m256i *)&occ[gate_idx]), ones);
+    for (have = 1; have < len; have += step) {
+      step = (len - have < have) ? len - have : have;
+      starts = _mm256_and_si256(starts, _mm256_srl_epi64(starts, _mm_cvtsi32_si128(step)));
+    }
+    starts = _mm256_and_si256(starts, allowed);
+    if (!_mm256_testz_si256(starts, starts)) {
+      hit = _mm256_cmpeq_epi64(starts, zero);
+      mask = ~_mm256_movemask_pd(_mm256_castsi256_pd(hit)) & 0xf;
+      return gate_idx + __builtin_ctz((unsigned)mask);
+    }
+  }
+
+  // Scalar tail for the last (num_gates % 4) gates
+  if (gate_idx < num_gates) {
+    tail = occupancy_first_gate_scalar(&occ[gate_idx], num_gates - gate_idx, first, last, len);
+    if (tail >= 0)
+      return gate_idx + tail;
+  }
+  return -1;
+}
+
+#endif
+
+/* Implementation picked once at startup by `select_first_gate_impl`. */
+static occupancy_first_gate_fn first_gate_impl = occupancy_first_gate_scalar;
+static const char *first_gate_impl_name = "scalar";
+
+__attribute__((constructor)) static void select_first_gate_impl(void) {
+#ifdef OCCUPANCY_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    first_gate_impl = occupancy_first_gate_avx2;
+    first_gate_impl_name = "avx2";
+  } else if (__builtin_cpu_supports("sse4.1")) {
+    first_gate_impl = occupancy_first_gate_sse4;
+    first_gate_impl_name = "sse4";
+  }
+#endif
+}
+
+int occupancy_first_gate(const occupancy_t *occ, int num_gates, int first, int last,
+                         int len) {
+  return first_gate_impl(occ, num_gates, first, last, len);
+}
+
+const char *occupancy_first_gate_impl(void) { return first_gate_impl_name; }
+
+int occupancy_least_loaded_gate(const occupancy_t *occ, int num_gates, int from, int first,
+                                int last, int len, int candidates) {
+  occupancy_t allowed, word;
+  int i, gate_idx, load, best = -1;
+  int best_load = 65; // More slots than a word holds
+  if (first < 0 || first > last || num_gates <= 0)
+    return -1;
+  allowed = occupancy_range(first, last);
+  for (i = 0; i < num_gates && candidates > 0; i++) {
+    gate_idx = (from + i) % num_gates;
+    word = __atomic_load_n(&occ[gate_idx], __ATOMIC_RELAXED);
+    if (!(occupancy_window_starts(word, len) & allowed))
+      continue;
+    candidates--;
+    if ((load = __builtin_popcountll(word)) < best_load) {
+      best = gate_idx;
+      best_load = load;
+      // No gate can have fewer occupied slots than an empty one
+      if (load == 0)
+        break;
+    }
+  }
+  return best;
+}
@@ -0,0 +1,142 @@
+#ifndef OCCUPANCY_HEADER
+#define OCCUPANCY_HEADER
+
+#include <stdint.h>
+
+/** Occupancy bitmaps describe a gate schedule with one bit per time slot: bit
+ *  `i` is set when time slot `i` is occupied. A day only has `NUM_TIME_SLOTS`
+ *  (48) slots, so a single 64-bit word covers a whole gate, and searching for a
+ *  free window becomes a handful of shift/AND/ctz operations.
+ */
+typedef uint64_t occupancy_t;
+
+/** @brief Returns a mask with the bits `[start]..[end]` (inclusive) set.
+ *
+ *  @note  Requires `0 <= start <= end < 64`.
+ */
+static inline occupancy_t occupancy_range(int start, int end) {
+  return (~(occupancy_t)0 >> (63 - (end - start))) << start;
+}
+
+/** @brief Returns a mask in which bit `i` is set iff the `len` slots
+ *         `[i]..[i+len-1]` are all free in `occ`.
+ *
+ *  The free runs are combined by doubling the window length on each step, so
+ *  this takes O(log len) shifts rather than one per slot.
+ *
+ *  @warning Bits past the end of the day are treated as free, so callers must
+ *           mask the result with the range of starts they are interested in.
+ */
+static inline occupancy_t occupancy_window_starts(occupancy_t occ, int len) {
+  occupancy_t starts = ~occ;
+  int have = 1, step;
+  while (have < len) {
+    step = (len - have < have) ? len - have : have;
+    starts &= starts >> step;
+    have += step;
+  }
+  return starts;
+}
+
+/** @brief Finds the first index `i` in `[first]..[last]` (inclusive) such that
+ *         the `len` slots starting at `i` are all free in `occ`.
+ *
+ *  @returns The starting index of the window, or -1 if there is none.
+ */
+static inline int occupancy_first_window(occupancy_t occ, int first, int last, int len) {
+  occupancy_t starts;
+  if (first < 0 || first > last)
+    return -1;
+  starts = occupancy_window_starts(occ, len) & occupancy_range(first, last);
+  return starts ? __builtin_ctzll(starts) : -1;
+}
+
+/** @brief Atomically marks the slots in `mask` as occupied in `*occ`, but only
+ *         if none of them are occupied already (reserve-or-fail).
+ *
+ *  @returns 1 if the slots were claimed, 0 if any of them was already taken, in
+ *           which case `*occ` is left unchanged.
+ */
+static inline int occupancy_try_claim(occupancy_t *occ, occupancy_t mask) {
+  occupancy_t old = __atomic_load_n(occ, __ATOMIC_ACQUIRE);
+  do {
+    if (old & mask)
+      return 0;
+  } while (!__atomic_compare_exchange_n(occ, &old, old | mask, 1, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_ACQUIRE));
+  return 1;
+}
+
+/** @brief Atomically claims the first free window of `len` slots in `*occ` that
+ *         starts somewhere in `[first]..[last]`.
+ *
+ *         The window is searched for and claimed with a single compare-and-swap,
+ *         so concurrent callers always end up with disjoint windows. If another
+ *         thread changes the word in between, the search is repeated against
+ *         the new value.
+ *
+ *  @returns The starting index of the claimed window, or -1 if there is none.
+ */
+static inline int occupancy_claim_first_window(occupancy_t *occ, int first, int last,
+                                               int len) {
+  occupancy_t old = __atomic_load_n(occ, __ATOMIC_ACQUIRE);
+  int idx;
+  do {
+    if ((idx = occupancy_first_window(old, first, last, len)) < 0)
+      return -1;
+  } while (!__atomic_compare_exchange_n(occ, &old, old | occupancy_range(idx, idx + len - 1),
+                                        1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+  return idx;
+}
+
+/** Signature shared by the multi-gate window search implementations. */
+typedef int (*occupancy_first_gate_fn)(const occupancy_t *occ, int num_gates,
+                                       int first, int last, int len);
+
+/** @brief Finds the lowest-index gate whose occupancy word `occ[gate]` has a
+ *         free window of `len` slots starting somewhere in `[first]..[last]`.
+ *
+ *         This gives the same answer as calling `occupancy_first_window` on
+ *         each gate in turn, but evaluates several gates per instruction using
+ *         AVX2 or SSE4.1 when the CPU supports them. The implementation is
+ *         picked once at program startup, falling back to a scalar loop.
+ *
+ *  @returns The index of the first gate that fits, or -1 if none does.
+ */
+int occupancy_first_gate(const occupancy_t *occ, int num_gates, int first, int last,
+                         int len);
+
+/** @brief Returns the name of the implementation used by `occupancy_first_gate`
+ *         ("avx2", "sse4" or "scalar").
+ */
+const char *occupancy_first_gate_impl(void);
+
+/** @brief Finds the gate with the fewest occupied slots among the first
+ *         `candidates` gates whose occupancy word `occ[gate]` has a free
+ *         window of `len` slots starting somewhere in `[first]..[last]`. The
+ *         popcount of a gate's word is its load, so no separate counters need
+ *         to be kept up to date.
+ *
+ *         Gates are visited from `from`, wrapping around, and ties go to the
+ *         first one visited: callers that start from different gates spread
+ *         out over equally loaded gates instead of all racing for one. Bounding
+ *         the candidates keeps the search from reading every gate of a large
+ *         airport once none of them is empty.
+ *
+ *  @returns The index of the least loaded gate that fits, or -1 if none does.
+ */
+int occupancy_least_loaded_gate(const occupancy_t *occ, int num_gates, int from, int first,
+                                int last, int len, int candidates);
+
+/** Individual implementations, exposed for benchmarking. The vector variants
+ *  must only be called if the CPU supports the matching instruction set. */
+int occupancy_first_gate_scalar(const occupancy_t *occ, int num_gates, int first,
+                                int last, int len);
+#if defined(__x86_64__) || defined(__i386__)
+int occupancy_first_gate_sse4(const occupancy_t *occ, int num_gates, int first,
+                              int last, int len);
+int occupancy_first_gate_avx2(const occupancy_t *occ, int num_gates, int first,
+                              int last, int len);
+#endif
+
+#endif
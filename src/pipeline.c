@@ -0,0 +1,170 @@
+#include "pipeline.h"
+#include "airport.h"
+
+#define REPLY_PENDING 0
+#define REPLY_DONE 1
+#define REPLY_FAILED 2
+
+static void *pipeline_reader_routine(void *arg);
+
+int pipeline_init(pipeline_t *pl, const sock_addr_t *addr) {
+  memset(pl, 0, sizeof(pipeline_t));
+  pl->addr = *addr;
+  pl->fd = -1;
+  pthread_mutex_init(&pl->lock, NULL);
+  pthread_mutex_init(&pl->write_lock, NULL);
+  pthread_cond_init(&pl->connected, NULL);
+  pthread_cond_init(&pl->replied, NULL);
+  if (pthread_create(&pl->reader, NULL, pipeline_reader_routine, pl) != 0)
+    return -1;
+  pthread_detach(pl->reader);
+  return 0;
+}
+
+/* Opens the connection if there is none. Must be called with `lock` held. */
+static int pipeline_connect(pipeline_t *pl) {
+  int fd;
+  if (pl->fd >= 0)
+    return 0;
+  if ((fd = open_addr_clientfd(&pl->addr)) < 0)
+    return -1;
+  pl->fd = fd;
+  pthread_cond_signal(&pl->connected);
+  return 0;
+}
+
+/* Looks up (and optionally unlinks) a request in flight. Requires `lock`. */
+static pending_reply_t *pipeline_find(pipeline_t *pl, unsigned id, int unlink) {
+  pending_reply_t **pp = &pl->pending[id % PIPELINE_BUCKETS], *p;
+  for (; (p = *pp); pp = &p->next) {
+    if (p->id == id) {
+      if (unlink)
+        *pp = p->next;
+      return p;
+    }
+  }
+  return NULL;
+}
+
+int pipeline_request(pipeline_t *pl, char *request, char **reply, size_t *len) {
+  pending_reply_t p = {0};
+  char frame[MAXBUF];
+  int frame_len, fd;
+
+  pthread_mutex_lock(&pl->lock);
+  if (pipeline_connect(pl) < 0) {
+    pthread_mutex_unlock(&pl->lock);
+    return -1;
+  }
+  p.id = pl->next_id++;
+  p.next = pl->pending[p.id % PIPELINE_BUCKETS];
+  pl->pending[p.id % PIPELINE_BUCKETS] = &p;
+  pthread_mutex_unlock(&pl->lock);
+
+  frame_len = snprintf(frame, sizeof(frame), "%c%u %s", PIPELINE_TAG, p.id, request);
+
+  // Check the connection is still the one this request was registered on:
+  // if it failed in the meantime, the reader has already failed the request
+  pthread_mutex_lock(&pl->write_lock);
+  pthread_mutex_lock(&pl->lock);
+  fd = (p.state == REPLY_PENDING) ? pl->fd : -1;
+  pthread_mutex_unlock(&pl->lock);
+  if (fd >= 0 && rio_writen(fd, frame, (size_t)frame_len) < 0)
+    shutdown(fd, SHUT_RDWR); // Wakes the reader, which fails every request
+  pthread_mutex_unlock(&pl->write_lock);
+
+  pthread_mutex_lock(&pl->lock);
+  while (p.state == REPLY_PENDING)
+    pthread_cond_wait(&pl->replied, &pl->lock);
+  pthread_mutex_unlock(&pl->lock);
+
+  if (p.state != REPLY_DONE) {
+    free(p.buf);
+    return -1;
+  }
+  *reply = p.buf;
+  *len = p.len;
+  return 0;
+}
+
+/* Appends a response line to a request's reply buffer. Returns -1 if the
+ * buffer could not grow, in which case the line is dropped. */
+static int pending_append(pending_reply_t *p, char *line, size_t n) {
+  char *grown;
+  if (p->len + n > p->cap) {
+    size_t cap = p->cap ? p->cap : MAXLINE;
+    while (cap < p->len + n)
+      cap *= 2;
+    if ((grown = realloc(p->buf, cap)) == NULL)
+      return -1;
+    p->buf = grown;
+    p->cap = cap;
+  }
+  memcpy(p->buf + p->len, line, n);
+  p->len += n;
+  return 0;
+}
+
+static void *pipeline_reader_routine(void *arg) {
+  pipeline_t *pl = arg;
+  pending_reply_t *p;
+  char line[MAXBUF], *body;
+  unsigned id;
+  ssize_t n;
+  rio_t rio;
+  int fd, truncated;
+
+  while (1) {
+    pthread_mutex_lock(&pl->lock);
+    while (pl->fd < 0)
+      pthread_cond_wait(&pl->connected, &pl->lock);
+    fd = pl->fd;
+    pthread_mutex_unlock(&pl->lock);
+    rio_readinitb(&rio, fd);
+
+    // Read response frames until the connection fails
+    while ((n = rio_readlineb(&rio, line, MAXLINE)) > 0) {
+      if (line[0] != PIPELINE_TAG || sscanf(line + 1, "%u", &id) != 1)
+        break;
+      pthread_mutex_lock(&pl->lock);
+      p = pipeline_find(pl, id, 0);
+      pthread_mutex_unlock(&pl->lock);
+
+      // The requester only reads its buffer once the request is done. A
+      // reply missing lines fails its request, but the rest of the frame is
+      // still read so that the next one starts where it should
+      truncated = 0;
+      while ((n = rio_readlinep(&rio, &body, MAXLINE)) > 0) {
+        if ((size_t)n == strlen(RESPONSE_END) && memcmp(body, RESPONSE_END, (size_t)n) == 0)
+          break;
+        if (p && !truncated && pending_append(p, body, (size_t)n) < 0)
+          truncated = 1;
+      }
+      if (n <= 0)
+        break;
+
+      pthread_mutex_lock(&pl->lock);
+      if (p) {
+        pipeline_find(pl, id, 1);
+        p->state = truncated ? REPLY_FAILED : REPLY_DONE;
+        pthread_cond_broadcast(&pl->replied);
+      }
+      pthread_mutex_unlock(&pl->lock);
+    }
+
+    // Drop the connection and fail everything that was in flight on it
+    pthread_mutex_lock(&pl->write_lock);
+    pthread_mutex_lock(&pl->lock);
+    close(fd);
+    pl->fd = -1;
+    for (int bucket = 0; bucket < PIPELINE_BUCKETS; bucket++) {
+      for (p = pl->pending[bucket]; p; p = p->next)
+        p->state = REPLY_FAILED;
+      pl->pending[bucket] = NULL;
+    }
+    pthread_cond_broadcast(&pl->replied);
+    pthread_mutex_unlock(&pl->lock);
+    pthread_mutex_unlock(&pl->write_lock);
+  }
+  return NULL;
+}
@@ -0,0 +1,69 @@
+#ifndef PIPELINE_HEADER
+#define PIPELINE_HEADER
+
+#include "network_utils.h"
+#include <pthread.h>
+
+/** A pipelined channel from the controller to one airport node.
+ *
+ *  Any number of controller workers can have requests in flight over the same
+ *  connection. Each request is sent as `#<id> <request line>`, and the airport
+ *  answers with a frame made of a `#<id>` header line, the response lines and
+ *  `RESPONSE_END`. A dedicated reader thread matches each frame to the waiting
+ *  request by its id, so responses may arrive in any order.
+ *
+ *  If the connection fails, every request in flight on it fails, and the next
+ *  request opens a new connection.
+ */
+
+/* First character of a pipelined request and of a response frame header. */
+#define PIPELINE_TAG '#'
+
+/* Number of hash buckets used to look up requests in flight by id. */
+#define PIPELINE_BUCKETS 64
+
+typedef struct pending_reply_t pending_reply_t;
+
+struct pending_reply_t {
+  unsigned id;
+  int state;      /* One of the `REPLY_*` values in pipeline.c */
+  char *buf;      /* Response lines received so far */
+  size_t len, cap;
+  pending_reply_t *next; /* Next request in the same hash bucket */
+};
+
+typedef struct pipeline_t pipeline_t;
+
+struct pipeline_t {
+  pthread_mutex_t lock;       /* Protects `fd`, `next_id` and `pending` */
+  pthread_mutex_t write_lock; /* Keeps requests from interleaving on the socket */
+  pthread_cond_t connected;   /* Signalled when a new connection is opened */
+  pthread_cond_t replied;     /* Signalled when a request completes or fails */
+  int fd;                     /* -1 while disconnected */
+  unsigned next_id;
+  pending_reply_t *pending[PIPELINE_BUCKETS];
+  sock_addr_t addr;
+  pthread_t reader;
+};
+
+/** @brief Initialises a pipelined channel to `addr` and starts its reader
+ *         thread. The connection is opened on the first request.
+ *
+ *  @returns 0 on success, -1 if the reader thread could not be started.
+ */
+int pipeline_init(pipeline_t *pl, const sock_addr_t *addr);
+
+/** @brief Sends one request line over the channel and waits for its response.
+ *
+ *  @param request The request line, ending in a newline.
+ *  @param reply   Set to an allocated buffer holding the response lines
+ *                 (without `RESPONSE_END`), which the caller must free.
+ *  @param len     Set to the length of the response.
+ *
+ *  @returns 0 on success, -1 if the request could not be sent, the
+ *           connection failed before its response arrived, or the response
+ *           could not be stored in full.
+ */
+int pipeline_request(pipeline_t *pl, char *request, char **reply, size_t *len);
+
+#endif
@@ -0,0 +1,88 @@
+#include "plane_index.h"
+
+#define PACK_BOOKING(gate, start, end) \
+  (((uint64_t)(unsigned)(gate) << 16) | ((uint64_t)(start) << 8) | (uint64_t)(end))
+
+static size_t plane_hash(int plane_id) {
+  // Fibonacci hashing spreads sequential plane ids over the buckets
+  return (size_t)(((uint64_t)(unsigned)plane_id * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+plane_index_t *create_plane_index(size_t expected) {
+  plane_index_t *index = calloc(1, sizeof(plane_index_t));
+  size_t num_buckets = 64;
+  if (index == NULL)
+    return NULL;
+  while (num_buckets < expected)
+    num_buckets <<= 1;
+  index->mask = num_buckets - 1;
+  index->buckets = calloc(num_buckets, sizeof(plane_entry_t *));
+  if (index->buckets == NULL) {
+    free(index);
+    return NULL;
+  }
+  for (int i = 0; i < PLANE_INDEX_STRIPES; i++)
+    pthread_mutex_init(&index->locks[i], NULL);
+  return index;
+}
+
+void destroy_plane_index(plane_index_t *index) {
+  plane_entry_t *entry, *next;
+  if (index == NULL)
+    return;
+  for (size_t i = 0; i <= index->mask; i++) {
+    for (entry = index->buckets[i]; entry; entry = next) {
+      next = entry->next;
+      free(entry);
+    }
+  }
+  for (int i = 0; i < PLANE_INDEX_STRIPES; i++)
+    pthread_mutex_destroy(&index->locks[i]);
+  free(index->buckets);
+  free(index);
+}
+
+int plane_index_insert(plane_index_t *index, int plane_id, int gate, int start, int end) {
+  size_t bucket = plane_hash(plane_id) & index->mask;
+  pthread_mutex_t *lock = &index->locks[bucket % PLANE_INDEX_STRIPES];
+  uint64_t booking = PACK_BOOKING(gate, start, end);
+  plane_entry_t *entry;
+  int ret = 0;
+
+  pthread_mutex_lock(lock);
+  for (entry = index->buckets[bucket]; entry; entry = entry->next) {
+    if (entry->plane_id == plane_id)
+      break;
+  }
+  if (entry) {
+    // Keep the booking a gate-ordered scan would have found first
+    if (booking < entry->booking)
+      __atomic_store_n(&entry->booking, booking, __ATOMIC_RELEASE);
+  } else if ((entry = malloc(sizeof(plane_entry_t))) != NULL) {
+    entry->plane_id = plane_id;
+    entry->booking = booking;
+    entry->next = index->buckets[bucket];
+    __atomic_store_n(&index->buckets[bucket], entry, __ATOMIC_RELEASE);
+  } else {
+    ret = -1;
+  }
+  pthread_mutex_unlock(lock);
+  return ret;
+}
+
+int plane_index_lookup(plane_index_t *index, int plane_id, int *gate, int *start, int *end) {
+  size_t bucket = plane_hash(plane_id) & index->mask;
+  plane_entry_t *entry = __atomic_load_n(&index->buckets[bucket], __ATOMIC_ACQUIRE);
+  uint64_t booking;
+
+  for (; entry; entry = entry->next) {
+    if (entry->plane_id == plane_id) {
+      booking = __atomic_load_n(&entry->booking, __ATOMIC_ACQUIRE);
+      *gate = (int)(booking >> 16);
+      *start = (int)((booking >> 8) & 0xff);
+      *end = (int)(booking & 0xff);
+      return 1;
+    }
+  }
+  return 0;
+}
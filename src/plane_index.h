@@ -0,0 +1,65 @@
+#ifndef PLANE_INDEX_HEADER
+#define PLANE_INDEX_HEADER
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Number of mutexes shared between the index buckets to serialise writers. */
+#define PLANE_INDEX_STRIPES 64
+
+/** Hash index from plane_id to the (gate, start, end) triple it is scheduled
+ *  at, so that PLANE_STATUS lookups do not have to scan every gate.
+ *
+ *  Entries are only ever added or moved to an earlier (gate, start) booking, so
+ *  readers walk the bucket chains without taking any lock: new entries are
+ *  published with a release store of the bucket head, and the booking itself is
+ *  packed into a single atomically updated word. Writers serialise on one of
+ *  `PLANE_INDEX_STRIPES` striped mutexes.
+ */
+typedef struct plane_entry_t plane_entry_t;
+
+struct plane_entry_t {
+  int plane_id;
+  /* Packed as (gate << 16 | start << 8 | end), so that comparing two packed
+   * values orders bookings by gate and then by start time. */
+  uint64_t booking;
+  plane_entry_t *next;
+};
+
+typedef struct plane_index_t plane_index_t;
+
+struct plane_index_t {
+  size_t mask; // Number of buckets - 1 (the bucket count is a power of two)
+  plane_entry_t **buckets;
+  pthread_mutex_t locks[PLANE_INDEX_STRIPES];
+};
+
+/** @brief Allocates an empty index sized for roughly `expected` planes.
+ *
+ *  @returns A pointer to the index, or `NULL` if allocation failed.
+ */
+plane_index_t *create_plane_index(size_t expected);
+
+/** @brief Frees the index and all of its entries. */
+void destroy_plane_index(plane_index_t *index);
+
+/** @brief Records that `plane_id` is scheduled at `gate` from slot `start` to
+ *         slot `end` (inclusive).
+ *
+ *  If the plane is already indexed, the entry is only replaced when the new
+ *  booking is at a lower gate, or at an earlier start in the same gate. This
+ *  matches the booking a scan over the gates in order would find first.
+ *
+ *  @returns 0 on success, -1 if an entry could not be allocated.
+ */
+int plane_index_insert(plane_index_t *index, int plane_id, int gate, int start, int end);
+
+/** @brief Looks up the booking of `plane_id`, storing it through the `gate`,
+ *         `start` and `end` pointers.
+ *
+ *  @returns 1 if the plane was found, 0 otherwise.
+ */
+int plane_index_lookup(plane_index_t *index, int plane_id, int *gate, int *start, int *end);
+
+#endif
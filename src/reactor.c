@@ -0,0 +1,758 @@
+#include "reactor.h"
+#include "airport.h"
+
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+static void *reactor_loop_routine(void *arg);
+
+/* The unordered connection whose request the calling worker is answering, and
+ * whether it holds the connection's `frame_lock` (see `reactor_send`). */
+static __thread reactor_conn_t *FRAME_CONN = NULL;
+static __thread int FRAME_LOCKED = 0;
+
+int reactor_init(reactor_t *reactor, reactor_handler_fn handler, scheduler_t *queue,
+                 reactor_backend_t backend) {
+  struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+  reactor_loop_t *loop;
+
+  memset(reactor, 0, sizeof(reactor_t));
+  reactor->backend = backend;
+  reactor->handler = handler;
+  reactor->queue = queue;
+
+  if (backend == REACTOR_URING) {
+    // The ring thread waits on the eventfd with a blocking read of its own
+    loop = &reactor->loops[0];
+    loop->reactor = reactor;
+    loop->epfd = -1;
+    pthread_mutex_init(&loop->lock, NULL);
+    if (uring_init(&reactor->ring, REACTOR_URING_ENTRIES) < 0) {
+      perror("io_uring_setup");
+      return -1;
+    }
+    if (uring_buf_ring_init(&reactor->ring, &reactor->bufs, 0, REACTOR_URING_BUFS,
+                            REACTOR_URING_BUF_SIZE) < 0 ||
+        (loop->wakefd = eventfd(0, EFD_CLOEXEC)) < 0) {
+      perror("reactor_init");
+      uring_exit(&reactor->ring);
+      return -1;
+    }
+    return 0;
+  }
+
+  for (int i = 0; i < REACTOR_LOOPS; i++) {
+    loop = &reactor->loops[i];
+    loop->reactor = reactor;
+    pthread_mutex_init(&loop->lock, NULL);
+    if ((loop->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0 ||
+        (loop->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0 ||
+        epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->wakefd, &ev) < 0) {
+      perror("reactor_init");
+      return -1;
+    }
+    if (pthread_create(&loop->tid, NULL, reactor_loop_routine, loop) != 0) {
+      perror("pthread_create");
+      return -1;
+    }
+    pthread_detach(loop->tid);
+  }
+  return 0;
+}
+
+/** Responses go out as soon as they are ready, so a client with several
+ *  requests in flight must not have the later ones held back by Nagle's
+ *  algorithm until the first is acknowledged. */
+static void reactor_set_nodelay(int fd) {
+  int optval = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
+}
+
+int reactor_add(reactor_t *reactor, int connfd) {
+  struct epoll_event ev;
+  reactor_conn_t *conn;
+  unsigned idx = __atomic_fetch_add(&reactor->next_loop, 1, __ATOMIC_RELAXED);
+
+  reactor_set_nodelay(connfd);
+
+  if (fcntl(connfd, F_SETFL, fcntl(connfd, F_GETFL) | O_NONBLOCK) < 0 ||
+      (conn = calloc(1, sizeof(reactor_conn_t))) == NULL) {
+    close(connfd);
+    return -1;
+  }
+  conn->fd = connfd;
+  conn->msg_max = socket_message_max(connfd);
+  conn->loop = &reactor->loops[idx % REACTOR_LOOPS];
+  pthread_mutex_init(&conn->lock, NULL);
+  pthread_mutex_init(&conn->frame_lock, NULL);
+
+  // Edge-triggered: the loop is told once when new data arrives or the socket
+  // becomes writable again, and must then read or write until EAGAIN
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  ev.data.ptr = conn;
+  if (epoll_ctl(conn->loop->epfd, EPOLL_CTL_ADD, connfd, &ev) < 0) {
+    perror("epoll_ctl");
+    pthread_mutex_destroy(&conn->lock);
+    pthread_mutex_destroy(&conn->frame_lock);
+    free(conn);
+    close(connfd);
+    return -1;
+  }
+  return 0;
+}
+
+/** Hands a connection to its loop to be closed and freed. Only the owning loop
+ *  frees connections, and only between two `epoll_wait` batches, so an event
+ *  it has already received never refers to a freed connection. */
+static void reactor_retire(reactor_conn_t *conn) {
+  reactor_loop_t *loop = conn->loop;
+  uint64_t one = 1;
+  pthread_mutex_lock(&loop->lock);
+  conn->next_retired = loop->retired;
+  loop->retired = conn;
+  pthread_mutex_unlock(&loop->lock);
+  if (write(loop->wakefd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+    perror("reactor_retire");
+}
+
+/** Decides whether a connection is finished with, marking it as retiring if
+ *  so. Requires `conn->lock`. */
+static int reactor_done(reactor_conn_t *conn) {
+  if (conn->retiring || conn->scheduled || conn->sending || conn->held)
+    return 0;
+  if (conn->failed || (conn->eof && conn->out_len == 0))
+    conn->retiring = 1;
+  return conn->retiring;
+}
+
+static void reactor_free(reactor_conn_t *conn) {
+  reactor_line_t *line, *next;
+  if (conn->loop->epfd >= 0)
+    epoll_ctl(conn->loop->epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+  close(conn->fd);
+  for (line = conn->head; line; line = next) {
+    next = line->next;
+    free(line);
+  }
+  free(conn->out);
+  free(conn->wbuf);
+  pthread_mutex_destroy(&conn->lock);
+  pthread_mutex_destroy(&conn->frame_lock);
+  free(conn);
+}
+
+/** How much of `len` pending bytes one send may carry: a SOCK_SEQPACKET
+ *  socket sends each as one message, which its reader must have room for. */
+static size_t reactor_send_len(reactor_conn_t *conn, size_t len) {
+  return (conn->msg_max != 0 && len > conn->msg_max) ? conn->msg_max : len;
+}
+
+/** Writes as much pending output as the socket accepts. Requires `conn->lock`. */
+static void reactor_flush(reactor_conn_t *conn) {
+  size_t done = 0;
+  ssize_t n;
+  while (done < conn->out_len && !conn->failed) {
+    n = send(conn->fd, conn->out + done, reactor_send_len(conn, conn->out_len - done),
+             MSG_NOSIGNAL);
+    if (n > 0)
+      done += (size_t)n;
+    else if (n < 0 && errno == EINTR)
+      continue;
+    else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      break;
+    else
+      conn->failed = 1;
+  }
+  if (conn->failed)
+    conn->out_len = 0;
+  else if (done > 0) {
+    memmove(conn->out, conn->out + done, conn->out_len - done);
+    conn->out_len -= done;
+  }
+}
+
+/** Asks the ring thread to send the output of `conn` (io_uring backend). */
+static void reactor_queue_flush(reactor_conn_t *conn) {
+  reactor_loop_t *loop = conn->loop;
+  uint64_t one = 1;
+  int wake;
+  pthread_mutex_lock(&loop->lock);
+  // A non-empty list means the ring thread has already been woken up
+  wake = (loop->flush == NULL);
+  conn->next_flush = loop->flush;
+  loop->flush = conn;
+  pthread_mutex_unlock(&loop->lock);
+  if (wake && write(loop->wakefd, &one, sizeof(one)) < 0)
+    perror("reactor_queue_flush");
+}
+
+void reactor_send(reactor_conn_t *conn, const char *buf, size_t len) {
+  char *grown;
+  int queue = 0;
+
+  // Other workers may be answering requests of an unordered connection, so a
+  // response sent in several parts holds off theirs until it is complete
+  if (conn == FRAME_CONN && !FRAME_LOCKED) {
+    pthread_mutex_lock(&conn->frame_lock);
+    FRAME_LOCKED = 1;
+  }
+  pthread_mutex_lock(&conn->lock);
+  if (conn->failed) {
+    pthread_mutex_unlock(&conn->lock);
+    return;
+  }
+  if (conn->out_len + len > conn->out_cap) {
+    conn->out_cap = (conn->out_len + len) * 2;
+    if ((grown = realloc(conn->out, conn->out_cap)) == NULL) {
+      conn->failed = 1;
+      conn->out_len = 0;
+      pthread_mutex_unlock(&conn->lock);
+      return;
+    }
+    conn->out = grown;
+  }
+  memcpy(conn->out + conn->out_len, buf, len);
+  conn->out_len += len;
+
+  // Hold the output back while more requests of the connection are queued,
+  // so their responses go out together, unless it has piled up or waited
+  if (!FLUSH_EACH_RESPONSE && conn->head != NULL && conn->out_len < WIO_BUFSIZE) {
+    uint64_t now = monotonic_us();
+    if (conn->out_len == len)
+      conn->out_since = now;
+    if (now - conn->out_since < WIO_MAX_DELAY_US) {
+      pthread_mutex_unlock(&conn->lock);
+      return;
+    }
+  }
+  if (conn->loop->reactor->backend == REACTOR_EPOLL) {
+    reactor_flush(conn);
+  } else if (!conn->flush_queued && !conn->sending) {
+    // A send in flight picks up the new output when it completes
+    conn->flush_queued = queue = 1;
+  }
+  pthread_mutex_unlock(&conn->lock);
+  if (queue)
+    reactor_queue_flush(conn);
+}
+
+/** `wio_sink_fn` of the buffers set up by `reactor_output_init`. */
+static ssize_t reactor_sink(void *conn, const void *buf, size_t len) {
+  reactor_send(conn, buf, len);
+  return (ssize_t)len;
+}
+
+void reactor_output_init(wio_t *out, reactor_conn_t *conn) {
+  wio_init_sink(out, reactor_sink, conn, 0);
+}
+
+void reactor_set_unordered(reactor_conn_t *conn) {
+  if (__atomic_load_n(&conn->unordered, __ATOMIC_RELAXED))
+    return;
+  pthread_mutex_lock(&conn->lock);
+  conn->unordered = 1;
+  pthread_mutex_unlock(&conn->lock);
+}
+
+void reactor_hold(reactor_conn_t *conn) {
+  pthread_mutex_lock(&conn->lock);
+  conn->held++;
+  pthread_mutex_unlock(&conn->lock);
+}
+
+void reactor_send_held(reactor_conn_t *conn, const char *buf, size_t len) {
+  int retire;
+
+  // Not one of the workers' frames, so take the frame lock by hand
+  pthread_mutex_lock(&conn->frame_lock);
+  reactor_send(conn, buf, len);
+  pthread_mutex_unlock(&conn->frame_lock);
+
+  // The connection may have been waiting for this response to be closed
+  pthread_mutex_lock(&conn->lock);
+  conn->held--;
+  retire = reactor_done(conn);
+  pthread_mutex_unlock(&conn->lock);
+  if (retire)
+    reactor_retire(conn);
+}
+
+/** Queues the request line (or binary record) in `conn->in` for the workers.
+ *  An empty line ends the connection instead. Requires `conn->lock`. */
+static void reactor_push_line(reactor_conn_t *conn) {
+  reactor_line_t *line;
+  size_t len = conn->in_len;
+  conn->in_len = 0;
+  if (!conn->binary && len == 1 && conn->in[0] == '\n') {
+    conn->eof = 1;
+    return;
+  }
+  if ((line = malloc(sizeof(reactor_line_t) + len + 2)) == NULL) {
+    conn->failed = 1;
+    return;
+  }
+  line->next = NULL;
+  line->len = len;
+  line->binary = conn->binary;
+  memcpy(line->buf, conn->in, len);
+  line->buf[len] = '\0';
+  if (conn->tail)
+    conn->tail->next = line;
+  else
+    conn->head = line;
+  conn->tail = line;
+
+  // Everything after the hello line is a binary record
+  if (!conn->binary && len == strlen(WIRE_HELLO) && memcmp(line->buf, WIRE_HELLO, len) == 0)
+    conn->binary = 1;
+}
+
+/** Splits received bytes into request lines of at most `MAXLINE - 1`
+ *  characters, the same limit as `rio_readlineb`, or into `WIRE_REQUEST_SIZE`
+ *  records once the connection has switched to the binary protocol. Requires
+ *  `conn->lock`. */
+static void reactor_split_lines(reactor_conn_t *conn, char *buf, size_t len) {
+  char *nl;
+  size_t take;
+  while (len > 0 && !conn->eof && !conn->failed) {
+    if (conn->binary) {
+      take = WIRE_REQUEST_SIZE - conn->in_len;
+    } else {
+      nl = memchr(buf, '\n', len);
+      take = nl ? (size_t)(nl - buf) + 1 : len;
+      if (take > MAXLINE - 1 - conn->in_len)
+        take = MAXLINE - 1 - conn->in_len;
+    }
+    if (take > len)
+      take = len;
+    memcpy(conn->in + conn->in_len, buf, take);
+    conn->in_len += take;
+    buf += take;
+    len -= take;
+    if (conn->binary ? conn->in_len == WIRE_REQUEST_SIZE
+                     : conn->in[conn->in_len - 1] == '\n' || conn->in_len == MAXLINE - 1)
+      reactor_push_line(conn);
+  }
+}
+
+/** Takes in `n` bytes received on a connection (0 at the end of the stream,
+ *  or negative on an error), and schedules the connection on a worker if it
+ *  has requests waiting. Returns 1 if nothing more should be read from it. */
+static int reactor_ingest(reactor_conn_t *conn, char *buf, ssize_t n) {
+  int schedule = 0, stop;
+  pthread_mutex_lock(&conn->lock);
+  if (n > 0 && !conn->eof) {
+    reactor_split_lines(conn, buf, (size_t)n);
+  } else if (!conn->eof) {
+    // The client hung up: answer a last unterminated line like rio does, but
+    // drop a truncated binary record
+    if (conn->in_len > 0 && !conn->binary)
+      reactor_push_line(conn);
+    conn->eof = 1;
+    conn->failed |= (n < 0);
+  }
+  if (conn->head && !conn->scheduled)
+    conn->scheduled = schedule = 1;
+  stop = conn->eof || conn->failed;
+  pthread_mutex_unlock(&conn->lock);
+
+  if (schedule)
+    scheduler_submit(conn->loop->reactor->queue, conn);
+  return stop;
+}
+
+/** Reads everything that has arrived on a connection. */
+static void reactor_read(reactor_conn_t *conn) {
+  char buf[RIO_BUFSIZE];
+  ssize_t n;
+  int retire;
+
+  while (1) {
+    n = read(conn->fd, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      break;
+    if (reactor_ingest(conn, buf, n))
+      break;
+  }
+
+  pthread_mutex_lock(&conn->lock);
+  retire = reactor_done(conn);
+  pthread_mutex_unlock(&conn->lock);
+  if (retire)
+    reactor_retire(conn);
+}
+
+static void *reactor_loop_routine(void *arg) {
+  reactor_loop_t *loop = (reactor_loop_t *)arg;
+  struct epoll_event events[REACTOR_EVENTS];
+  reactor_conn_t *conn, *retired;
+  uint64_t count;
+  int n, retire;
+
+  while (1) {
+    if ((n = epoll_wait(loop->epfd, events, REACTOR_EVENTS, -1)) < 0) {
+      if (errno != EINTR)
+        perror("epoll_wait");
+      continue;
+    }
+
+    for (int i = 0; i < n; i++) {
+      if ((conn = events[i].data.ptr) == NULL) {
+        // Woken up to close retired connections below
+        if (read(loop->wakefd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+          perror("eventfd");
+        continue;
+      }
+      if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+        reactor_read(conn);
+      if (events[i].events & EPOLLOUT) {
+        pthread_mutex_lock(&conn->lock);
+        reactor_flush(conn);
+        retire = reactor_done(conn);
+        pthread_mutex_unlock(&conn->lock);
+        if (retire)
+          reactor_retire(conn);
+      }
+    }
+
+    pthread_mutex_lock(&loop->lock);
+    retired = loop->retired;
+    loop->retired = NULL;
+    pthread_mutex_unlock(&loop->lock);
+    for (; retired; retired = conn) {
+      conn = retired->next_retired;
+      reactor_free(retired);
+    }
+  }
+  return NULL;
+}
+
+void *reactor_worker_routine(void *arg) {
+  pthread_detach(pthread_self());
+  reactor_t *reactor = (reactor_t *)arg;
+  reactor_conn_t *conn;
+  reactor_line_t *line;
+  int retire = 0, offer, unordered;
+
+  while ((conn = scheduler_take(reactor->queue)) != NULL) {
+
+    // Answer the connection's requests in order until none are left. Only one
+    // worker serves an ordinary connection at a time, so responses are never
+    // reordered. An unordered connection with more requests waiting is
+    // offered to the other workers too, up to one per worker.
+    while (1) {
+      offer = 0;
+      pthread_mutex_lock(&conn->lock);
+      if ((line = conn->head) != NULL) {
+        if ((conn->head = line->next) == NULL)
+          conn->tail = NULL;
+        if (conn->unordered && conn->head && conn->scheduled < reactor->queue->num_workers)
+          conn->scheduled += offer = 1;
+      } else {
+        conn->scheduled--;
+        retire = reactor_done(conn);
+      }
+      unordered = conn->unordered;
+      pthread_mutex_unlock(&conn->lock);
+      if (line == NULL)
+        break;
+      if (offer)
+        scheduler_submit(reactor->queue, conn);
+      if (unordered)
+        FRAME_CONN = conn;
+      reactor->handler(conn, line);
+      if (FRAME_LOCKED) {
+        pthread_mutex_unlock(&conn->frame_lock);
+        FRAME_LOCKED = 0;
+      }
+      FRAME_CONN = NULL;
+      free(line);
+    }
+    if (retire)
+      reactor_retire(conn);
+  }
+  return NULL;
+}
+
+/* Operation a completion belongs to, stored in the low bits of `user_data`
+ * next to the connection pointer (which is at least 8-byte aligned). */
+#define URING_RECV 0
+#define URING_SEND 1
+#define URING_ACCEPT 2
+#define URING_WAKE 3
+#define URING_CANCEL 4
+#define URING_TAG_MASK 7
+
+#define URING_DATA(conn, tag) ((uint64_t)(uintptr_t)(conn) | (tag))
+#define URING_CONN(data) ((reactor_conn_t *)(uintptr_t)((data) & ~(uint64_t)URING_TAG_MASK))
+
+/** Returns a submission entry for the ring thread, or `NULL` if the ring is
+ *  jammed, which the callers treat as a failed operation. */
+static struct io_uring_sqe *uring_sqe(reactor_t *reactor, uint8_t opcode, int fd,
+                                      uint64_t data) {
+  struct io_uring_sqe *sqe = uring_get_sqe(&reactor->ring);
+  if (sqe == NULL) {
+    perror("io_uring_enter");
+    return NULL;
+  }
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->user_data = data;
+  return sqe;
+}
+
+static void uring_arm_accept(reactor_t *reactor, int listenfd) {
+  struct io_uring_sqe *sqe = uring_sqe(reactor, IORING_OP_ACCEPT, listenfd,
+                                       URING_DATA(NULL, URING_ACCEPT));
+  if (sqe)
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+}
+
+static void uring_arm_wake(reactor_t *reactor, uint64_t *count) {
+  struct io_uring_sqe *sqe = uring_sqe(reactor, IORING_OP_READ, reactor->loops[0].wakefd,
+                                       URING_DATA(NULL, URING_WAKE));
+  if (sqe) {
+    sqe->addr = (uint64_t)(uintptr_t)count;
+    sqe->len = sizeof(*count);
+  }
+}
+
+/** Arms a multishot receive, which keeps picking provided buffers for each
+ *  chunk of data until it fails or the buffers run out. */
+static int uring_arm_recv(reactor_t *reactor, reactor_conn_t *conn) {
+  struct io_uring_sqe *sqe = uring_sqe(reactor, IORING_OP_RECV, conn->fd,
+                                       URING_DATA(conn, URING_RECV));
+  if (sqe == NULL)
+    return -1;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = reactor->bufs.bgid;
+  return 0;
+}
+
+/** Starts sending the output of `conn` if there is some and no send is in
+ *  flight. The pending output moves to `wbuf`, which the kernel reads from
+ *  while workers keep appending to `out`. Requires `conn->lock`. */
+static void uring_start_send(reactor_t *reactor, reactor_conn_t *conn) {
+  struct io_uring_sqe *sqe;
+  char *buf;
+  size_t cap;
+  if (conn->sending || conn->out_len == 0 || conn->failed)
+    return;
+  buf = conn->wbuf;
+  cap = conn->wcap;
+  conn->wbuf = conn->out;
+  conn->wcap = conn->out_cap;
+  conn->wlen = conn->out_len;
+  conn->woff = 0;
+  conn->out = buf;
+  conn->out_cap = cap;
+  conn->out_len = 0;
+
+  if ((sqe = uring_sqe(reactor, IORING_OP_SEND, conn->fd, URING_DATA(conn, URING_SEND))) == NULL) {
+    conn->failed = 1;
+    return;
+  }
+  sqe->addr = (uint64_t)(uintptr_t)conn->wbuf;
+  sqe->len = (unsigned)reactor_send_len(conn, conn->wlen);
+  sqe->msg_flags = MSG_NOSIGNAL;
+  conn->sending = 1;
+}
+
+/** Frees a retiring connection once its multishot receive has terminated,
+ *  cancelling the receive first if it is still armed. */
+static void uring_release(reactor_t *reactor, reactor_conn_t *conn) {
+  struct io_uring_sqe *sqe;
+  if (conn->recv_armed) {
+    if (!conn->cancelled &&
+        (sqe = uring_sqe(reactor, IORING_OP_ASYNC_CANCEL, -1, URING_DATA(NULL, URING_CANCEL)))) {
+      sqe->addr = URING_DATA(conn, URING_RECV);
+      conn->cancelled = 1;
+    }
+    return;
+  }
+  reactor_free(conn);
+}
+
+static void uring_on_accept(reactor_t *reactor, int res) {
+  reactor_conn_t *conn;
+  if (res < 0) {
+    errno = -res;
+    perror("accept");
+    return;
+  }
+  if ((conn = calloc(1, sizeof(reactor_conn_t))) == NULL) {
+    close(res);
+    return;
+  }
+  reactor_set_nodelay(res);
+  conn->fd = res;
+  conn->msg_max = socket_message_max(res);
+  conn->loop = &reactor->loops[0];
+  pthread_mutex_init(&conn->lock, NULL);
+  pthread_mutex_init(&conn->frame_lock, NULL);
+  if (uring_arm_recv(reactor, conn) < 0) {
+    reactor_free(conn);
+    return;
+  }
+  conn->recv_armed = 1;
+}
+
+static void uring_on_recv(reactor_t *reactor, reactor_conn_t *conn, int res, unsigned flags) {
+  unsigned bid;
+  int rearm = 0, release;
+
+  if (flags & IORING_CQE_F_BUFFER) {
+    bid = flags >> IORING_CQE_BUFFER_SHIFT;
+    if (res > 0)
+      reactor_ingest(conn, uring_buf_ring_get(&reactor->bufs, bid), res);
+    uring_buf_ring_recycle(&reactor->bufs, bid);
+  } else if (res != -ENOBUFS && res != -ECANCELED) {
+    // End of stream, or an error: -ENOBUFS only means the buffers ran out
+    reactor_ingest(conn, NULL, res == 0 ? 0 : -1);
+  }
+
+  pthread_mutex_lock(&conn->lock);
+  if (!(flags & IORING_CQE_F_MORE)) {
+    conn->recv_armed = rearm = !conn->eof && !conn->failed && !conn->cancelled;
+  }
+  // Either it is finished with, or it already was and its release was only
+  // waiting for the cancelled receive to terminate
+  release = reactor_done(conn) || (conn->cancelled && !conn->recv_armed);
+  pthread_mutex_unlock(&conn->lock);
+
+  if (rearm && uring_arm_recv(reactor, conn) < 0) {
+    pthread_mutex_lock(&conn->lock);
+    conn->recv_armed = 0;
+    conn->failed = 1;
+    release = reactor_done(conn);
+    pthread_mutex_unlock(&conn->lock);
+  }
+  if (release)
+    uring_release(reactor, conn);
+}
+
+static void uring_on_send(reactor_t *reactor, reactor_conn_t *conn, int res) {
+  struct io_uring_sqe *sqe;
+  int release;
+
+  pthread_mutex_lock(&conn->lock);
+  if (res < 0) {
+    conn->failed = 1;
+    conn->out_len = 0;
+  } else if ((conn->woff += (size_t)res) < conn->wlen) {
+    // Short send: queue the rest straight away
+    sqe = uring_sqe(reactor, IORING_OP_SEND, conn->fd, URING_DATA(conn, URING_SEND));
+    if (sqe) {
+      sqe->addr = (uint64_t)(uintptr_t)(conn->wbuf + conn->woff);
+      sqe->len = (unsigned)reactor_send_len(conn, conn->wlen - conn->woff);
+      sqe->msg_flags = MSG_NOSIGNAL;
+      pthread_mutex_unlock(&conn->lock);
+      return;
+    }
+    conn->failed = 1;
+  }
+  conn->sending = 0;
+  uring_start_send(reactor, conn);
+  release = reactor_done(conn);
+  pthread_mutex_unlock(&conn->lock);
+  if (release)
+    uring_release(reactor, conn);
+}
+
+/** Sends the output queued by the workers and releases the connections they
+ *  retired since the last wake-up. */
+static void uring_on_wake(reactor_t *reactor) {
+  reactor_loop_t *loop = &reactor->loops[0];
+  reactor_conn_t *flush, *retired, *conn;
+  int release;
+
+  pthread_mutex_lock(&loop->lock);
+  flush = loop->flush;
+  retired = loop->retired;
+  loop->flush = loop->retired = NULL;
+  pthread_mutex_unlock(&loop->lock);
+
+  for (; flush; flush = conn) {
+    conn = flush->next_flush;
+    pthread_mutex_lock(&flush->lock);
+    flush->flush_queued = 0;
+    uring_start_send(reactor, flush);
+    release = reactor_done(flush);
+    pthread_mutex_unlock(&flush->lock);
+    if (release)
+      uring_release(reactor, flush);
+  }
+  for (; retired; retired = conn) {
+    conn = retired->next_retired;
+    uring_release(reactor, retired);
+  }
+}
+
+static void reactor_uring_serve(reactor_t *reactor, int listenfd) {
+  struct io_uring_cqe *cqe;
+  uint64_t data, count;
+  unsigned flags;
+  int res;
+
+  uring_arm_accept(reactor, listenfd);
+  uring_arm_wake(reactor, &count);
+
+  while (1) {
+    // One system call submits everything queued since the last round, and
+    // waits for the next batch of completions
+    if (uring_submit_and_wait(&reactor->ring, 1) < 0 && errno != EINTR) {
+      perror("io_uring_enter");
+      continue;
+    }
+
+    while ((cqe = uring_peek_cqe(&reactor->ring)) != NULL) {
+      data = cqe->user_data;
+      res = cqe->res;
+      flags = cqe->flags;
+      uring_cqe_seen(&reactor->ring);
+
+      switch (data & URING_TAG_MASK) {
+      case URING_ACCEPT:
+        uring_on_accept(reactor, res);
+        if (!(flags & IORING_CQE_F_MORE))
+          uring_arm_accept(reactor, listenfd);
+        break;
+      case URING_WAKE:
+        uring_arm_wake(reactor, &count);
+        uring_on_wake(reactor);
+        break;
+      case URING_RECV:
+        uring_on_recv(reactor, URING_CONN(data), res, flags);
+        break;
+      case URING_SEND:
+        uring_on_send(reactor, URING_CONN(data), res);
+        break;
+      default:
+        break;
+      }
+    }
+  }
+}
+
+void reactor_serve(reactor_t *reactor, int listenfd) {
+  int connfd;
+  struct sockaddr_storage clientaddr;
+  socklen_t clientlen = sizeof(struct sockaddr_storage);
+
+  if (reactor->backend == REACTOR_URING) {
+    reactor_uring_serve(reactor, listenfd);
+    return;
+  }
+
+  while (1) {
+    if ((connfd = accept(listenfd, (SA *)&clientaddr, &clientlen)) < 0) {
+      perror("accept");
+      continue;
+    }
+    reactor_add(reactor, connfd);
+  }
+}
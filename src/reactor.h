@@ -0,0 +1,202 @@
+#ifndef REACTOR_HEADER
+#define REACTOR_HEADER
+
+#include "network_utils.h"
+#include "scheduler.h"
+#include "uring.h"
+#include "wire.h"
+#include <pthread.h>
+
+/** An edge-triggered epoll reactor, used by the airport and controller servers
+ *  instead of one blocking worker per connection (selected with `-e`).
+ *
+ *  A few event-loop threads multiplex every client connection. Each connection
+ *  is owned by one loop, which reads whatever has arrived, splits it into
+ *  request lines, and hands the connection to the compute workers through a
+ *  work-stealing scheduler. A worker answers the connection's requests in
+ *  order, appends the responses to its output buffer and writes as much as
+ *  the socket takes; the owning loop flushes the rest once the socket becomes
+ *  writable again. The requests of a connection marked unordered (pipelined
+ *  frames, see `reactor_set_unordered`) are instead spread over several
+ *  workers, one request at a time.
+ *
+ *  A connection is closed once its client hangs up or sends an empty line, and
+ *  every request received before that has been answered and flushed.
+ *
+ *  With the io_uring backend (`-u`), a single ring thread takes the place of
+ *  the event loops. Connections are accepted with a multishot accept, their
+ *  data arrives through multishot receives into a registered ring of provided
+ *  buffers, and responses are sent from the ring too, so each `io_uring_enter`
+ *  call submits and reaps a whole batch of I/O at once.
+ */
+
+/* Number of event-loop threads. */
+#define REACTOR_LOOPS 2
+
+/* Maximum number of events handled per `epoll_wait` call. */
+#define REACTOR_EVENTS 64
+
+/* Capacity of the scheduler's queues of connections waiting for a compute
+ * worker. */
+#define REACTOR_QUEUE_SIZE 1024
+
+/* Submission entries, and provided receive buffers (count and size), of the
+ * io_uring backend. The buffer count must be a power of two. */
+#define REACTOR_URING_ENTRIES 256
+#define REACTOR_URING_BUFS 256
+#define REACTOR_URING_BUF_SIZE 4096
+
+/* How the reactor waits for I/O. */
+typedef enum {
+  REACTOR_EPOLL, /* Edge-triggered epoll event loops */
+  REACTOR_URING, /* A single io_uring ring thread */
+} reactor_backend_t;
+
+typedef struct reactor_t reactor_t;
+typedef struct reactor_conn_t reactor_conn_t;
+typedef struct reactor_line_t reactor_line_t;
+typedef struct reactor_loop_t reactor_loop_t;
+
+/** @brief Answers one request from `conn`, sending the response with
+ *         `reactor_send`. Called from the compute workers.
+ */
+typedef void (*reactor_handler_fn)(reactor_conn_t *conn, reactor_line_t *request);
+
+/** A complete request waiting to be answered: a text line, or a
+ *  `WIRE_REQUEST_SIZE` record once the client has sent `WIRE_HELLO`. */
+struct reactor_line_t {
+  reactor_line_t *next;
+  size_t len;
+  int binary;
+  /* NUL-terminated, including the trailing newline if any, with room for one
+   * more character in case the handler needs to add a missing newline. */
+  char buf[];
+};
+
+struct reactor_conn_t {
+  int fd;
+  reactor_loop_t *loop;    /* Event loop this connection is registered with */
+  pthread_mutex_t lock;    /* Protects everything below */
+  char in[MAXLINE];        /* Start of a request line still being received */
+  size_t in_len;
+  reactor_line_t *head, *tail; /* Request lines waiting for a worker */
+  pthread_mutex_t frame_lock; /* Keeps responses whole when unordered */
+  char *out;               /* Response bytes not yet written */
+  size_t out_len, out_cap;
+  uint64_t out_since;      /* When `out` last went from empty to non-empty */
+  int scheduled;           /* Workers it is queued for, or served by */
+  int unordered;           /* Requests may be answered in parallel */
+  int held;                /* Responses owed from outside the workers (see `reactor_hold`) */
+  int eof;                 /* No more requests will be read */
+  int failed;              /* The socket failed, so pending output is dropped */
+  int retiring;            /* Handed to the loop to be closed and freed */
+  int binary;              /* Switched to the binary protocol (see wire.h) */
+  size_t msg_max;          /* Largest single send (see `socket_message_max`) */
+  reactor_conn_t *next_retired;
+  /* io_uring backend only: a send in flight owns `wbuf`, while responses
+   * keep being appended to `out` for the next one. */
+  char *wbuf;
+  size_t wlen, woff, wcap;
+  int sending;             /* A send of `wbuf` is in flight */
+  int recv_armed;          /* The multishot receive has not terminated yet */
+  int cancelled;           /* The receive was asked to stop */
+  int flush_queued;        /* On the loop's `flush` list */
+  reactor_conn_t *next_flush;
+};
+
+struct reactor_loop_t {
+  reactor_t *reactor;
+  int epfd;
+  int wakefd;                 /* eventfd used to wake the loop */
+  pthread_mutex_t lock;       /* Protects `retired` and `flush` */
+  reactor_conn_t *retired;    /* Connections the loop must close and free */
+  reactor_conn_t *flush;      /* Connections with output to send (io_uring) */
+  pthread_t tid;
+};
+
+struct reactor_t {
+  reactor_backend_t backend;
+  reactor_handler_fn handler;
+  scheduler_t *queue;           /* Connections with requests to answer */
+  reactor_loop_t loops[REACTOR_LOOPS]; /* Only the first is used with io_uring */
+  unsigned next_loop;
+  uring_t ring;                 /* io_uring backend only */
+  uring_buf_ring_t bufs;
+};
+
+/** @brief Sets up `reactor` with the given backend, and starts its event-loop
+ *         threads if it has any. Requests will be handed to `handler` through
+ *         `queue`, whose workers must be threads running
+ *         `reactor_worker_routine`.
+ *
+ *  @returns 0 on success, -1 on failure (e.g. io_uring is not available), in
+ *           which case the caller should fall back to another server mode.
+ */
+int reactor_init(reactor_t *reactor, reactor_handler_fn handler, scheduler_t *queue,
+                 reactor_backend_t backend);
+
+/** @brief Accepts connections on `listenfd` and serves them. Never returns.
+ *
+ *         With epoll, the calling thread accepts connections and hands them to
+ *         the event loops with `reactor_add`. With io_uring, it becomes the
+ *         ring thread.
+ */
+void reactor_serve(reactor_t *reactor, int listenfd);
+
+/** @brief Hands a newly accepted connection to one of the event loops, which
+ *         takes ownership of `connfd` (epoll backend only).
+ *
+ *  @returns 0 on success, -1 if the connection could not be registered (in
+ *           which case it has been closed).
+ */
+int reactor_add(reactor_t *reactor, int connfd);
+
+/** @brief Queues `len` bytes of response on `conn`. While more requests of
+ *         `conn` are waiting to be answered, the output is held back (within
+ *         the `wio_t` size and delay limits, and unless `FLUSH_EACH_RESPONSE`
+ *         is set) so that their responses are written together. Otherwise,
+ *         with epoll, as much of it as the socket accepts is written straight
+ *         away; with io_uring, the ring thread is asked to send it. Must only
+ *         be called from the handler while it answers a request of `conn`,
+ *         and the handler must send a response to every request.
+ */
+void reactor_send(reactor_conn_t *conn, const char *buf, size_t len);
+
+/** @brief Sets up `out` so that responses can be generated into it, in place,
+ *         as on a connection of the threaded server. What is flushed from
+ *         `out` is passed to `reactor_send` on `conn`, so the handler must
+ *         flush it before returning.
+ */
+void reactor_output_init(wio_t *out, reactor_conn_t *conn);
+
+/** @brief Lets the workers answer the requests of `conn` in any order, several
+ *         at a time, for a connection whose responses say which request they
+ *         answer (pipelined frames). Then each worker that takes a request of
+ *         `conn` offers the connection to the others if more are waiting, so
+ *         idle workers steal them. The response to each request is still sent
+ *         whole. Must be called from the handler.
+ */
+void reactor_set_unordered(reactor_conn_t *conn);
+
+/** @brief Keeps `conn` open for a response to the request being answered that
+ *         will be sent later, from any thread, with `reactor_send_held`, so
+ *         that the handler can return without answering it. Only for
+ *         unordered connections, whose responses may come in any order. Must
+ *         be called from the handler.
+ */
+void reactor_hold(reactor_conn_t *conn);
+
+/** @brief Sends the whole `len`-byte response held back with `reactor_hold`,
+ *         between the responses of the workers, and releases the hold. Any
+ *         thread may call it, once per call to `reactor_hold`.
+ */
+void reactor_send_held(reactor_conn_t *conn, const char *buf, size_t len);
+
+/** @brief Thread routine of the compute workers, which take connections with
+ *         pending requests from the reactor's scheduler and answer them.
+ * @param arg The reactor
+ * @return NULL
+ */
+void *reactor_worker_routine(void *arg);
+
+#endif
@@ -0,0 +1,450 @@
+#define _GNU_SOURCE
+#include "scheduler.h"
+
+#include <errno.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/* The scheduler the calling thread works for, its index there, and the
+ * worker it last stole from. */
+static __thread scheduler_t *SCHED_SELF = NULL;
+static __thread int SCHED_INDEX = -1;
+static __thread int SCHED_VICTIM = 0;
+
+/* Whether the calling worker counts in its scheduler's `idle`. */
+static __thread int SCHED_IS_IDLE = 0;
+
+/* Times a worker that runs out of work yields before it goes to sleep. */
+#define SCHED_YIELDS 4
+
+/* Returns 0 once woken (or not asleep at all), or ETIMEDOUT. */
+static int futex_wait(uint32_t *word, uint32_t value, const struct timespec *timeout) {
+  if (syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, value, timeout, NULL, 0) < 0 &&
+      errno == ETIMEDOUT)
+    return ETIMEDOUT;
+  return 0;
+}
+
+static void futex_wake(uint32_t *word) {
+  syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+/* Owner only. Returns -1 if the deque is full. */
+static int deque_push(sched_deque_t *dq, void *item) {
+  int64_t b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED);
+  int64_t t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+  if (b - t >= SCHED_DEQUE_SIZE)
+    return -1;
+  __atomic_store_n(&dq->items[b & (SCHED_DEQUE_SIZE - 1)], item, __ATOMIC_RELAXED);
+  __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+/* Owner only: takes the newest item. Only the last item can be contended,
+ * and then the owner races the thieves for it on `top`. */
+static void *deque_pop(sched_deque_t *dq) {
+  int64_t b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED) - 1, t;
+  void *item = NULL;
+
+  // Thieves only ever move `top` up, so an empty deque stays empty without
+  // the fence
+  if (b < __atomic_load_n(&dq->top, __ATOMIC_RELAXED))
+    return NULL;
+  __atomic_store_n(&dq->bottom, b, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  t = __atomic_load_n(&dq->top, __ATOMIC_RELAXED);
+  if (t <= b) {
+    item = __atomic_load_n(&dq->items[b & (SCHED_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+    if (t == b) {
+      if (!__atomic_compare_exchange_n(&dq->top, &t, t + 1, 0, __ATOMIC_SEQ_CST,
+                                        __ATOMIC_RELAXED))
+        item = NULL;
+      __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+  } else {
+    __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+  }
+  return item;
+}
+
+/* Any thread: takes the oldest item, or NULL if there is none or another
+ * thread took it first. */
+static void *deque_steal(sched_deque_t *dq) {
+  int64_t t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE), b;
+  void *item;
+
+  // Most deques a thief looks at are empty: skip the fence for those
+  if (t >= __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED))
+    return NULL;
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  b = __atomic_load_n(&dq->bottom, __ATOMIC_ACQUIRE);
+  if (t >= b)
+    return NULL;
+  item = __atomic_load_n(&dq->items[t & (SCHED_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+  if (!__atomic_compare_exchange_n(&dq->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    return NULL;
+  return item;
+}
+
+/* Returns -1 if the inbox is full. */
+static int inbox_push(sched_inbox_t *in, void *item) {
+  uint64_t pos = __atomic_load_n(&in->enqueue, __ATOMIC_RELAXED), seq;
+  sched_cell_t *cell;
+
+  while (1) {
+    cell = &in->cells[pos & in->mask];
+    seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    if (seq == pos) {
+      if (__atomic_compare_exchange_n(&in->enqueue, &pos, pos + 1, 1, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED))
+        break;
+    } else if ((int64_t)(seq - pos) < 0) {
+      return -1;
+    } else {
+      pos = __atomic_load_n(&in->enqueue, __ATOMIC_RELAXED);
+    }
+  }
+  cell->item = item;
+  __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+/* Returns NULL if the inbox is empty. */
+static void *inbox_pop(sched_inbox_t *in) {
+  uint64_t pos = __atomic_load_n(&in->dequeue, __ATOMIC_RELAXED), seq;
+  sched_cell_t *cell;
+  void *item;
+
+  while (1) {
+    cell = &in->cells[pos & in->mask];
+    seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    if (seq == pos + 1) {
+      if (__atomic_compare_exchange_n(&in->dequeue, &pos, pos + 1, 1, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED))
+        break;
+    } else if ((int64_t)(seq - (pos + 1)) < 0) {
+      return NULL;
+    } else {
+      pos = __atomic_load_n(&in->dequeue, __ATOMIC_RELAXED);
+    }
+  }
+  item = cell->item;
+  __atomic_store_n(&cell->seq, pos + in->mask + 1, __ATOMIC_RELEASE);
+  return item;
+}
+
+int scheduler_init(scheduler_t *sched, int num_workers, int capacity) {
+  size_t inbox_size = 2;
+
+  // Split the capacity between the inboxes, rounded up to a power of two
+  while (inbox_size * (size_t)num_workers < (size_t)capacity)
+    inbox_size *= 2;
+  sched->num_workers = num_workers;
+  sched->min_workers = num_workers;
+  sched->active = 0;
+  sched->idle = 0;
+  sched->growing = 0;
+  sched->routine = NULL;
+  sched->arg = NULL;
+  sched->next_inbox = 0;
+  sched->sleepers = 0;
+  if ((sched->workers = calloc((size_t)num_workers, sizeof(sched_worker_t))) == NULL)
+    return -1;
+  for (int i = 0; i < num_workers; i++) {
+    sched_inbox_t *in = &sched->workers[i].inbox;
+    in->mask = inbox_size - 1;
+    if ((in->cells = calloc(inbox_size, sizeof(sched_cell_t))) == NULL) {
+      scheduler_deinit(sched);
+      return -1;
+    }
+    for (size_t c = 0; c < inbox_size; c++)
+      in->cells[c].seq = c;
+  }
+  return 0;
+}
+
+void scheduler_deinit(scheduler_t *sched) {
+  for (int i = 0; sched->workers && i < sched->num_workers; i++)
+    free(sched->workers[i].inbox.cells);
+  free(sched->workers);
+  sched->workers = NULL;
+}
+
+/* Starting point of the workers the scheduler starts itself. */
+static void *scheduler_worker_main(void *arg) {
+  scheduler_t *sched = arg;
+
+  // Counted as idle by `scheduler_spawn` until it takes its first item
+  SCHED_IS_IDLE = 1;
+  __atomic_store_n(&sched->growing, 0, __ATOMIC_SEQ_CST);
+  return sched->routine(sched->arg);
+}
+
+/* Starts one more worker, counted as active and idle from now on so that
+ * submissions count on it. Returns -1 if the thread could not be created. */
+static int scheduler_spawn(scheduler_t *sched) {
+  pthread_t tid;
+
+  __atomic_add_fetch(&sched->active, 1, __ATOMIC_SEQ_CST);
+  __atomic_add_fetch(&sched->idle, 1, __ATOMIC_SEQ_CST);
+  if (pthread_create(&tid, NULL, scheduler_worker_main, sched) != 0) {
+    __atomic_sub_fetch(&sched->idle, 1, __ATOMIC_SEQ_CST);
+    __atomic_sub_fetch(&sched->active, 1, __ATOMIC_SEQ_CST);
+    return -1;
+  }
+  return 0;
+}
+
+/* Starts one more worker for work that would otherwise wait, unless the pool
+ * is full or another is already starting: workers are added one at a time,
+ * each starting the next if work is still left once it is busy. */
+static void scheduler_grow(scheduler_t *sched) {
+  int growing = 0;
+
+  if (sched->routine == NULL ||
+      __atomic_load_n(&sched->active, __ATOMIC_RELAXED) >= sched->num_workers ||
+      !__atomic_compare_exchange_n(&sched->growing, &growing, 1, 0, __ATOMIC_SEQ_CST,
+                                   __ATOMIC_RELAXED))
+    return;
+  if (scheduler_spawn(sched) < 0)
+    __atomic_store_n(&sched->growing, 0, __ATOMIC_SEQ_CST);
+}
+
+/* Whether any deque or inbox has an item in it. */
+static int scheduler_has_work(scheduler_t *sched) {
+  for (int i = 0; i < sched->num_workers; i++) {
+    sched_worker_t *w = &sched->workers[i];
+    if (__atomic_load_n(&w->deque.top, __ATOMIC_RELAXED) <
+            __atomic_load_n(&w->deque.bottom, __ATOMIC_RELAXED) ||
+        __atomic_load_n(&w->inbox.dequeue, __ATOMIC_RELAXED) !=
+            __atomic_load_n(&w->inbox.enqueue, __ATOMIC_RELAXED))
+      return 1;
+  }
+  return 0;
+}
+
+int scheduler_start(scheduler_t *sched, int min_workers, void *(*routine)(void *), void *arg) {
+  sched->min_workers = (min_workers < sched->num_workers) ? min_workers : sched->num_workers;
+  sched->routine = routine;
+  sched->arg = arg;
+  for (int i = 0; i < sched->min_workers; i++) {
+    if (scheduler_spawn(sched) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+/* Wakes a sleeping worker that no other submission has woken yet, if there
+ * is one, so that a burst of submissions makes one system call per sleeper
+ * rather than one each. The fence orders the item just published before the
+ * check of `sleepers`, against a worker that counts itself in `sleepers`
+ * before looking for work one last time. */
+static void scheduler_wake(scheduler_t *sched) {
+  uint32_t state;
+
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&sched->sleepers, __ATOMIC_SEQ_CST) == 0) {
+    // Every worker is busy, so the item waits unless there is one more
+    if (__atomic_load_n(&sched->idle, __ATOMIC_SEQ_CST) == 0)
+      scheduler_grow(sched);
+    return;
+  }
+  for (int i = 0; i < sched->num_workers; i++) {
+    state = SCHED_SLEEPING;
+    if (__atomic_load_n(&sched->workers[i].state, __ATOMIC_RELAXED) == SCHED_SLEEPING &&
+        __atomic_compare_exchange_n(&sched->workers[i].state, &state, SCHED_NOTIFIED, 0,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+      // The worker no longer counts as asleep or idle: it is bound for this
+      // item, and later submissions must not count on it
+      __atomic_sub_fetch(&sched->sleepers, 1, __ATOMIC_SEQ_CST);
+      __atomic_sub_fetch(&sched->idle, 1, __ATOMIC_SEQ_CST);
+      futex_wake(&sched->workers[i].state);
+      return;
+    }
+  }
+}
+
+void scheduler_submit(scheduler_t *sched, void *item) {
+  int n = sched->num_workers, active = __atomic_load_n(&sched->active, __ATOMIC_RELAXED);
+  unsigned first;
+
+  // A worker keeps what it submits close at hand, for itself or a thief
+  if (SCHED_SELF == sched && (deque_push(&sched->workers[SCHED_INDEX].deque, item) == 0 ||
+                              inbox_push(&sched->workers[SCHED_INDEX].inbox, item) == 0)) {
+    scheduler_wake(sched);
+    return;
+  }
+
+  // Spread other submissions over the inboxes, starting with those of the
+  // workers running (which claim the first free ones), skipping full ones,
+  // and back off while all of them are full
+  first = __atomic_fetch_add(&sched->next_inbox, 1, __ATOMIC_RELAXED);
+  if (active > 0 && active < n)
+    first %= (unsigned)active;
+  for (int i = 0;; i++) {
+    if (inbox_push(&sched->workers[(first + (unsigned)i) % (unsigned)n].inbox, item) == 0)
+      break;
+    if (i % n == n - 1)
+      sched_yield();
+  }
+  scheduler_wake(sched);
+}
+
+/* Looks for an item: the worker's own deque and inbox, then the others'. */
+static void *scheduler_find(scheduler_t *sched, int self) {
+  sched_worker_t *victim;
+  void *item;
+
+  if ((item = deque_pop(&sched->workers[self].deque)) != NULL ||
+      (item = inbox_pop(&sched->workers[self].inbox)) != NULL)
+    return item;
+  // Start with the last victim, which likely has more
+  for (int i = 0; i < sched->num_workers; i++) {
+    int v = (SCHED_VICTIM + i) % sched->num_workers;
+    if (v == self)
+      continue;
+    victim = &sched->workers[v];
+    if ((item = deque_steal(&victim->deque)) != NULL ||
+        (item = inbox_pop(&victim->inbox)) != NULL) {
+      SCHED_VICTIM = v;
+      return item;
+    }
+  }
+  return NULL;
+}
+
+/* Makes the calling thread one of the scheduler's workers, in the first free
+ * slot. */
+static void scheduler_register(scheduler_t *sched) {
+  int claimed;
+
+  for (int i = 0; i < sched->num_workers; i++) {
+    claimed = 0;
+    if (__atomic_compare_exchange_n(&sched->workers[i].claimed, &claimed, 1, 0, __ATOMIC_SEQ_CST,
+                                    __ATOMIC_RELAXED)) {
+      SCHED_SELF = sched;
+      SCHED_INDEX = i;
+      return;
+    }
+  }
+  fprintf(stderr, "scheduler_take: more than %d workers\n", sched->num_workers);
+  abort();
+}
+
+/* Marks the calling worker busy with an item it has just taken. The last
+ * idle worker to become busy starts another if work is still waiting, which
+ * no submission would otherwise do while it counted on this one. */
+static void *scheduler_took(scheduler_t *sched, void *item) {
+  if (SCHED_IS_IDLE) {
+    SCHED_IS_IDLE = 0;
+    if (__atomic_sub_fetch(&sched->idle, 1, __ATOMIC_SEQ_CST) == 0 && scheduler_has_work(sched))
+      scheduler_grow(sched);
+  }
+  return item;
+}
+
+/* Leaves the scheduler after `SCHED_IDLE_MS` asleep, if it started the
+ * worker and has more than `min_workers`. The worker's deque is empty, and
+ * thieves still look in its inbox until another worker claims the slot. */
+static int scheduler_retire(scheduler_t *sched) {
+  int active = __atomic_load_n(&sched->active, __ATOMIC_RELAXED);
+
+  do {
+    if (sched->routine == NULL || active <= sched->min_workers)
+      return 0;
+  } while (!__atomic_compare_exchange_n(&sched->active, &active, active - 1, 1, __ATOMIC_SEQ_CST,
+                                        __ATOMIC_RELAXED));
+  SCHED_IS_IDLE = 0;
+  __atomic_store_n(&sched->workers[SCHED_INDEX].claimed, 0, __ATOMIC_SEQ_CST);
+  SCHED_SELF = NULL;
+  SCHED_INDEX = -1;
+
+  // A submission may have counted on us just now
+  if (__atomic_sub_fetch(&sched->idle, 1, __ATOMIC_SEQ_CST) == 0 && scheduler_has_work(sched))
+    scheduler_grow(sched);
+  return 1;
+}
+
+void *scheduler_take(scheduler_t *sched) {
+  struct timespec timeout = {SCHED_IDLE_MS / 1000, (SCHED_IDLE_MS % 1000) * 1000000L};
+  sched_worker_t *self;
+  uint32_t state;
+  int timed_out;
+  void *item;
+
+  if (SCHED_SELF != sched)
+    scheduler_register(sched);
+  self = &sched->workers[SCHED_INDEX];
+
+  while (1) {
+    // Before going to sleep, give the threads submitting work a chance to
+    // run a few times, so that one at a time they do not each wake a worker
+    for (int i = 0; i <= SCHED_YIELDS; i++) {
+      if ((item = scheduler_find(sched, SCHED_INDEX)) != NULL)
+        return scheduler_took(sched, item);
+      if (!SCHED_IS_IDLE) {
+        SCHED_IS_IDLE = 1;
+        __atomic_add_fetch(&sched->idle, 1, __ATOMIC_SEQ_CST);
+      }
+      sched_yield();
+    }
+
+    // Count ourselves as asleep before looking one last time, so that a
+    // submission either is found here or sees us and notifies us
+    __atomic_add_fetch(&sched->sleepers, 1, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&self->state, SCHED_SLEEPING, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    timed_out = 0;
+    if ((item = scheduler_find(sched, SCHED_INDEX)) == NULL) {
+      // A worker the scheduler started gives up after a while asleep
+      while (!timed_out && __atomic_load_n(&self->state, __ATOMIC_ACQUIRE) == SCHED_SLEEPING)
+        timed_out = futex_wait(&self->state, SCHED_SLEEPING, sched->routine ? &timeout : NULL);
+    }
+    // Stop counting ourselves as asleep, unless a submission that notified
+    // us (and stopped counting us as idle) already did
+    state = SCHED_SLEEPING;
+    if (__atomic_compare_exchange_n(&self->state, &state, SCHED_AWAKE, 0, __ATOMIC_SEQ_CST,
+                                    __ATOMIC_RELAXED)) {
+      __atomic_sub_fetch(&sched->sleepers, 1, __ATOMIC_SEQ_CST);
+      if (timed_out && scheduler_retire(sched))
+        return NULL;
+    } else {
+      __atomic_store_n(&self->state, SCHED_AWAKE, __ATOMIC_RELAXED);
+      SCHED_IS_IDLE = 0;
+    }
+    if (item != NULL)
+      return scheduler_took(sched, item);
+  }
+}
+
+int scheduler_pin_share(int idx, int count) {
+  cpu_set_t allowed, cpus;
+  size_t ids[CPU_SETSIZE];
+  int num_allowed = 0, share;
+
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0)
+    return -1;
+  for (size_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &allowed))
+      ids[num_allowed++] = cpu;
+  }
+  if ((share = num_allowed / count) < 1)
+    share = 1;
+  CPU_ZERO(&cpus);
+  for (int i = 0; i < share; i++)
+    CPU_SET(ids[(idx * share + i) % num_allowed], &cpus);
+  return sched_setaffinity(0, sizeof(cpus), &cpus);
+}
+
+/* Descriptors are stored plus one, as NULL means no item. */
+void scheduler_submit_fd(scheduler_t *sched, int connfd) {
+  scheduler_submit(sched, (void *)((intptr_t)connfd + 1));
+}
+
+int scheduler_take_fd(scheduler_t *sched) { return (int)((intptr_t)scheduler_take(sched) - 1); }
@@ -0,0 +1,154 @@
+#ifndef SCHEDULER_HEADER
+#define SCHEDULER_HEADER
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** A work-stealing scheduler that hands work items (connections, connections
+ *  with requests waiting, or single requests) to a pool of worker threads,
+ *  in place of one queue behind one mutex. The pool can be left to the
+ *  scheduler, which grows and shrinks it with the demand (see
+ *  `scheduler_start`).
+ *
+ *  Each worker owns a Chase-Lev deque: items that a worker submits itself
+ *  (e.g. requests split off a connection it is serving) are pushed onto the
+ *  bottom of its own deque and popped from there in LIFO order, without a
+ *  single atomic read-modify-write. Items submitted from any other thread (an
+ *  acceptor, an event loop) go to the workers' inboxes in turn: bounded
+ *  lock-free queues that many threads can push to. A worker that runs out of
+ *  work steals from the top of the other workers' deques, and from their
+ *  inboxes, before it goes to sleep on a futex.
+ *
+ *  Submitting makes a system call only to wake a sleeping worker (or start a
+ *  new one), and a worker only sleeps once there was nothing left to steal.
+ */
+
+/* Capacity of each worker's deque. Must be a power of two. */
+#define SCHED_DEQUE_SIZE 1024
+
+/* How long a worker started by `scheduler_start` sleeps without work before
+ * it exits, down to the scheduler's minimum. */
+#define SCHED_IDLE_MS 2000
+
+/** Chase-Lev deque of one worker. `top` is where thieves take from and
+ *  `bottom` where the owner pushes and pops; each on its own cache line. */
+typedef struct sched_deque_t sched_deque_t;
+
+struct sched_deque_t {
+  int64_t top;
+  char pad1[56];
+  int64_t bottom;
+  char pad2[56];
+  void *items[SCHED_DEQUE_SIZE];
+};
+
+/** Bounded multi-producer multi-consumer queue, with a sequence number in
+ *  each cell saying whether it is ready to be written or read. */
+typedef struct sched_cell_t sched_cell_t;
+
+struct sched_cell_t {
+  uint64_t seq;
+  void *item;
+};
+
+typedef struct sched_inbox_t sched_inbox_t;
+
+struct sched_inbox_t {
+  uint64_t enqueue;
+  char pad1[56];
+  uint64_t dequeue;
+  char pad2[56];
+  size_t mask;
+  sched_cell_t *cells;
+};
+
+typedef struct sched_worker_t sched_worker_t;
+
+/* States of a worker, whose futex word it sleeps on */
+#define SCHED_AWAKE 0
+#define SCHED_SLEEPING 1
+#define SCHED_NOTIFIED 2 /* Asleep, and already woken by a submission */
+
+struct sched_worker_t {
+  sched_deque_t deque;
+  sched_inbox_t inbox;
+  uint32_t state;
+  int claimed; /* A thread works in this slot */
+};
+
+typedef struct scheduler_t scheduler_t;
+
+struct scheduler_t {
+  int num_workers;     /* Worker slots: the most workers at once */
+  int min_workers;     /* Workers kept however long they are idle */
+  int active;          /* Workers started by `scheduler_start`, or growing */
+  int idle;            /* Workers looking for work, and not bound for an item */
+  int growing;         /* A worker has been started and is not running yet */
+  unsigned next_inbox; /* Inbox the next outside submission goes to */
+  int sleepers;        /* Workers asleep (or about to be) and not notified */
+  void *(*routine)(void *); /* What started workers run, or NULL */
+  void *arg;
+  sched_worker_t *workers;
+};
+
+/** @brief Sets up a scheduler for `num_workers` workers, whose inboxes hold
+ *         `capacity` items between them. The workers are threads that call
+ *         `scheduler_take`, each becoming one of the scheduler's workers the
+ *         first time it does.
+ *
+ *  @returns 0 on success, -1 if the scheduler could not be allocated.
+ */
+int scheduler_init(scheduler_t *sched, int num_workers, int capacity);
+
+/** @brief Starts `min_workers` threads running `routine(arg)`, which must call
+ *         `scheduler_take` in a loop, and return once it returns NULL (or -1
+ *         from `scheduler_take_fd`).
+ *
+ *  The pool then follows the demand. Whenever an item is submitted while
+ *  every worker is busy, so that it would wait, one more worker is started,
+ *  up to `num_workers`. A worker that sleeps for `SCHED_IDLE_MS` without any
+ *  work exits, down to `min_workers`.
+ *
+ *  @returns 0 on success, -1 if a thread could not be created.
+ */
+int scheduler_start(scheduler_t *sched, int min_workers, void *(*routine)(void *), void *arg);
+
+/** @brief Releases the scheduler's memory. No thread may use it any more. */
+void scheduler_deinit(scheduler_t *sched);
+
+/** @brief Submits a work item. From one of the scheduler's own workers, the
+ *         item goes onto its deque (or its inbox, if the deque is full);
+ *         from any other thread, into the next worker's inbox, waiting while
+ *         every inbox is full. Wakes up a sleeping worker, if any.
+ */
+void scheduler_submit(scheduler_t *sched, void *item);
+
+/** @brief Takes the next work item for the calling worker: from its own deque
+ *         first, then its inbox, then from the other workers. Sleeps until an
+ *         item is submitted if there is none.
+ *
+ *  @returns The item, or NULL if the worker was started by `scheduler_start`
+ *           and has been idle long enough to exit.
+ *
+ *  @note  Each thread may only be a worker of one scheduler, and no more than
+ *         `num_workers` threads may call this.
+ */
+void *scheduler_take(scheduler_t *sched);
+
+/** @brief Pins the calling process, and the threads it starts from then on,
+ *         to the `idx`th of `count` shares of the CPUs it may run on: blocks
+ *         of consecutive CPUs, wrapping around if there are more shares than
+ *         CPUs.
+ *
+ *  @returns 0 on success, -1 (with errno set) on failure.
+ */
+int scheduler_pin_share(int idx, int count);
+
+/** @brief Submits the connection `connfd` as a work item. */
+void scheduler_submit_fd(scheduler_t *sched, int connfd);
+
+/** @brief Takes a connection submitted with `scheduler_submit_fd`, or returns
+ *         -1 where `scheduler_take` returns NULL. */
+int scheduler_take_fd(scheduler_t *sched);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef SEQLOCK_HEADER
+#define SEQLOCK_HEADER
+
+#include <pthread.h>
+#include <sched.h>
+
+/** A sequence lock lets readers take consistent snapshots of data that is
+ *  written rarely, without ever taking a lock or writing to shared memory.
+ *
+ *  Writers serialise on `lock` and bump `seq` to an odd value before modifying
+ *  the protected data, then back to an even value once done. Readers record
+ *  `seq` before reading, and retry if it was odd or has changed by the time
+ *  they finish. Protected data must be accessed with relaxed `__atomic` loads
+ *  and stores, since readers may race with a writer.
+ *
+ *  Reader usage:
+ *
+ *      unsigned seq;
+ *      do {
+ *        seq = seqlock_read_begin(&sl);
+ *        ... read protected data ...
+ *      } while (seqlock_read_retry(&sl, seq));
+ */
+typedef struct seqlock_t seqlock_t;
+
+struct seqlock_t {
+  unsigned seq;
+  pthread_mutex_t lock;
+};
+
+static inline void seqlock_init(seqlock_t *sl) {
+  sl->seq = 0;
+  pthread_mutex_init(&sl->lock, NULL);
+}
+
+static inline void seqlock_destroy(seqlock_t *sl) { pthread_mutex_destroy(&sl->lock); }
+
+static inline void seqlock_write_begin(seqlock_t *sl) {
+  pthread_mutex_lock(&sl->lock);
+  __atomic_store_n(&sl->seq, sl->seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void seqlock_write_end(seqlock_t *sl) {
+  __atomic_store_n(&sl->seq, sl->seq + 1, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&sl->lock);
+}
+
+static inline unsigned seqlock_read_begin(seqlock_t *sl) {
+  unsigned seq;
+  // An odd sequence number means a writer is part-way through an update
+  while ((seq = __atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE)) & 1)
+    sched_yield();
+  return seq;
+}
+
+static inline int seqlock_read_retry(seqlock_t *sl, unsigned seq) {
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&sl->seq, __ATOMIC_RELAXED) != seq;
+}
+
+#endif
@@ -0,0 +1,151 @@
+#include "shm_link.h"
+
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+
+/* How long to sleep on a futex before checking that the peer is alive. */
+#define SHM_WAIT_SEC 1
+
+/* Not the _PRIVATE futex operations: the words are shared between processes.
+ * Returns 1 if the wait timed out. */
+static int futex_wait(uint32_t *word, uint32_t value) {
+  struct timespec timeout = {SHM_WAIT_SEC, 0};
+  return syscall(SYS_futex, word, FUTEX_WAIT, value, &timeout, NULL, 0) < 0 && errno == ETIMEDOUT;
+}
+
+static void futex_wake(uint32_t *word) { syscall(SYS_futex, word, FUTEX_WAKE, 1, NULL, NULL, 0); }
+
+/* Whether the process `pid` (0 until it has attached) can still be waited on. */
+static int peer_alive(int pid) { return pid == 0 || kill(pid, 0) == 0 || errno != ESRCH; }
+
+/* Sleeps until `*index` moves away from `stale`, or the futex wait times out
+ * (returning 1). The waiting flag is set before the futex word is sampled
+ * and `*index` checked again, so a peer that publishes concurrently either
+ * is seen here, or sees the flag and wakes us up; all with sequentially
+ * consistent ordering to match the peer's store, bump and flag check. */
+static int ring_wait(uint32_t *index, uint32_t stale, uint32_t *seq, uint32_t *waiting) {
+  int timed_out = 0;
+  __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+  uint32_t value = __atomic_load_n(seq, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(index, __ATOMIC_SEQ_CST) == stale)
+    timed_out = futex_wait(seq, value);
+  __atomic_store_n(waiting, 0, __ATOMIC_SEQ_CST);
+  return timed_out;
+}
+
+/* Publishes a new `*index`, waking the peer if it went to sleep. */
+static void ring_publish(uint32_t *index, uint32_t value, uint32_t *seq, uint32_t *waiting) {
+  __atomic_store_n(index, value, __ATOMIC_SEQ_CST);
+  __atomic_add_fetch(seq, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST))
+    futex_wake(seq);
+}
+
+shm_link_t *shm_links_create(int num_links) {
+  size_t size = (size_t)num_links * sizeof(shm_link_t);
+  shm_link_t *links = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+  if (links == MAP_FAILED) {
+    perror("shm_links_create");
+    return NULL;
+  }
+  // The mapping starts zeroed, so only the controller's side needs filling in
+  for (int i = 0; i < num_links; i++) {
+    for (int c = 0; c < SHM_LINK_CHANNELS; c++) {
+      links[i].channels[c].requests.producer = getpid();
+      links[i].channels[c].responses.consumer = getpid();
+    }
+  }
+  return links;
+}
+
+void shm_link_attach(shm_link_t *link) {
+  for (int c = 0; c < SHM_LINK_CHANNELS; c++) {
+    link->channels[c].requests.consumer = getpid();
+    link->channels[c].responses.producer = getpid();
+  }
+}
+
+ssize_t shm_ring_read(void *arg, void *buf, size_t n) {
+  shm_ring_t *ring = arg;
+  uint32_t head = ring->head, tail, offset;
+  size_t avail, first;
+
+  // Only the consumer moves `head`, so it needs no atomic load
+  while ((tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) == head) {
+    if (ring_wait(&ring->tail, head, &ring->data_seq, &ring->reader_waiting) &&
+        !peer_alive(ring->producer))
+      return 0;
+  }
+
+  // Copy out what is there, in two parts if it wraps around
+  avail = tail - head;
+  if (n > avail)
+    n = avail;
+  offset = head & (SHM_RING_SIZE - 1);
+  first = (n < SHM_RING_SIZE - offset) ? n : SHM_RING_SIZE - offset;
+  memcpy(buf, ring->data + offset, first);
+  memcpy((char *)buf + first, ring->data, n - first);
+  ring_publish(&ring->head, head + (uint32_t)n, &ring->space_seq, &ring->writer_waiting);
+  return (ssize_t)n;
+}
+
+ssize_t shm_ring_write(void *arg, const void *buf, size_t n) {
+  shm_ring_t *ring = arg;
+  const char *p = buf;
+  size_t left = n, room, chunk, first;
+  uint32_t tail = ring->tail, head, offset;
+
+  while (left > 0) {
+    // Only the producer moves `tail`, so it needs no atomic load
+    while ((head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) + SHM_RING_SIZE == tail) {
+      if (ring_wait(&ring->head, head, &ring->space_seq, &ring->writer_waiting) &&
+          !peer_alive(ring->consumer))
+        return -1;
+    }
+
+    room = SHM_RING_SIZE - (tail - head);
+    chunk = (left < room) ? left : room;
+    offset = tail & (SHM_RING_SIZE - 1);
+    first = (chunk < SHM_RING_SIZE - offset) ? chunk : SHM_RING_SIZE - offset;
+    memcpy(ring->data + offset, p, first);
+    memcpy(ring->data, p + first, chunk - first);
+    tail += (uint32_t)chunk;
+    ring_publish(&ring->tail, tail, &ring->data_seq, &ring->reader_waiting);
+    p += chunk;
+    left -= chunk;
+  }
+  return (ssize_t)n;
+}
+
+void shm_endpoint_init(shm_endpoint_t *ep, shm_link_t *link) {
+  pthread_mutex_init(&ep->lock, NULL);
+  pthread_cond_init(&ep->available, NULL);
+  ep->link = link;
+  ep->failed = 0;
+  ep->num_idle = SHM_LINK_CHANNELS;
+  for (int c = 0; c < SHM_LINK_CHANNELS; c++) {
+    ep->idle[c] = c;
+    rio_readinit_source(&ep->rio[c], shm_ring_read, &link->channels[c].responses);
+  }
+}
+
+int shm_endpoint_acquire(shm_endpoint_t *ep) {
+  int idx;
+  pthread_mutex_lock(&ep->lock);
+  while (ep->num_idle == 0)
+    pthread_cond_wait(&ep->available, &ep->lock);
+  idx = ep->idle[--ep->num_idle];
+  pthread_mutex_unlock(&ep->lock);
+  return idx;
+}
+
+void shm_endpoint_release(shm_endpoint_t *ep, int idx) {
+  pthread_mutex_lock(&ep->lock);
+  ep->idle[ep->num_idle++] = idx;
+  pthread_cond_signal(&ep->available);
+  pthread_mutex_unlock(&ep->lock);
+}
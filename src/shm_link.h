@@ -0,0 +1,116 @@
+#ifndef SHM_LINK_HEADER
+#define SHM_LINK_HEADER
+
+#include "network_utils.h"
+#include <pthread.h>
+
+/** Same-host transport between the controller and its forked airport nodes
+ *  (`-t shm`), in place of loopback TCP.
+ *
+ *  Each airport gets a link in memory shared with the controller, mapped
+ *  before the airports are forked. A link has `SHM_LINK_CHANNELS` channels,
+ *  each a pair of lock-free single-producer single-consumer byte rings: one
+ *  for requests and one for responses. A channel carries the same text
+ *  protocol as a pooled TCP connection (request lines, responses ended by
+ *  `RESPONSE_END`). The controller's workers take turns on the channels, and
+ *  one airport thread serves each channel for good.
+ *
+ *  Moving data is a `memcpy` into the ring and an atomic store of its index.
+ *  A side only makes a system call (a futex wait or wake) to sleep when the
+ *  ring is empty (or full), or to wake a peer that went to sleep. A peer
+ *  that dies is noticed while waiting for it, and reads as end of file.
+ */
+
+/* Ring capacity in bytes. Must be a power of two. */
+#define SHM_RING_SIZE 32768
+
+/* Channels per link, each served by an airport thread of its own. */
+#define SHM_LINK_CHANNELS 8
+
+typedef struct shm_ring_t shm_ring_t;
+
+struct shm_ring_t {
+  /* Consumer side: the next byte to read, and the futex word it sleeps on
+   * while the ring is empty (bumped by the producer after publishing) */
+  uint32_t head;
+  uint32_t data_seq;
+  uint32_t reader_waiting;
+  int producer; /* PID of the producer, checked while waiting for it */
+  char pad1[48];
+  /* Producer side: the next byte to write, and the futex word it sleeps on
+   * while the ring is full (bumped by the consumer after reading) */
+  uint32_t tail;
+  uint32_t space_seq;
+  uint32_t writer_waiting;
+  int consumer; /* PID of the consumer, checked while waiting for it */
+  char pad2[48];
+  char data[SHM_RING_SIZE];
+};
+
+typedef struct shm_channel_t shm_channel_t;
+
+struct shm_channel_t {
+  shm_ring_t requests;  /* Controller to airport */
+  shm_ring_t responses; /* Airport to controller */
+};
+
+typedef struct shm_link_t shm_link_t;
+
+struct shm_link_t {
+  shm_channel_t channels[SHM_LINK_CHANNELS];
+};
+
+/** The controller's end of a link, in its private memory: hands each channel
+ *  to one worker at a time, along with the reader of its responses. */
+typedef struct shm_endpoint_t shm_endpoint_t;
+
+struct shm_endpoint_t {
+  pthread_mutex_t lock;
+  pthread_cond_t available; /* Signalled when a channel is released */
+  shm_link_t *link;
+  int failed; /* Set once the airport has been found dead */
+  int num_idle;
+  int idle[SHM_LINK_CHANNELS];  /* Stack of idle channel indices */
+  rio_t rio[SHM_LINK_CHANNELS]; /* Reader of each channel's responses */
+};
+
+/** @brief Maps `num_links` links in anonymous shared memory, so that they are
+ *         shared with the processes forked afterwards. The caller (the
+ *         controller) becomes the producer of every request ring.
+ *
+ *  @returns The links, or `NULL` if the memory could not be mapped.
+ */
+shm_link_t *shm_links_create(int num_links);
+
+/** @brief Called by the airport process that serves `link`, before any
+ *         request is sent, to become the producer of its response rings.
+ */
+void shm_link_attach(shm_link_t *link);
+
+/** @brief Reads up to `n` bytes from a ring, blocking until at least one is
+ *         available. A `rio_source_fn`.
+ *
+ *  @returns The number of bytes read, or 0 if the producer has died.
+ */
+ssize_t shm_ring_read(void *ring, void *buf, size_t n);
+
+/** @brief Writes `n` bytes to a ring, blocking while it is full. A
+ *         `wio_sink_fn`.
+ *
+ *  @returns `n`, or -1 if the consumer has died.
+ */
+ssize_t shm_ring_write(void *ring, const void *buf, size_t n);
+
+/** @brief Sets up the controller's end of `link`. */
+void shm_endpoint_init(shm_endpoint_t *ep, shm_link_t *link);
+
+/** @brief Takes an idle channel, blocking while all of them are in use.
+ *
+ *  @returns The channel's index.
+ */
+int shm_endpoint_acquire(shm_endpoint_t *ep);
+
+/** @brief Returns a channel taken with `shm_endpoint_acquire`. */
+void shm_endpoint_release(shm_endpoint_t *ep, int idx);
+
+#endif
@@ -0,0 +1,191 @@
+#include "status_cache.h"
+
+#include <sys/mman.h>
+
+static size_t status_hash(const wire_request_t *req) {
+  uint64_t h = req->type;
+  // Fibonacci hashing of each argument in turn
+  for (int i = 0; i < 5; i++)
+    h = (h ^ (uint32_t)req->args[i]) * 0x9E3779B97F4A7C15ull;
+  return (size_t)(h >> 32);
+}
+
+static int same_request(const wire_request_t *a, const wire_request_t *b) {
+  return a->type == b->type && memcmp(a->args, b->args, sizeof(a->args)) == 0;
+}
+
+status_cache_t *create_status_cache(size_t capacity) {
+  status_cache_t *cache = calloc(1, sizeof(status_cache_t));
+  // About one bucket per small entry
+  size_t num_buckets = 64, expected = capacity / 128;
+  if (cache == NULL)
+    return NULL;
+  while (num_buckets < expected)
+    num_buckets <<= 1;
+  cache->mask = num_buckets - 1;
+  cache->stripe_bytes = capacity / STATUS_CACHE_STRIPES;
+  cache->buckets = calloc(num_buckets, sizeof(status_entry_t *));
+  if (cache->buckets == NULL) {
+    free(cache);
+    return NULL;
+  }
+  for (int i = 0; i < STATUS_CACHE_STRIPES; i++)
+    pthread_mutex_init(&cache->stripes[i].lock, NULL);
+  return cache;
+}
+
+void destroy_status_cache(status_cache_t *cache) {
+  status_entry_t *entry, *next;
+  if (cache == NULL)
+    return;
+  for (size_t i = 0; i <= cache->mask; i++) {
+    for (entry = cache->buckets[i]; entry; entry = next) {
+      next = entry->next;
+      free(entry);
+    }
+  }
+  for (int i = 0; i < STATUS_CACHE_STRIPES; i++)
+    pthread_mutex_destroy(&cache->stripes[i].lock);
+  free(cache->buckets);
+  free(cache);
+}
+
+/** Takes `entry` out of its stripe's order of use. */
+static void unlink_entry(status_stripe_t *stripe, status_entry_t *entry) {
+  if (entry->newer)
+    entry->newer->older = entry->older;
+  else
+    stripe->newest = entry->older;
+  if (entry->older)
+    entry->older->newer = entry->newer;
+  else
+    stripe->oldest = entry->newer;
+}
+
+/** Makes `entry` the most recently used of its stripe. */
+static void link_newest(status_stripe_t *stripe, status_entry_t *entry) {
+  entry->newer = NULL;
+  entry->older = stripe->newest;
+  if (stripe->newest)
+    stripe->newest->newer = entry;
+  else
+    stripe->oldest = entry;
+  stripe->newest = entry;
+}
+
+/** Finds the link to the entry for `req` in its bucket, or the bucket's end. */
+static status_entry_t **find_entry(status_cache_t *cache, size_t bucket,
+                                   const wire_request_t *req) {
+  status_entry_t **link = &cache->buckets[bucket];
+  while (*link && !same_request(&(*link)->key, req))
+    link = &(*link)->next;
+  return link;
+}
+
+/** Removes the entry at `*link` from the cache and frees it. */
+static void remove_entry(status_stripe_t *stripe, status_entry_t **link) {
+  status_entry_t *entry = *link;
+  *link = entry->next;
+  unlink_entry(stripe, entry);
+  stripe->entries--;
+  stripe->bytes -= sizeof(status_entry_t) + entry->len;
+  free(entry);
+}
+
+size_t status_cache_lookup(status_cache_t *cache, const wire_request_t *req, uint64_t version,
+                           char *buf) {
+  size_t bucket = status_hash(req) & cache->mask, len = 0;
+  status_stripe_t *stripe = &cache->stripes[bucket % STATUS_CACHE_STRIPES];
+  status_entry_t *entry;
+
+  pthread_mutex_lock(&stripe->lock);
+  entry = *find_entry(cache, bucket, req);
+  if (entry && entry->version == version) {
+    memcpy(buf, entry->text, entry->len);
+    len = entry->len;
+    unlink_entry(stripe, entry);
+    link_newest(stripe, entry);
+    stripe->hits++;
+  } else {
+    stripe->misses++;
+  }
+  pthread_mutex_unlock(&stripe->lock);
+  return len;
+}
+
+void status_cache_store(status_cache_t *cache, const wire_request_t *req, uint64_t version,
+                        const char *text, size_t len) {
+  size_t bucket = status_hash(req) & cache->mask, size = sizeof(status_entry_t) + len;
+  status_stripe_t *stripe = &cache->stripes[bucket % STATUS_CACHE_STRIPES];
+  status_entry_t **link, *entry;
+
+  if (len == 0 || len > STATUS_CACHE_TEXT_MAX || size > cache->stripe_bytes)
+    return;
+  // Allocated before taking the lock, and dropped if it is not needed
+  if ((entry = malloc(size)) == NULL)
+    return;
+  entry->key = *req;
+  entry->version = version;
+  entry->len = len;
+  memcpy(entry->text, text, len);
+
+  pthread_mutex_lock(&stripe->lock);
+  link = find_entry(cache, bucket, req);
+  // Another worker may have stored a newer response in the meantime
+  if (*link && (*link)->version >= version) {
+    pthread_mutex_unlock(&stripe->lock);
+    free(entry);
+    return;
+  }
+  if (*link)
+    remove_entry(stripe, link);
+  while (stripe->oldest && stripe->bytes + size > cache->stripe_bytes) {
+    status_entry_t *oldest = stripe->oldest;
+    remove_entry(stripe, find_entry(cache, status_hash(&oldest->key) & cache->mask,
+                                    &oldest->key));
+  }
+  entry->next = cache->buckets[bucket];
+  cache->buckets[bucket] = entry;
+  link_newest(stripe, entry);
+  stripe->entries++;
+  stripe->bytes += size;
+  pthread_mutex_unlock(&stripe->lock);
+}
+
+void status_cache_stats(status_cache_t *cache, status_cache_stats_t *stats) {
+  memset(stats, 0, sizeof(status_cache_stats_t));
+  stats->capacity = cache->stripe_bytes * STATUS_CACHE_STRIPES;
+  for (int i = 0; i < STATUS_CACHE_STRIPES; i++) {
+    status_stripe_t *stripe = &cache->stripes[i];
+    pthread_mutex_lock(&stripe->lock);
+    stats->hits += stripe->hits;
+    stats->misses += stripe->misses;
+    stats->entries += stripe->entries;
+    stats->entry_bytes += stripe->bytes;
+    pthread_mutex_unlock(&stripe->lock);
+  }
+  stats->bytes = sizeof(status_cache_t) + (cache->mask + 1) * sizeof(status_entry_t *) +
+                 stats->entry_bytes;
+}
+
+uint64_t **schedule_versions_create(const int *gate_counts, int num_airports) {
+  uint64_t **versions = calloc((size_t)num_airports, sizeof(uint64_t *)), *counters;
+  size_t total = 0;
+
+  if (versions == NULL)
+    return NULL;
+  for (int i = 0; i < num_airports; i++)
+    total += 1 + (size_t)gate_counts[i];
+  // Shared, so that the forked airports' bumps are seen by the controller
+  counters = mmap(NULL, total * sizeof(uint64_t), PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (counters == MAP_FAILED) {
+    free(versions);
+    return NULL;
+  }
+  for (int i = 0; i < num_airports; i++) {
+    versions[i] = counters;
+    counters += 1 + gate_counts[i];
+  }
+  return versions;
+}
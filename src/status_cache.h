@@ -0,0 +1,114 @@
+#ifndef STATUS_CACHE_HEADER
+#define STATUS_CACHE_HEADER
+
+#include "wire.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Number of mutexes shared between the cache buckets, each with its own
+ * share of the capacity and its own eviction order. */
+#define STATUS_CACHE_STRIPES 64
+
+/* Longest response kept: the text of a TIME_STATUS of every slot of a gate
+ * fits. */
+#define STATUS_CACHE_TEXT_MAX (WIRE_MAX_RECORDS * WIRE_TEXT_LINE_MAX)
+
+/** Cache of the text responses of the controller to PLANE_STATUS and
+ *  TIME_STATUS requests (the controller's -c), so that repeated reads are
+ *  answered without a hop to the airport.
+ *
+ *  Each response is stored with the version of the schedule it was read at:
+ *  a version number that its airport bumps whenever a booking is stored, in
+ *  memory shared with the controller (see `schedule_versions_create`).
+ *  PLANE_STATUS uses the version of the whole airport, as the plane could be
+ *  booked in any gate, and TIME_STATUS that of its gate only. A lookup only
+ *  hits an entry stored at the version the caller read just before, so a
+ *  response is never served once a booking it could miss has been answered.
+ *
+ *  Entries are hashed into buckets, and each bucket belongs to one of
+ *  `STATUS_CACHE_STRIPES` stripes, under whose mutex its chain and entries
+ *  are accessed. A stripe evicts its least recently used entries once they
+ *  take more than its share of the capacity.
+ */
+typedef struct status_entry_t status_entry_t;
+
+struct status_entry_t {
+  status_entry_t *next;          // In its bucket
+  status_entry_t *newer, *older; // In its stripe, by last use
+  wire_request_t key;
+  uint64_t version;
+  size_t len;
+  char text[];
+};
+
+typedef struct status_stripe_t status_stripe_t;
+
+struct status_stripe_t {
+  pthread_mutex_t lock;
+  status_entry_t *newest, *oldest;
+  size_t entries;
+  size_t bytes; // Allocated for its entries
+  uint64_t hits, misses;
+};
+
+typedef struct status_cache_t status_cache_t;
+
+struct status_cache_t {
+  size_t mask;         // Number of buckets - 1 (the bucket count is a power of two)
+  size_t stripe_bytes; // Most bytes of entries in each stripe
+  status_entry_t **buckets;
+  status_stripe_t stripes[STATUS_CACHE_STRIPES];
+};
+
+/** Totals of a cache's stripes, as reported by CACHE_STATUS. */
+typedef struct status_cache_stats_t status_cache_stats_t;
+
+struct status_cache_stats_t {
+  uint64_t hits, misses;
+  size_t entries;
+  size_t entry_bytes; // Allocated for the entries
+  size_t bytes;       // The entries, the buckets and the cache itself
+  size_t capacity;    // Most bytes of entries
+};
+
+/** @brief Allocates an empty cache whose entries take up to `capacity` bytes.
+ *
+ *  @returns A pointer to the cache, or `NULL` if allocation failed.
+ */
+status_cache_t *create_status_cache(size_t capacity);
+
+/** @brief Frees the cache and all of its entries. */
+void destroy_status_cache(status_cache_t *cache);
+
+/** @brief Looks up the response to `req` stored at `version`, copying its
+ *         text to `buf` (`STATUS_CACHE_TEXT_MAX` bytes), and counts the hit
+ *         or the miss.
+ *
+ *  @returns The length of the text, or 0 on a miss.
+ */
+size_t status_cache_lookup(status_cache_t *cache, const wire_request_t *req, uint64_t version,
+                           char *buf);
+
+/** @brief Stores the `len` bytes of `text` as the response to `req` at
+ *         `version`, in place of any response stored at an older version.
+ *         Texts longer than `STATUS_CACHE_TEXT_MAX` are not stored.
+ */
+void status_cache_store(status_cache_t *cache, const wire_request_t *req, uint64_t version,
+                        const char *text, size_t len);
+
+/** @brief Adds up the statistics of every stripe. */
+void status_cache_stats(status_cache_t *cache, status_cache_stats_t *stats);
+
+/** @brief Maps the version numbers of the schedules of `num_airports`
+ *         airports, of `gate_counts[i]` gates each, in memory that the
+ *         airports forked afterwards share with the controller.
+ *
+ *         Airport `i` owns `versions[i][0]`, bumped whenever it stores a
+ *         booking, and `versions[i][1 + g]`, bumped when gate `g` gets one.
+ *
+ *  @returns The array of each airport's versions, or `NULL` on failure.
+ */
+uint64_t **schedule_versions_create(const int *gate_counts, int num_airports);
+
+#endif
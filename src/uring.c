@@ -0,0 +1,206 @@
+#include "uring.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* The ring indices are shared with the kernel, so loads of the indices it
+ * writes need acquire semantics, and stores of ours need release semantics. */
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+  return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                              unsigned flags) {
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+  return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+int uring_init(uring_t *ring, unsigned entries) {
+  struct io_uring_params p;
+  unsigned *array;
+
+  memset(ring, 0, sizeof(uring_t));
+  memset(&p, 0, sizeof(p));
+  // Leave room for bursts of completions, e.g. one receive per connection
+  p.flags = IORING_SETUP_CQSIZE;
+  p.cq_entries = entries * 4;
+  if ((ring->fd = sys_io_uring_setup(entries, &p)) < 0)
+    return -1;
+
+  ring->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  ring->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (ring->cq_size > ring->sq_size)
+      ring->sq_size = ring->cq_size;
+    ring->cq_size = ring->sq_size;
+  }
+  ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ptr == MAP_FAILED)
+    goto fail;
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->cq_ptr = ring->sq_ptr;
+  } else {
+    ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ptr == MAP_FAILED)
+      goto fail;
+  }
+  ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED)
+    goto fail;
+
+  ring->sq_head = (unsigned *)((char *)ring->sq_ptr + p.sq_off.head);
+  ring->sq_tail = (unsigned *)((char *)ring->sq_ptr + p.sq_off.tail);
+  ring->sq_mask = *(unsigned *)((char *)ring->sq_ptr + p.sq_off.ring_mask);
+  ring->sq_entries = p.sq_entries;
+  ring->sqe_tail = *ring->sq_tail;
+  ring->cq_head = (unsigned *)((char *)ring->cq_ptr + p.cq_off.head);
+  ring->cq_tail = (unsigned *)((char *)ring->cq_ptr + p.cq_off.tail);
+  ring->cq_mask = *(unsigned *)((char *)ring->cq_ptr + p.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)((char *)ring->cq_ptr + p.cq_off.cqes);
+
+  // Submission slot `i` always holds entry `i`, so only the tail moves
+  array = (unsigned *)((char *)ring->sq_ptr + p.sq_off.array);
+  for (unsigned i = 0; i < p.sq_entries; i++)
+    array[i] = i;
+  return 0;
+
+fail:
+  uring_exit(ring);
+  return -1;
+}
+
+void uring_exit(uring_t *ring) {
+  if (ring->sqes && ring->sqes != MAP_FAILED)
+    munmap(ring->sqes, ring->sqes_size);
+  if (ring->cq_ptr && ring->cq_ptr != MAP_FAILED && ring->cq_ptr != ring->sq_ptr)
+    munmap(ring->cq_ptr, ring->cq_size);
+  if (ring->sq_ptr && ring->sq_ptr != MAP_FAILED)
+    munmap(ring->sq_ptr, ring->sq_size);
+  if (ring->fd >= 0)
+    close(ring->fd);
+  memset(ring, 0, sizeof(uring_t));
+  ring->fd = -1;
+}
+
+struct io_uring_sqe *uring_get_sqe(uring_t *ring) {
+  struct io_uring_sqe *sqe;
+  if (ring->sqe_tail - LOAD_ACQUIRE(ring->sq_head) >= ring->sq_entries) {
+    // Full: hand what we have to the kernel to make room
+    if (uring_submit_and_wait(ring, 0) < 0 ||
+        ring->sqe_tail - LOAD_ACQUIRE(ring->sq_head) >= ring->sq_entries)
+      return NULL;
+  }
+  sqe = &ring->sqes[ring->sqe_tail & ring->sq_mask];
+  ring->sqe_tail++;
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+int uring_submit_and_wait(uring_t *ring, unsigned wait_nr) {
+  unsigned to_submit = ring->sqe_tail - *ring->sq_tail;
+  int ret;
+  STORE_RELEASE(ring->sq_tail, ring->sqe_tail);
+  do {
+    ret = sys_io_uring_enter(ring->fd, to_submit, wait_nr,
+                             wait_nr ? IORING_ENTER_GETEVENTS : 0);
+  } while (ret < 0 && errno == EINTR && wait_nr == 0);
+  return ret;
+}
+
+struct io_uring_cqe *uring_peek_cqe(uring_t *ring) {
+  unsigned head = *ring->cq_head;
+  if (head == LOAD_ACQUIRE(ring->cq_tail))
+    return NULL;
+  return &ring->cqes[head & ring->cq_mask];
+}
+
+void uring_cqe_seen(uring_t *ring) { STORE_RELEASE(ring->cq_head, *ring->cq_head + 1); }
+
+int uring_buf_ring_init(uring_t *ring, uring_buf_ring_t *bufs, unsigned short bgid,
+                        unsigned entries, unsigned size) {
+  struct io_uring_buf_reg reg;
+
+  memset(bufs, 0, sizeof(uring_buf_ring_t));
+  bufs->entries = entries;
+  bufs->size = size;
+  bufs->bgid = bgid;
+  // The ring of buffer descriptors must be page aligned
+  bufs->br = mmap(NULL, entries * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE,
+                  MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  if (bufs->br == MAP_FAILED)
+    return -1;
+  if ((bufs->bufs = malloc((size_t)entries * size)) == NULL)
+    return -1;
+
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uint64_t)(uintptr_t)bufs->br;
+  reg.ring_entries = entries;
+  reg.bgid = bgid;
+  if (sys_io_uring_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    return -1;
+  for (unsigned bid = 0; bid < entries; bid++)
+    uring_buf_ring_recycle(bufs, bid);
+  return 0;
+}
+
+void uring_buf_ring_recycle(uring_buf_ring_t *bufs, unsigned bid) {
+  struct io_uring_buf *buf = &bufs->br->bufs[bufs->tail & (bufs->entries - 1)];
+  buf->addr = (uint64_t)(uintptr_t)uring_buf_ring_get(bufs, bid);
+  buf->len = bufs->size;
+  buf->bid = (unsigned short)bid;
+  bufs->tail++;
+  STORE_RELEASE(&bufs->br->tail, (unsigned short)bufs->tail);
+}
+
+int uring_supported(void) {
+  uring_t ring;
+  uring_buf_ring_t bufs = {0};
+  struct io_uring_sqe *sqe;
+  struct io_uring_cqe *cqe;
+  int sv[2] = {-1, -1}, ok = 0;
+
+  if (uring_init(&ring, 4) < 0)
+    return 0;
+  if (uring_buf_ring_init(&ring, &bufs, 0, 2, 64) < 0 ||
+      socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+    goto out;
+
+  // A multishot receive that picks a provided buffer, and stays armed
+  sqe = uring_get_sqe(&ring);
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = sv[0];
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = 0;
+  if (write(sv[1], "x", 1) != 1 || uring_submit_and_wait(&ring, 1) < 0)
+    goto out;
+  if ((cqe = uring_peek_cqe(&ring)) != NULL)
+    ok = cqe->res == 1 && (cqe->flags & IORING_CQE_F_BUFFER) && (cqe->flags & IORING_CQE_F_MORE);
+
+out:
+  if (sv[0] >= 0) {
+    close(sv[0]);
+    close(sv[1]);
+  }
+  uring_exit(&ring);
+  if (bufs.br && bufs.br != MAP_FAILED)
+    munmap(bufs.br, bufs.entries * sizeof(struct io_uring_buf));
+  free(bufs.bufs);
+  return ok;
+}
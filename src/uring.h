@@ -0,0 +1,90 @@
+#ifndef URING_HEADER
+#define URING_HEADER
+
+#include <linux/io_uring.h>
+#include <stddef.h>
+
+/** A minimal io_uring wrapper over the raw system calls, covering what the
+ *  reactor's io_uring backend needs: a submission and completion ring, and
+ *  a registered ring of provided buffers that multishot receives pick from.
+ *
+ *  A ring must only be used from one thread at a time.
+ */
+
+typedef struct uring_t uring_t;
+
+struct uring_t {
+  int fd;
+  unsigned *sq_head, *sq_tail, sq_mask, sq_entries;
+  unsigned sqe_tail; /* Next free entry, published to `*sq_tail` on submit */
+  unsigned *cq_head, *cq_tail, cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_ptr, *cq_ptr;
+  size_t sq_size, cq_size, sqes_size;
+};
+
+/** Buffers registered with the kernel under group `bgid`. A receive that
+ *  selects a buffer reports its id in the completion, and the buffer must be
+ *  handed back with `uring_buf_ring_recycle` once its data has been used. */
+typedef struct uring_buf_ring_t uring_buf_ring_t;
+
+struct uring_buf_ring_t {
+  struct io_uring_buf_ring *br;
+  char *bufs;
+  unsigned entries, size, tail;
+  unsigned short bgid;
+};
+
+/** @brief Sets up a ring with room for `entries` submissions.
+ *
+ *  @returns 0 on success, -1 (with `errno` set) on failure.
+ */
+int uring_init(uring_t *ring, unsigned entries);
+
+/** @brief Tears down a ring set up by `uring_init`. */
+void uring_exit(uring_t *ring);
+
+/** @brief Returns a zeroed submission entry, submitting the queued ones first
+ *         if the ring is full. Returns `NULL` if no entry could be freed. */
+struct io_uring_sqe *uring_get_sqe(uring_t *ring);
+
+/** @brief Submits every queued entry and waits until at least `wait_nr`
+ *         completions are available, all in one system call.
+ *
+ *  @returns The number of entries submitted, or -1 (with `errno` set).
+ */
+int uring_submit_and_wait(uring_t *ring, unsigned wait_nr);
+
+/** @brief Returns the next completion, or `NULL` if there is none yet. It
+ *         stays valid until `uring_cqe_seen` is called. */
+struct io_uring_cqe *uring_peek_cqe(uring_t *ring);
+
+/** @brief Marks the completion returned by `uring_peek_cqe` as consumed. */
+void uring_cqe_seen(uring_t *ring);
+
+/** @brief Allocates `entries` buffers of `size` bytes each (`entries` must be
+ *         a power of two) and registers them with the ring as group `bgid`.
+ *
+ *  @returns 0 on success, -1 on failure.
+ */
+int uring_buf_ring_init(uring_t *ring, uring_buf_ring_t *bufs, unsigned short bgid,
+                        unsigned entries, unsigned size);
+
+/** @brief Returns the start of buffer `bid`. */
+static inline char *uring_buf_ring_get(uring_buf_ring_t *bufs, unsigned bid) {
+  return bufs->bufs + (size_t)bid * bufs->size;
+}
+
+/** @brief Hands buffer `bid` back to the kernel for another receive. */
+void uring_buf_ring_recycle(uring_buf_ring_t *bufs, unsigned bid);
+
+/** @brief Checks whether the running kernel supports everything the reactor's
+ *         io_uring backend relies on, by actually performing a multishot
+ *         receive into a provided buffer over a socket pair.
+ *
+ *  @returns 1 if it does, 0 if not.
+ */
+int uring_supported(void);
+
+#endif
@@ -0,0 +1,318 @@
+#include "wire.h"
+#include "airport.h"
+
+static void put32(uint8_t *p, int32_t v) {
+  uint32_t u = (uint32_t)v;
+  p[0] = (uint8_t)u;
+  p[1] = (uint8_t)(u >> 8);
+  p[2] = (uint8_t)(u >> 16);
+  p[3] = (uint8_t)(u >> 24);
+}
+
+static int32_t get32(const uint8_t *p) {
+  return (int32_t)((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+                   (uint32_t)p[3] << 24);
+}
+
+void wire_encode_request(const wire_request_t *req, uint8_t *out) {
+  out[0] = req->type;
+  out[1] = out[2] = out[3] = 0;
+  for (int i = 0; i < 5; i++)
+    put32(out + 4 + 4 * i, req->args[i]);
+}
+
+void wire_decode_request(const uint8_t *in, wire_request_t *req) {
+  req->type = in[0];
+  for (int i = 0; i < 5; i++)
+    req->args[i] = get32(in + 4 + 4 * i);
+}
+
+void wire_encode_response(const wire_response_t *res, uint8_t *out) {
+  out[0] = res->type;
+  out[1] = res->status;
+  out[2] = (uint8_t)res->count;
+  out[3] = (uint8_t)(res->count >> 8);
+  for (int i = 0; i < 4; i++)
+    put32(out + 4 + 4 * i, res->values[i]);
+}
+
+void wire_decode_response(const uint8_t *in, wire_response_t *res) {
+  res->type = in[0];
+  res->status = in[1];
+  res->count = (uint16_t)(in[2] | in[3] << 8);
+  for (int i = 0; i < 4; i++)
+    res->values[i] = get32(in + 4 + 4 * i);
+}
+
+/* The whitespace `sscanf` skips, without the locale lookups of `isspace`. */
+static inline int is_space(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+static inline int is_digit(char c) { return c >= '0' && c <= '9'; }
+
+/* Parses a decimal integer (with an optional sign) at `*p`, advancing `*p`
+ * past it. Returns 1 on success, 0 if there is no integer before `end`, or -1
+ * if it does not fit in an `int32_t`. */
+static int parse_int(const char **p, const char *end, int32_t *out) {
+  const char *s = *p;
+  int negative = 0;
+  int64_t value = 0;
+
+  if (s < end && (*s == '-' || *s == '+'))
+    negative = (*s++ == '-');
+  if (s == end || !is_digit(*s))
+    return 0;
+  do {
+    value = value * 10 + (*s++ - '0');
+    if (value > (int64_t)INT32_MAX + negative)
+      return -1;
+  } while (s < end && is_digit(*s));
+  *out = (int32_t)(negative ? -value : value);
+  *p = s;
+  return 1;
+}
+
+int wire_parse_request(const char *line, size_t n, wire_request_t *req) {
+  const char *p = line, *end = line + n, *command;
+  size_t len;
+  int num_args = 0, ret;
+
+  // A NUL ends the line early, as it would for `sscanf`
+  memset(req, 0, sizeof(wire_request_t));
+  while (p < end && is_space(*p))
+    p++;
+  command = p;
+  while (p < end && *p && !is_space(*p))
+    p++;
+  len = (size_t)(p - command);
+
+  // The length picks the candidates
+  switch (len) {
+  case 8:
+    req->type = (memcmp(command, "SCHEDULE", 8) == 0) ? WIRE_SCHEDULE : 0;
+    break;
+  case 11:
+    req->type = (memcmp(command, "TIME_STATUS", 11) == 0) ? WIRE_TIME_STATUS : 0;
+    break;
+  case 12:
+    if (memcmp(command, "PLANE_STATUS", 12) == 0)
+      req->type = WIRE_PLANE_STATUS;
+    else if (memcmp(command, "CACHE_STATUS", 12) == 0)
+      req->type = WIRE_CACHE_STATUS;
+    break;
+  case 14:
+    if (memcmp(command, "AIRPORT_STATUS", 14) == 0)
+      req->type = WIRE_AIRPORT_STATUS;
+    else if (memcmp(command, "SCHEDULE_BATCH", 14) == 0)
+      req->type = WIRE_SCHEDULE_BATCH;
+    break;
+  default:
+    break;
+  }
+  if (req->type == 0)
+    return -1;
+
+  // Like `sscanf("%d %d ...")`, read integers separated by optional
+  // whitespace until one is missing, and ignore whatever follows
+  while (num_args < 5) {
+    while (p < end && is_space(*p))
+      p++;
+    if ((ret = parse_int(&p, end, &req->args[num_args])) < 0)
+      return -1;
+    if (ret == 0)
+      break;
+    num_args++;
+  }
+
+  switch (req->type) {
+  case WIRE_SCHEDULE:
+    return (num_args == 5) ? 0 : -1;
+  case WIRE_PLANE_STATUS:
+    return (num_args == 2) ? 0 : -1;
+  case WIRE_AIRPORT_STATUS:
+    if (num_args == 1)
+      req->args[2] = -1;
+    return (num_args == 1 || num_args == 3) ? 0 : -1;
+  case WIRE_SCHEDULE_BATCH:
+    // Only the head, which says where to forward the line
+    return (num_args >= 2) ? 0 : -1;
+  case WIRE_CACHE_STATUS:
+    return (num_args == 0) ? 0 : -1;
+  default:
+    return (num_args == 4) ? 0 : -1;
+  }
+}
+
+int wire_parse_batch(const char *line, size_t n, const wire_request_t *req,
+                     wire_flight_t *flights) {
+  const char *p = line, *end = line + n;
+  int32_t values[2 + 4 * WIRE_BATCH_MAX + 1];
+  int num_values = 0, ret;
+
+  if (req->type != WIRE_SCHEDULE_BATCH || (req->args[1] != 0 && req->args[1] != 1))
+    return -1;
+  // Past the command, then integers up to the first thing that is not one,
+  // as in `wire_parse_request`
+  while (p < end && is_space(*p))
+    p++;
+  while (p < end && *p && !is_space(*p))
+    p++;
+  while (num_values < (int)(sizeof(values) / sizeof(values[0]))) {
+    while (p < end && is_space(*p))
+      p++;
+    if ((ret = parse_int(&p, end, &values[num_values])) < 0)
+      return -1;
+    if (ret == 0)
+      break;
+    num_values++;
+  }
+  num_values -= 2;
+  if (num_values < 4 || num_values % 4 != 0 || num_values > 4 * WIRE_BATCH_MAX)
+    return -1;
+  for (int i = 0; i < num_values / 4; i++)
+    flights[i] = (wire_flight_t){values[2 + 4 * i], values[3 + 4 * i], values[4 + 4 * i],
+                                 values[5 + 4 * i]};
+  return num_values / 4;
+}
+
+void wire_error(wire_response_t *res, uint8_t type, uint8_t status, int32_t value) {
+  memset(res, 0, sizeof(wire_response_t));
+  res->type = type;
+  res->status = status;
+  res->values[0] = value;
+}
+
+#define HH(idx) IDX_TO_HOUR(idx)
+#define MM(idx) ((int)IDX_TO_MINS(idx))
+
+/* Longest "HH:MM: A - <plane>\n" after a slot line's prefix, plus a NUL. */
+#define SLOT_SUFFIX_MAX 24
+
+/* Writes the decimal form of `v` at `p`, and returns its length. */
+static size_t put_int(char *p, int32_t v) {
+  uint32_t u = (v < 0) ? 0u - (uint32_t)v : (uint32_t)v;
+  char digits[10];
+  size_t n = 0, len = 0;
+
+  do {
+    digits[n++] = (char)('0' + u % 10);
+    u /= 10;
+  } while (u > 0);
+  if (v < 0)
+    p[len++] = '-';
+  while (n > 0)
+    p[len++] = digits[--n];
+  return len;
+}
+
+/* Writes the TIME_SLOT line of slot record values `s` (whose slot is in
+ * range) at `p`, NUL-terminated like `snprintf`, and returns its length. */
+static size_t format_slot(char *p, const char *prefix, size_t prefix_len, const int32_t *s) {
+  char *start = p;
+  int hour = HH(s[0]);
+
+  memcpy(p, prefix, prefix_len);
+  p += prefix_len;
+  *p++ = (char)('0' + hour / 10);
+  *p++ = (char)('0' + hour % 10);
+  *p++ = ':';
+  *p++ = MM(s[0]) ? '3' : '0';
+  *p++ = '0';
+  *p++ = ':';
+  *p++ = ' ';
+  *p++ = s[1] ? 'A' : 'F';
+  *p++ = ' ';
+  *p++ = '-';
+  *p++ = ' ';
+  p += put_int(p, s[2]);
+  *p++ = '\n';
+  *p = '\0';
+  return (size_t)(p - start);
+}
+
+size_t wire_format_text(const wire_response_t *recs, char *buf, size_t size) {
+  const int32_t *v = recs->values;
+  size_t len = 0;
+  int n = 0;
+
+  switch (recs->status) {
+  case WIRE_OK:
+    if (recs->type == WIRE_SCHEDULE_BATCH)
+      n = snprintf(buf, size, "BATCH %d: %d of %d scheduled\n", v[0], v[1], v[2]);
+    else if (recs->type == WIRE_SCHEDULE)
+      n = snprintf(buf, size, "SCHEDULED %d at GATE %d: %02d:%02d-%02d:%02d\n", v[0], v[1],
+                   HH(v[2]), MM(v[2]), HH(v[3]), MM(v[3]));
+    else if (recs->type == WIRE_PLANE_STATUS)
+      n = snprintf(buf, size, "PLANE %d scheduled at GATE %d: %02d:%02d-%02d:%02d\n", v[0],
+                   v[1], HH(v[2]), MM(v[2]), HH(v[3]), MM(v[3]));
+    break;
+  case WIRE_NOT_SCHEDULED:
+    n = snprintf(buf, size, "PLANE %d not scheduled at airport %d\n", v[0], v[1]);
+    break;
+  case WIRE_CANNOT_SCHEDULE:
+    n = snprintf(buf, size, "Error: Cannot schedule %d\n", v[0]);
+    break;
+  case WIRE_INVALID_EARLIEST:
+    n = snprintf(buf, size, "Error: Invalid 'earliest' time (%d)\n", v[0]);
+    break;
+  case WIRE_INVALID_DURATION:
+    n = snprintf(buf, size, "Error: Invalid 'duration' value (%d)\n", v[0]);
+    break;
+  case WIRE_INVALID_FUEL:
+    n = snprintf(buf, size, "Error: Invalid 'fuel' value (%d)\n", v[0]);
+    break;
+  case WIRE_INVALID_GATE:
+    n = snprintf(buf, size, "Error: Invalid 'gate' value (%d)\n", v[0]);
+    break;
+  case WIRE_NO_SUCH_AIRPORT:
+    n = snprintf(buf, size, "Error: Airport %d does not exist\n", v[0]);
+    break;
+  case WIRE_UNAVAILABLE:
+    n = snprintf(buf, size, "Error: Airport %d is unavailable\n", v[0]);
+    break;
+  default:
+    n = snprintf(buf, size, "Error: Invalid request provided\n");
+    break;
+  }
+  if (n > 0)
+    len = ((size_t)n < size) ? (size_t)n : size - 1;
+
+  // SCHEDULE_BATCH: the response of each flight, in the order they were sent
+  if (recs->status == WIRE_OK && recs->type == WIRE_SCHEDULE_BATCH) {
+    for (int i = 1; i <= recs->count && len < size - 1; i++)
+      len += wire_format_text(&recs[i], buf + len, size - len);
+  }
+
+  // TIME_STATUS: one line per slot record after the header. The lines only
+  // differ after their "AIRPORT a GATE g " prefix, so that is formatted once
+  // and the rest written by hand, falling back to `snprintf` near the end of
+  // the buffer (or for a slot out of range, from a misbehaving peer)
+  if (recs->status == WIRE_OK && recs->type == WIRE_TIME_STATUS) {
+    char prefix[WIRE_TEXT_LINE_MAX];
+    size_t prefix_len = (size_t)snprintf(prefix, sizeof(prefix), "AIRPORT %d GATE %d ", v[0], v[1]);
+    for (int i = 1; i <= recs->count && len < size; i++) {
+      const int32_t *s = recs[i].values;
+      if ((uint32_t)s[0] < NUM_TIME_SLOTS && size - len > prefix_len + SLOT_SUFFIX_MAX) {
+        len += format_slot(buf + len, prefix, prefix_len, s);
+        continue;
+      }
+      n = snprintf(buf + len, size - len, "AIRPORT %d GATE %d %02d:%02d: %c - %d\n", v[0], v[1],
+                   HH(s[0]), MM(s[0]), s[1] ? 'A' : 'F', s[2]);
+      if (n > 0)
+        len += ((size_t)n < size - len) ? (size_t)n : size - len - 1;
+    }
+  }
+  return len;
+}
+
+void wire_write_text(const wire_response_t *recs, wio_t *out) {
+  size_t size = (size_t)(1 + recs->count) * WIRE_TEXT_LINE_MAX;
+  wio_commit(out, wire_format_text(recs, wio_reserve(out, size), size));
+}
+
+int wire_negotiate(int fd, rio_t *rio) {
+  char line[MAXLINE];
+  if (rio_writen(fd, WIRE_HELLO, strlen(WIRE_HELLO)) < 0 ||
+      rio_readlineb(rio, line, MAXLINE) <= 0 || strcmp(line, WIRE_HELLO_OK) != 0)
+    return -1;
+  return 0;
+}
@@ -0,0 +1,145 @@
+#ifndef WIRE_HEADER
+#define WIRE_HEADER
+
+#include "network_utils.h"
+#include <stdint.h>
+
+/** Binary wire protocol, which clients and the controller-to-airport hop can
+ *  opt into instead of text lines.
+ *
+ *  A connection starts in the text protocol. Sending the line `WIRE_HELLO`
+ *  switches it to binary: the server answers `WIRE_HELLO_OK` (as text), and
+ *  from then on both directions only carry fixed-size little-endian records.
+ *
+ *  Each request is one `WIRE_REQUEST_SIZE` record: a command type byte, three
+ *  reserved bytes, and five signed 32-bit arguments, in the same order as in
+ *  the text command (airport id first). Each response is one header record of
+ *  `WIRE_RESPONSE_SIZE` bytes: type, status, a 16-bit count, and four signed
+ *  32-bit values, followed by `count` more records (the slots of a
+ *  TIME_STATUS response).
+ */
+
+#define WIRE_HELLO "BINARY\n"
+#define WIRE_HELLO_OK "OK BINARY\n"
+
+#define WIRE_REQUEST_SIZE 24
+#define WIRE_RESPONSE_SIZE 20
+
+/* Largest number of records in a response: a header and one per time slot. */
+#define WIRE_MAX_RECORDS 49
+
+/* Most flights in one SCHEDULE_BATCH line (the shortest flight, "0 0 0 0 ",
+ * takes 8 of a line's `MAXLINE` bytes). */
+#define WIRE_BATCH_MAX 128
+
+/* Upper bound on the text of one response record, including its newline. */
+#define WIRE_TEXT_LINE_MAX 96
+
+/** Record types. */
+enum {
+  WIRE_SCHEDULE = 1,     /* args: airport, plane, earliest, duration, fuel */
+  WIRE_PLANE_STATUS = 2, /* args: airport, plane */
+  WIRE_TIME_STATUS = 3,  /* args: airport, gate, start, duration */
+  WIRE_TIME_SLOT = 4,    /* Response only: values are slot, occupied, plane */
+  WIRE_AIRPORT_STATUS = 5, /* Text only: args: airport, first gate, last gate
+                              (-1 for the airport's last gate) */
+  WIRE_SCHEDULE_BATCH = 6, /* Text only: args: airport, order (1 to schedule by
+                              fuel urgency), then the flights (see
+                              `wire_parse_batch`); response values: airport,
+                              scheduled, flights */
+  WIRE_CACHE_STATUS = 7,   /* Text only, answered by the controller: no args */
+};
+
+/** Response statuses. The values of an error response hold the offending
+ *  value in `values[0]`. */
+enum {
+  WIRE_OK = 0,              /* SCHEDULE/PLANE_STATUS: plane, gate, start, end;
+                               TIME_STATUS: airport, gate, start */
+  WIRE_NOT_SCHEDULED,       /* plane, airport */
+  WIRE_CANNOT_SCHEDULE,     /* plane */
+  WIRE_INVALID_REQUEST,
+  WIRE_INVALID_EARLIEST,
+  WIRE_INVALID_DURATION,
+  WIRE_INVALID_FUEL,
+  WIRE_INVALID_GATE,
+  WIRE_NO_SUCH_AIRPORT,     /* airport */
+  WIRE_UNAVAILABLE,         /* airport */
+};
+
+typedef struct wire_request_t wire_request_t;
+
+struct wire_request_t {
+  uint8_t type;
+  int32_t args[5];
+};
+
+/** One flight of a SCHEDULE_BATCH request: the arguments of a SCHEDULE
+ *  after the airport id. */
+typedef struct wire_flight_t wire_flight_t;
+
+struct wire_flight_t {
+  int32_t plane, earliest, duration, fuel;
+};
+
+typedef struct wire_response_t wire_response_t;
+
+struct wire_response_t {
+  uint8_t type;
+  uint8_t status;
+  uint16_t count;
+  int32_t values[4];
+};
+
+/** @brief Encodes/decodes records to and from their little-endian layout. */
+void wire_encode_request(const wire_request_t *req, uint8_t *out);
+void wire_decode_request(const uint8_t *in, wire_request_t *req);
+void wire_encode_response(const wire_response_t *res, uint8_t *out);
+void wire_decode_response(const uint8_t *in, wire_response_t *res);
+
+/** @brief Parses the text request line of `n` bytes at `line` (which need not
+ *         be NUL-terminated) into a request record, in a single pass and
+ *         without allocating.
+ *
+ *  A line is valid if it is one of the commands followed by exactly its
+ *  number of integer arguments; like the `sscanf` parsing it replaces,
+ *  anything after the last integer is ignored. Integers that do not fit in 32
+ *  bits make the request invalid. `AIRPORT_STATUS <airport>` is short for
+ *  `AIRPORT_STATUS <airport> 0 -1`, the whole airport.
+ *
+ *  @returns 0 on success, -1 if the line is not a valid request.
+ */
+int wire_parse_request(const char *line, size_t n, wire_request_t *req);
+
+/** @brief Parses a whole `SCHEDULE_BATCH <airport> <order> <flights...>` line,
+ *         whose head `wire_parse_request` has parsed into `req`, storing its
+ *         flights in `flights` (`WIRE_BATCH_MAX` of them). Each flight is four
+ *         integers: plane, earliest, duration and fuel, as in SCHEDULE.
+ *
+ *  @returns The number of flights, or -1 if there are none, more than
+ *           `WIRE_BATCH_MAX`, an incomplete one, or the order is not 0 or 1.
+ */
+int wire_parse_batch(const char *line, size_t n, const wire_request_t *req,
+                     wire_flight_t *flights);
+
+/** @brief Renders the records of one response (`1 + recs[0].count` of them)
+ *         as the equivalent text response, truncated to `size` bytes.
+ *
+ *  @returns The length of the text.
+ */
+size_t wire_format_text(const wire_response_t *recs, char *buf, size_t size);
+
+/** @brief Renders the records of one response as text straight into the
+ *         output buffer `out`, at its `wio_reserve` cursor.
+ */
+void wire_write_text(const wire_response_t *recs, wio_t *out);
+
+/** @brief Fills in an error response with the given status and value. */
+void wire_error(wire_response_t *res, uint8_t type, uint8_t status, int32_t value);
+
+/** @brief Switches a freshly opened connection to the binary protocol.
+ *
+ *  @returns 0 on success, -1 if the server did not accept.
+ */
+int wire_negotiate(int fd, rio_t *rio);
+
+#endif
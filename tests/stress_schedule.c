@@ -0,0 +1,165 @@
+/** Stress test for concurrent scheduling in a single airport.
+ *
+ *  Many client threads issue SCHEDULE requests (one at a time, in batches, or
+ *  in shared windows) against the same small airport at once, while reader
+ *  threads poll PLANE_STATUS and gate searches. Once all clients are done,
+ *  the final schedule is checked to make sure that:
+ *
+ *  - every accepted plane occupies exactly the window it was told about,
+ *  - no slot is claimed by two planes (double-booked),
+ *  - no slot is marked occupied without belonging to an accepted plane
+ *    (orphaned), and the occupancy bitmap matches the time slots,
+ *  - the plane index agrees with the time slots.
+ *
+ *  Rounds take turns at each of `schedule_plane`'s gate policies.
+ *
+ *  Usage: ./tests/stress_schedule [rounds]
+ *  Exits with status 1 and prints the first violation found on failure.
+ */
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/airport.h"
+
+#define NUM_GATES 4
+#define NUM_CLIENTS 16
+#define NUM_READERS 4
+#define REQUESTS_PER_CLIENT 200
+#define BATCH_SIZE 8 /* Divides REQUESTS_PER_CLIENT */
+#define WINDOW_US 100
+
+typedef struct {
+  int client;
+  unsigned seed;
+  time_info_t results[REQUESTS_PER_CLIENT];
+  int durations[REQUESTS_PER_CLIENT];
+} client_t;
+
+static volatile int clients_running;
+
+#define PLANE_ID(client, req) ((client) * REQUESTS_PER_CLIENT + (req) + 1)
+
+static void *client_routine(void *arg) {
+  client_t *c = arg;
+  wire_flight_t batch[BATCH_SIZE];
+  for (int req = 0; req < REQUESTS_PER_CLIENT; req++) {
+    int start = rand_r(&c->seed) % NUM_TIME_SLOTS;
+    int duration = rand_r(&c->seed) % 4;
+    int fuel = rand_r(&c->seed) % 8;
+    if (start + duration >= NUM_TIME_SLOTS)
+      duration = NUM_TIME_SLOTS - 1 - start;
+    c->durations[req] = duration;
+    if (c->client % 4 == 0) {
+      c->results[req] = schedule_plane(PLANE_ID(c->client, req), start, duration, fuel);
+      continue;
+    }
+    if (c->client % 4 == 2) {
+      c->results[req] = schedule_in_window(PLANE_ID(c->client, req), start, duration, fuel);
+      continue;
+    }
+    // Odd clients send their requests in batches, half of them by urgency
+    batch[req % BATCH_SIZE] = (wire_flight_t){PLANE_ID(c->client, req), start, duration, fuel};
+    if (req % BATCH_SIZE == BATCH_SIZE - 1)
+      schedule_batch(batch, BATCH_SIZE, c->client % 4 == 1, &c->results[req + 1 - BATCH_SIZE]);
+  }
+  __atomic_fetch_sub(&clients_running, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+static void *reader_routine(void *arg) {
+  unsigned seed = (unsigned)(size_t)arg;
+  while (__atomic_load_n(&clients_running, __ATOMIC_ACQUIRE) > 0) {
+    int plane_id = rand_r(&seed) % (NUM_CLIENTS * REQUESTS_PER_CLIENT) + 1;
+    lookup_plane_in_airport(plane_id);
+    search_gate(get_gate_by_idx(rand_r(&seed) % NUM_GATES), plane_id);
+    // Lets the clients waiting on a window back in on a single CPU
+    sched_yield();
+  }
+  return NULL;
+}
+
+#define FAIL(...)                 \
+  do {                            \
+    fprintf(stderr, __VA_ARGS__); \
+    return 1;                     \
+  } while (0)
+
+static int check_round(airport_t *airport, client_t *clients) {
+  int owner[NUM_GATES][NUM_TIME_SLOTS] = {{0}};
+
+  // Replay every accepted booking onto an empty schedule
+  for (int c = 0; c < NUM_CLIENTS; c++) {
+    for (int req = 0; req < REQUESTS_PER_CLIENT; req++) {
+      time_info_t r = clients[c].results[req];
+      int plane_id = PLANE_ID(c, req);
+      if (r.gate_number < 0)
+        continue;
+      if (r.end_time - r.start_time != clients[c].durations[req])
+        FAIL("plane %d got a window of the wrong length\n", plane_id);
+      for (int slot = r.start_time; slot <= r.end_time; slot++) {
+        if (owner[r.gate_number][slot])
+          FAIL("gate %d slot %d double-booked by planes %d and %d\n", r.gate_number, slot,
+               owner[r.gate_number][slot], plane_id);
+        owner[r.gate_number][slot] = plane_id;
+      }
+      time_info_t indexed = lookup_plane_in_airport(plane_id);
+      if (indexed.gate_number != r.gate_number || indexed.start_time != r.start_time ||
+          indexed.end_time != r.end_time)
+        FAIL("plane index disagrees with the schedule for plane %d\n", plane_id);
+    }
+  }
+
+  // Compare the replayed schedule with what the airport actually holds
+  for (int g = 0; g < NUM_GATES; g++) {
+    gate_t *gate = get_gate_by_idx(g);
+    for (int slot = 0; slot < NUM_TIME_SLOTS; slot++) {
+      time_slot_t *ts = get_time_slot_by_idx(gate, slot);
+      int occupied = (airport->occupancy[g] & occupancy_range(slot, slot)) != 0;
+      if (occupied != (ts->status == 1))
+        FAIL("gate %d slot %d: occupancy bitmap does not match the slot\n", g, slot);
+      if (owner[g][slot] == 0 && ts->status == 1)
+        FAIL("gate %d slot %d orphaned by plane %d\n", g, slot, ts->plane_id);
+      if (owner[g][slot] != 0 && (ts->status != 1 || ts->plane_id != owner[g][slot]))
+        FAIL("gate %d slot %d lost the booking of plane %d\n", g, slot, owner[g][slot]);
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  int rounds = (argc > 1) ? atoi(argv[1]) : 20;
+  static client_t clients[NUM_CLIENTS];
+  pthread_t client_tids[NUM_CLIENTS], reader_tids[NUM_READERS];
+
+  // Only `schedule_in_window` reads it, so direct calls are not held up
+  SCHEDULE_WINDOW_US = WINDOW_US;
+  for (int round = 0; round < rounds; round++) {
+    // Every gate policy in turn, before the airport is created with it
+    PROBE_POLICY = (probe_policy_t)(round % (PROBE_BEST_FIT + 1));
+    airport_t *airport = create_airport(NUM_GATES);
+    if (airport == NULL)
+      FAIL("create_airport failed\n");
+    attach_airport(0, airport);
+    clients_running = NUM_CLIENTS;
+
+    for (int c = 0; c < NUM_CLIENTS; c++) {
+      clients[c].client = c;
+      clients[c].seed = (unsigned)(round * NUM_CLIENTS + c);
+      pthread_create(&client_tids[c], NULL, client_routine, &clients[c]);
+    }
+    for (int r = 0; r < NUM_READERS; r++)
+      pthread_create(&reader_tids[r], NULL, reader_routine, (void *)(size_t)(r + 1));
+    for (int c = 0; c < NUM_CLIENTS; c++)
+      pthread_join(client_tids[c], NULL);
+    for (int r = 0; r < NUM_READERS; r++)
+      pthread_join(reader_tids[r], NULL);
+
+    if (check_round(airport, clients) != 0) {
+      fprintf(stderr, "round %d failed\n", round);
+      return 1;
+    }
+    destroy_airport(airport);
+  }
+  return 0;
+}